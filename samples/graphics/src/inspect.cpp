@@ -226,13 +226,17 @@ int main(int argc, char **argv) {
     sf::VideoMode desktopMode(800, 500);
 
     // Create network model.
-    cortex2d_t cortex;
-    c2d_from_file(&cortex, cortexFileName);
+    cortex2d_t* cortex;
+    error_code_t error = c2d_from_file(&cortex, cortexFileName);
+    if (error != ERROR_NONE) {
+        printf("Error %d while reading %s\n", error, cortexFileName);
+        exit(1);
+    }
 
-    float* xNeuronPositions = (float*) malloc(cortex.width * cortex.height * sizeof(float));
-    float* yNeuronPositions = (float*) malloc(cortex.width * cortex.height * sizeof(float));
+    float* xNeuronPositions = (float*) malloc(cortex->width * cortex->height * sizeof(float));
+    float* yNeuronPositions = (float*) malloc(cortex->width * cortex->height * sizeof(float));
 
-    initPositions(&cortex, xNeuronPositions, yNeuronPositions);
+    initPositions(cortex, xNeuronPositions, yNeuronPositions);
     
     // Create the window
     sf::ContextSettings settings;
@@ -290,8 +294,8 @@ int main(int argc, char **argv) {
                         sf::Vector2i mousePos =  sf::Mouse::getPosition(window);
                         float xPos = ((float) mousePos.x) / ((float) window.getSize().x);
                         float yPos = ((float) mousePos.y) / ((float) window.getSize().y);
-                        int xTmp = (int) (xPos * cortex.width);
-                        int yTmp = (int) (yPos * cortex.height);
+                        int xTmp = (int) (xPos * cortex->width);
+                        int yTmp = (int) (yPos * cortex->height);
                         xFocus = xTmp;
                         yFocus = yTmp;
                     }
@@ -306,21 +310,21 @@ int main(int argc, char **argv) {
 
         // Draw synapses.
         if (sDraw) {
-            drawSynapses(&cortex, &window, desktopMode, xNeuronPositions, yNeuronPositions);
+            drawSynapses(cortex, &window, desktopMode, xNeuronPositions, yNeuronPositions);
         }
 
         // Draw neurons.
         if (nDraw) {
-            drawNeurons(&cortex, &window, desktopMode, xNeuronPositions, yNeuronPositions, showInfo, desktopMode, font);
+            drawNeurons(cortex, &window, desktopMode, xNeuronPositions, yNeuronPositions, showInfo, desktopMode, font);
         }
 
         if (mouseIn && xFocus != -1 && yFocus != -1) {
             // Keep track of visited neurons.
-            int passedNeurons[cortex.width * cortex.height];
+            int passedNeurons[cortex->width * cortex->height];
             int* passedNeuronsSize = (int*) malloc(sizeof(int));
             (*passedNeuronsSize) = 0;
 
-            highlightNeuron(&cortex,
+            highlightNeuron(cortex,
                             &window,
                             desktopMode,
                             passedNeurons,
@@ -1,9 +1,140 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 #include <behema/behema.h>
 
+// Hardware counters opened around c2d_tick.
+enum perf_counter_t {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_COUNTERS_COUNT
+};
+
+static const char* perf_counter_names[PERF_COUNTERS_COUNT] = {
+    "cycles",
+    "instructions",
+    "LLC misses",
+    "branch misses",
+    "dTLB misses"
+};
+
+typedef struct perf_counters_t {
+    int fds[PERF_COUNTERS_COUNT];
+    uint64_t values[PERF_COUNTERS_COUNT];
+} perf_counters_t;
+
+static int perf_open(uint32_t type, uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Count threads spawned after this point as well, so counters must be opened before the OpenMP pool is created.
+    attr.inherit = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+// Opens all counters as a single group, so that they're scheduled together. Returns false if counters are not available.
+static bool perf_init(perf_counters_t* counters) {
+    const uint32_t types[PERF_COUNTERS_COUNT] = {
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HW_CACHE
+    };
+    const uint64_t configs[PERF_COUNTERS_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+
+    memset(counters, 0, sizeof(perf_counters_t));
+    for (int i = 0; i < PERF_COUNTERS_COUNT; i++) {
+        counters->fds[i] = perf_open(types[i], configs[i], i == 0 ? -1 : counters->fds[0]);
+        if (counters->fds[i] < 0) {
+            printf("Could not open %s counter, check /proc/sys/kernel/perf_event_paranoid\n", perf_counter_names[i]);
+            for (int j = 0; j < i; j++) {
+                close(counters->fds[j]);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+static void perf_start(perf_counters_t* counters) {
+    ioctl(counters->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void perf_stop(perf_counters_t* counters) {
+    ioctl(counters->fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void perf_read(perf_counters_t* counters) {
+    for (int i = 0; i < PERF_COUNTERS_COUNT; i++) {
+        uint64_t value = 0;
+        if (read(counters->fds[i], &value, sizeof(value)) == sizeof(value)) {
+            counters->values[i] = value;
+        }
+        close(counters->fds[i]);
+    }
+}
+
+// Prints counters and a rough roofline-style verdict for the benchmarked configuration.
+static void perf_report(perf_counters_t* counters, uint64_t neurons_count, uint32_t ticks_count, uint64_t elapsed_ns) {
+    double cycles = (double) counters->values[PERF_CYCLES];
+    double instructions = (double) counters->values[PERF_INSTRUCTIONS];
+    double llc_misses = (double) counters->values[PERF_LLC_MISSES];
+    double dtlb_misses = (double) counters->values[PERF_DTLB_MISSES];
+    double neuron_ticks = (double) neurons_count * (double) ticks_count;
+
+    double ipc = cycles > 0 ? instructions / cycles : 0;
+    // Turn LLC misses into memory traffic.
+    double bytes = llc_misses * CACHE_LINE_SIZE;
+    double bytes_per_neuron_tick = bytes / neuron_ticks;
+    // Misses per kilo-instruction.
+    double mpki = instructions > 0 ? 1000.0 * llc_misses / instructions : 0;
+    // Arithmetic intensity, in instructions per byte of DRAM traffic.
+    double intensity = bytes > 0 ? instructions / bytes : 0;
+    double bandwidth = elapsed_ns > 0 ? bytes / (double) elapsed_ns : 0;
+
+    printf("\nHardware counters (c2d_tick only):\n");
+    for (int i = 0; i < PERF_COUNTERS_COUNT; i++) {
+        printf("  %-16s%lu\n", perf_counter_names[i], counters->values[i]);
+    }
+    printf("  %-16s%.2f\n", "IPC", ipc);
+    printf("  %-16s%.2f\n", "LLC MPKI", mpki);
+    // Neuron arrays are backed by huge pages when big enough, which should keep this low even on big cortices.
+    printf("  %-16s%.2f\n", "dTLB MPKI", instructions > 0 ? 1000.0 * dtlb_misses / instructions : 0);
+    printf("  %-16s%.2f\n", "bytes/neuron/tick", bytes_per_neuron_tick);
+    printf("  %-16s%.2f\n", "instr/byte", intensity);
+    printf("  %-16s%.2f GB/s\n", "DRAM traffic", bandwidth);
+    printf("  %-16s%.1f\n", "instr/neuron/tick", instructions / neuron_ticks);
+
+    // A low IPC paired with many misses per instruction means the core mostly waits on memory, while a high IPC with few misses means it's bound by execution.
+    const char* verdict = "balanced";
+    if (mpki > 10.0 || (ipc < 1.0 && mpki > 2.0)) {
+        verdict = "memory-bound";
+    } else if (mpki < 1.0 && ipc >= 1.0) {
+        verdict = "compute-bound";
+    }
+    printf("  %-16s%s\n", "verdict", verdict);
+}
+
 int main(int argc, char **argv) {
     cortex_size_t cortex_width = 100;
     cortex_size_t cortex_height = 60;
@@ -11,26 +142,83 @@ int main(int argc, char **argv) {
     cortex_size_t input_height = 1;
     uint32_t iterations_count = 10000;
     nh_radius_t nh_radius = 2;
+    bool use_perf = false;
+    bool use_tiles = false;
+    bool use_snapshots = false;
+
+    // Input handling.
+    if (argc > 5) {
+        // Options come after all positional arguments, in any order.
+        for (int i = 5; i < argc; i++) {
+            use_perf |= !strcmp(argv[i], "perf");
+            use_tiles |= !strcmp(argv[i], "tiled");
+            use_snapshots |= !strcmp(argv[i], "publish");
+        }
+        argc = 5;
+    }
+    switch (argc) {
+        case 1:
+            break;
+        case 5:
+            iterations_count = atoi(argv[4]);
+            // fall through
+        case 4:
+            nh_radius = atoi(argv[3]);
+            // fall through
+        case 3:
+            cortex_height = atoi(argv[2]);
+            // fall through
+        case 2:
+            cortex_width = atoi(argv[1]);
+            break;
+        default:
+            printf("USAGE: bench <width> <height> <nh_radius> <iterations_count> [perf] [tiled] [publish]\n");
+            exit(0);
+            break;
+    }
 
     srand(time(NULL));
 
+    // Counters only follow threads spawned after they're opened, so open them before any parallel region spawns OpenMP workers.
+    perf_counters_t counters;
+    if (use_perf) {
+        use_perf = perf_init(&counters);
+    }
+
     error_code_t error;
 
     // Cortex init.
-    cortex2d_t* even_cortex;
-    cortex2d_t* odd_cortex;
-    error = c2d_init(&even_cortex, cortex_width, cortex_height, nh_radius);
-    error = c2d_init(&odd_cortex, cortex_width, cortex_height, nh_radius);
-    c2d_set_evol_step(even_cortex, 0x01U);
-    c2d_set_pulse_mapping(even_cortex, PULSE_MAPPING_RPROP);
-    c2d_set_max_syn_count(even_cortex, 24);
+    c2d_pair_t* cortex_pair;
+    error = c2d_pair_init(&cortex_pair, cortex_width, cortex_height, nh_radius);
+    if (error != ERROR_NONE) {
+        printf("Error %d during init\n", error);
+        exit(1);
+    }
+    cortex2d_t* cortex = c2d_pair_current(cortex_pair);
+    c2d_set_evol_step(cortex, 0x01U);
+    c2d_set_pulse_mapping(cortex, PULSE_MAPPING_RPROP);
+    c2d_set_max_syn_count(cortex, 24);
+    if (use_tiles) {
+        error = c2d_set_neurons_order(cortex, NEURONS_ORDER_TILED);
+        if (error != ERROR_NONE) {
+            printf("Error %d while tiling, sizes must be multiples of %d\n", error, TILE_SIDE_2D);
+            exit(1);
+        }
+    }
     char touchFileName[40];
     char inhexcFileName[40];
     sprintf(touchFileName, "./res/%d_%d_touch.pgm", cortex_width, cortex_height);
     sprintf(inhexcFileName, "./res/%d_%d_inhexc.pgm", cortex_width, cortex_height);
-    c2d_touch_from_map(even_cortex, touchFileName);
-    c2d_inhexc_from_map(even_cortex, inhexcFileName);
-    c2d_copy(odd_cortex, even_cortex);
+
+    // Fall back to procedural maps for sizes with no map files.
+    if (c2d_touch_from_map(cortex, touchFileName) != ERROR_NONE) {
+        radial_map_args_t touch_args = {0.5F, 0.5F, 0.75F, FALSE};
+        c2d_touch_from_fn(cortex, map_fn_radial, &touch_args);
+    }
+    if (c2d_inhexc_from_map(cortex, inhexcFileName) != ERROR_NONE) {
+        noise_map_args_t inhexc_args = {0x2AU, cortex_width / 4 + 1, 3};
+        c2d_inhexc_from_fn(cortex, map_fn_value_noise, &inhexc_args);
+    }
 
     // Input init.
     input2d_t* input;
@@ -46,25 +234,47 @@ int main(int argc, char **argv) {
 
     // Set input values.
     for (int i = 0; i < input_width * input_height; i++) {
-        input->values[i] = even_cortex->sample_window - 1;
+        input->values[i] = cortex->sample_window - 1;
+    }
+
+    // Snapshots can be watched live from another process, e.g. by the monitor sample.
+    snap_publisher_t* publisher = NULL;
+    if (use_snapshots) {
+        error = snap_publisher_init(&publisher, cortex, "/behema_bench", SNAP_PLANE_VALUES | SNAP_PLANE_PULSES | SNAP_PLANE_FIRED, 10);
+        if (error != ERROR_NONE) {
+            printf("Error %d while creating snapshots\n", error);
+            exit(1);
+        }
     }
 
     uint64_t start_time = millis();
+    uint64_t tick_time = 0;
 
     for (uint32_t i = 0; i < iterations_count; i++) {
-        cortex2d_t* prev_cortex = i % 2 ? odd_cortex : even_cortex;
-        cortex2d_t* next_cortex = i % 2 ? even_cortex : odd_cortex;
-
         // TODO Fetch input.
 
         // Feed.
-        c2d_feed2d(prev_cortex, input);
+        c2d_feed2d(c2d_pair_current(cortex_pair), input);
+
+        uint64_t tick_start = nanos();
+        if (use_perf) {
+            perf_start(&counters);
+        }
+
+        c2d_pair_tick(cortex_pair);
 
-        c2d_tick(prev_cortex, next_cortex);
+        if (use_perf) {
+            perf_stop(&counters);
+        }
+        tick_time += nanos() - tick_start;
+
+        if (publisher != NULL) {
+            c2d_publish(publisher, c2d_pair_current(cortex_pair));
+        }
 
         if (i % 1000 == 0) {
             printf("\nPerformed %d iterations in %ldms\n", i, millis() - start_time);
-            c2d_to_file(even_cortex, (char*) "out/test.c2d");
+            c2d_to_file(c2d_pair_current(cortex_pair), (char*) "out/test.c2d");
         }
 
         // usleep(100);
@@ -74,12 +284,19 @@ int main(int argc, char **argv) {
     uint64_t end_time = millis();
     printf("\nCompleted %d iterations in %ldms\n", iterations_count, end_time - start_time);
 
+    if (use_perf) {
+        perf_read(&counters);
+        perf_report(&counters, (uint64_t) cortex_width * (uint64_t) cortex_height, iterations_count, tick_time);
+    }
+
     // Copy the cortex back to host to check the results.
-    c2d_to_file(even_cortex, (char*) "out/test.c2d");
+    c2d_to_file(c2d_pair_current(cortex_pair), (char*) "out/test.c2d");
 
     // Cleanup.
-    c2d_destroy(even_cortex);
-    c2d_destroy(odd_cortex);
+    c2d_pair_destroy(cortex_pair);
+    if (publisher != NULL) {
+        snap_publisher_destroy(publisher);
+    }
     i2d_destroy(input);
 
     return 0;
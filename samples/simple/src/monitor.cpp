@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <behema/behema.h>
+
+// Watches the snapshots published by another process (e.g. "bench ... publish") and prints a summary of each one it manages to read.
+int main(int argc, char **argv) {
+    const char* name = "/behema_bench";
+    uint32_t interval_ms = 500;
+
+    // Input handling.
+    switch (argc) {
+        case 1:
+            break;
+        case 3:
+            interval_ms = atoi(argv[2]);
+            // fall through
+        case 2:
+            name = argv[1];
+            break;
+        default:
+            printf("USAGE: monitor <snapshots_name> <interval_ms>\n");
+            exit(0);
+            break;
+    }
+
+    snap_reader_t* reader;
+    error_code_t error = snap_reader_open(&reader, name);
+    if (error != ERROR_NONE) {
+        printf("Error %d while opening %s, is the publisher running?\n", error, name);
+        exit(1);
+    }
+
+    uint64_t last_number = 0;
+    uint64_t skipped_count = 0;
+    for (;;) {
+        snap_view_t view;
+        if (snap_read_begin(reader, &view) == ERROR_NONE && view.number != last_number) {
+            // Data is read straight from shared memory, then only trusted if the publisher didn't overwrite it meanwhile.
+            cortex_index_t neurons_count = (cortex_index_t) view.width * view.height;
+            int64_t values_sum = 0;
+            cortex_index_t fired_count = 0;
+            for (cortex_index_t i = 0; view.values != NULL && i < neurons_count; i++) {
+                values_sum += view.values[i];
+            }
+            for (cortex_index_t i = 0; view.fired != NULL && i < (neurons_count + 63) / 64; i++) {
+                fired_count += __builtin_popcountll(view.fired[i]);
+            }
+
+            if (snap_read_end(reader, &view)) {
+                skipped_count += last_number > 0 ? view.number - last_number - 1 : 0;
+                last_number = view.number;
+                printf("Snapshot %lu (tick %d): mean value %.2f, %ld fired, %lu skipped\n",
+                       view.number,
+                       view.ticks_count,
+                       (double) values_sum / (double) neurons_count,
+                       fired_count,
+                       skipped_count);
+            }
+        }
+
+        usleep(interval_ms * 1000);
+    }
+
+    snap_reader_close(reader);
+
+    return 0;
+}
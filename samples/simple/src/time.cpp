@@ -38,8 +38,7 @@ int main(int argc, char **argv) {
             break;
     }
 
-    cortex2d_t even_cortex;
-    cortex2d_t odd_cortex;
+    c2d_pair_t* cortex_pair;
 
     ticks_count_t* inputs = (ticks_count_t*) malloc(inputs_count * sizeof(ticks_count_t));
     ticks_count_t sample_rate = 10;
@@ -47,13 +46,9 @@ int main(int argc, char **argv) {
 
     srand(time(NULL));
 
-    c2d_init(&even_cortex, cortex_width, cortex_height, nh_radius);
-    c2d_copy(&odd_cortex, &even_cortex);
+    c2d_pair_init(&cortex_pair, cortex_width, cortex_height, nh_radius);
 
     for (int i = 0; i < 1000; i++) {
-        cortex2d_t* prev_cortex = i % 2 ? &odd_cortex : &even_cortex;
-        cortex2d_t* next_cortex = i % 2 ? &even_cortex : &odd_cortex;
-
         // // Only get new inputs according to the sample rate.
         // if (i % sample_rate == 0) {
         //     // Fetch input.
@@ -66,13 +61,15 @@ int main(int argc, char **argv) {
         // // Feed the cortex.
         // for (cortex_size_t k = 0; k < inputs_count; k++) {
         //     if (samples_count % inputs[k]) {
-        //         prev_cortex->neurons[k].value += DEFAULT_EXC_VALUE;
+        //         c2d_pair_current(cortex_pair)->neurons[k].value += DEFAULT_EXC_VALUE;
         //     }
         // }
 
         // Tick the cortex.
-        c2d_tick(prev_cortex, next_cortex);
+        c2d_pair_tick(cortex_pair);
 
         samples_count++;
     }
+
+    c2d_pair_destroy(cortex_pair);
 }
@@ -11,11 +11,15 @@ Copyright (C) 2021 Luka Micheletti
 
 #include "cortex.h"
 #include "utils.h"
+#include "profiler.h"
 
 #ifdef __CUDACC__
 #include "behema_cuda.h"
 #else
 #include "behema_std.h"
+#include "recorder.h"
+#include "sweep.h"
+#include "snapshot.h"
 #endif
 
 #endif
@@ -124,7 +124,7 @@ error_code_t c2d_to_host(cortex2d_t* host_cortex, cortex2d_t* device_cortex) {
     (*host_cortex) = (*tmp_cortex);
 
     // Allocate neurons on the host.
-    host_cortex->neurons = (neuron_t*) malloc(tmp_cortex->width * tmp_cortex->height * sizeof(neuron_t));
+    neurons_alloc(&(host_cortex->neurons), (size_t) tmp_cortex->width * (size_t) tmp_cortex->height);
 
     // Copy tmp cortex neurons (still on device) to host cortex.
     cudaMemcpy(host_cortex->neurons, tmp_cortex->neurons, tmp_cortex->width * tmp_cortex->height * sizeof(neuron_t), cudaMemcpyDeviceToHost);
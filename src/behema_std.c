@@ -1,4 +1,10 @@
+// Must come before any include in order to bring in madvise() and posix_fadvise() under -std=c17.
+#define _DEFAULT_SOURCE
+
 #include "behema_std.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <omp.h>
 
 // The state word must be initialized to non-zero.
 uint32_t xorshf32(uint32_t state) {
@@ -11,7 +17,31 @@ uint32_t xorshf32(uint32_t state) {
 }
 
 
+// Returns the evolution group of the neuron at (x, y) of a cortex of the given width when evolution is amortized over evol_period ticks.
+static inline evol_step_t c2d_evol_group(evol_mode_t evol_mode, cortex_size_t x, cortex_size_t y, cortex_size_t width, evol_step_t evol_period) {
+    switch (evol_mode) {
+        case EVOL_MODE_STRIPES:
+            return (evol_step_t) y % evol_period;
+        case EVOL_MODE_CHECKERBOARD:
+            return (evol_step_t) (x + y) % evol_period;
+        case EVOL_MODE_HASHED: {
+            // Murmur3 finalizer.
+            uint32_t h = (uint32_t) IDX2D(x, y, width);
+            h ^= h >> 16;
+            h *= 0x85EBCA6BU;
+            h ^= h >> 13;
+            h *= 0xC2B2AE35U;
+            h ^= h >> 16;
+            return h % evol_period;
+        }
+        default:
+            return 0;
+    }
+}
+
 void c2d_feed2d(cortex2d_t* cortex, input2d_t* input) {
+    uint64_t prof_start = prof_span_begin();
+
     #pragma omp parallel for collapse(2)
     for (cortex_size_t y = input->y0; y < input->y1; y++) {
         for (cortex_size_t x = input->x0; x < input->x1; x++) {
@@ -19,192 +49,2248 @@ void c2d_feed2d(cortex2d_t* cortex, input2d_t* input) {
                           cortex->ticks_count % cortex->sample_window,
                           input->values[IDX2D(x - input->x0, y - input->y0, input->x1 - input->x0)],
                           cortex->pulse_mapping)) {
-                cortex->neurons[IDX2D(x, y, cortex->width)].value += input->exc_value;
+                cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)].value += input->exc_value;
             }
         }
     }
+
+    prof_span_end(PROF_PHASE_FEED, prof_start);
 }
 
-void c2d_tick(cortex2d_t* prev_cortex, cortex2d_t* next_cortex) {
-    #pragma omp parallel for collapse(2)
-    for (cortex_size_t y = 0; y < prev_cortex->height; y++) {
-        for (cortex_size_t x = 0; x < prev_cortex->width; x++) {
-            // Retrieve the involved neurons.
-            cortex_size_t neuron_index = IDX2D(x, y, prev_cortex->width);
-            neuron_t prev_neuron = prev_cortex->neurons[neuron_index];
-            neuron_t* next_neuron = &(next_cortex->neurons[neuron_index]);
-
-            // Copy prev neuron values to the new one.
-            *next_neuron = prev_neuron;
-
-            /* Compute the neighborhood diameter:
-                   d = 7
-              <------------->
-               r = 3
-              <----->
-              +-|-|-|-|-|-|-+
-              |             |
-              |             |
-              |      X      |
-              |             |
-              |             |
-              +-|-|-|-|-|-|-+
-            */
-            cortex_size_t nh_diameter = NH_DIAM_2D(prev_cortex->nh_radius);
-
-            nh_mask_t prev_ac_mask = prev_neuron.synac_mask;
-            nh_mask_t prev_exc_mask = prev_neuron.synex_mask;
-            nh_mask_t prev_str_mask_a = prev_neuron.synstr_mask_a;
-            nh_mask_t prev_str_mask_b = prev_neuron.synstr_mask_b;
-            nh_mask_t prev_str_mask_c = prev_neuron.synstr_mask_c;
-
-            // Defines whether to evolve or not.
-            // evol_step is incremented by 1 to account for edge cases and human readable behavior:
-            // 0x0000 -> 0 + 1 = 1, so the cortex evolves at every tick, meaning that there are no free ticks between evolutions.
-            // 0xFFFF -> 65535 + 1 = 65536, so the cortex never evolves, meaning that there is an infinite amount of ticks between evolutions.
-            bool_t evolve = (prev_cortex->ticks_count % (((evol_step_t) prev_cortex->evol_step) + 1)) == 0;
-
-            // Increment the current neuron value by reading its connected neighbors.
-            for (nh_radius_t j = 0; j < nh_diameter; j++) {
-                for (nh_radius_t i = 0; i < nh_diameter; i++) {
-                    cortex_size_t neighbor_x = x + (i - prev_cortex->nh_radius);
-                    cortex_size_t neighbor_y = y + (j - prev_cortex->nh_radius);
-
-                    // Exclude the central neuron from the list of neighbors.
-                    if ((j != prev_cortex->nh_radius || i != prev_cortex->nh_radius) &&
-                        (neighbor_x >= 0 && neighbor_y >= 0 && neighbor_x < prev_cortex->width && neighbor_y < prev_cortex->height)) {
-                        // The index of the current neighbor in the current neuron's neighborhood.
-                        cortex_size_t neighbor_nh_index = IDX2D(i, j, nh_diameter);
-                        cortex_size_t neighbor_index = IDX2D(WRAP(neighbor_x, prev_cortex->width),
-                                                             WRAP(neighbor_y, prev_cortex->height),
-                                                             prev_cortex->width);
-
-                        // Fetch the current neighbor.
-                        neuron_t neighbor = prev_cortex->neurons[neighbor_index];
+// Bitmap of the neurons whose pulse is above 0, built once per evolving tick: neighbors with no pulse can't make new synapses nor strengthen existing ones, so most of the evolution work can be skipped for them.
+// Rows are padded by nh_radius zero bits on each side, so that neighborhoods can be gathered with no bounds checks, and aligned to whole words, so that rows can be built in parallel.
+// Padding of wrapped cortices holds the bits of the neurons on the opposite edges instead.
+// Only the rows needed by a band of neurons are mapped, so that out-of-core cortices never need the whole map.
+typedef struct active_map_t {
+    uint64_t* words;
+    // Words per row, including one spare word so that gathers can always read two consecutive words.
+    cortex_size_t row_words;
+    // First row of the band the map is built for.
+    cortex_size_t y0;
+} active_map_t;
 
-                        // Compute the current synapse strength.
-                        syn_strength_t syn_strength = (prev_str_mask_a & 0x01U) |
-                                                      ((prev_str_mask_b & 0x01U) << 0x01U) |
-                                                      ((prev_str_mask_c & 0x01U) << 0x02U);
+// Builds the active map for the neurons in rows [y0, y1), which covers their neighbors in rows [y0 - nh_radius, y1 + nh_radius).
+static error_code_t c2d_active_map_init(cortex2d_t* cortex, active_map_t* map, cortex_size_t y0, cortex_size_t y1) {
+    cortex_size_t padding = cortex->nh_radius;
+    map->y0 = y0;
+    map->row_words = (cortex->width + 2 * padding + 63) / 64 + 1;
+    map->words = (uint64_t*) calloc((size_t) map->row_words * (size_t) (y1 - y0 + 2 * padding), sizeof(uint64_t));
+    if (map->words == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
 
-                        // Pick a random number for each neighbor, capped to the max uint16 value.
-                        next_neuron->rand_state = xorshf32(next_neuron->rand_state);
-                        chance_t random = next_neuron->rand_state % 0xFFFFU;
-
-                        // Inverse of the current synapse strength, useful when computing depression probability (synapse deletion and weakening).
-                        syn_strength_t strength_diff = MAX_SYN_STRENGTH - syn_strength;
-
-                        // Check if the last bit of the mask is 1 or 0: 1 = active synapse, 0 = inactive synapse.
-                        if (prev_ac_mask & 0x01U) {
-                            neuron_value_t neighbor_influence = (prev_exc_mask & 0x01U ? prev_cortex->exc_value : -prev_cortex->exc_value) * ((syn_strength / 4) + 1);
-                            if (neighbor.value > prev_cortex->fire_threshold) {
-                                if (next_neuron->value + neighbor_influence < prev_cortex->recovery_value) {
-                                    next_neuron->value = prev_cortex->recovery_value;
-                                } else {
-                                    next_neuron->value += neighbor_influence;
-                                }
-                            }
-                        }
+    cortex_size_t first_row = y0 - padding > 0 || cortex->wrapped ? y0 - padding : 0;
+    cortex_size_t last_row = y1 + padding < cortex->height || cortex->wrapped ? y1 + padding : cortex->height;
 
-                        // Perform the evolution phase if allowed.
-                        if (evolve) {
-                            // Structural plasticity: create or destroy a synapse.
-                            if (!(prev_ac_mask & 0x01U) &&
-                                prev_neuron.syn_count < next_neuron->max_syn_count &&
-                                // Frequency component.
-                                random < prev_cortex->syngen_chance * (chance_t) neighbor.pulse) {
-                                // Add synapse.
-                                next_neuron->synac_mask |= (0x01UL << neighbor_nh_index);
-
-                                // Set the new synapse's strength to 0.
-                                next_neuron->synstr_mask_a &= ~(0x01UL << neighbor_nh_index);
-                                next_neuron->synstr_mask_b &= ~(0x01UL << neighbor_nh_index);
-                                next_neuron->synstr_mask_c &= ~(0x01UL << neighbor_nh_index);
-
-                                // Define whether the new synapse is excitatory or inhibitory.
-                                if (random % next_cortex->inhexc_range < next_neuron->inhexc_ratio) {
-                                    // Inhibitory.
-                                    next_neuron->synex_mask &= ~(0x01UL << neighbor_nh_index);
-                                } else {
-                                    // Excitatory.
-                                    next_neuron->synex_mask |= (0x01UL << neighbor_nh_index);
-                                }
-
-                                next_neuron->syn_count++;
-                            } else if (prev_ac_mask & 0x01U &&
-                                       // Only 0-strength synapses can be deleted.
-                                       syn_strength <= 0x00U &&
-                                       // Frequency component.
-                                       random < prev_cortex->syngen_chance / (neighbor.pulse + 1)) {
-                                // Delete synapse.
-                                next_neuron->synac_mask &= ~(0x01UL << neighbor_nh_index);
-
-                                next_neuron->syn_count--;
-                            }
+    #pragma omp parallel for
+    for (cortex_size_t y = first_row; y < last_row; y++) {
+        uint64_t* row = map->words + (size_t) (y - y0 + padding) * map->row_words;
+        // Rows beyond the edges of wrapped cortices are the ones on the opposite edge.
+        cortex_size_t neurons_y = WRAP(y, cortex->height);
+        for (cortex_size_t x = 0; x < cortex->width; x++) {
+            if (cortex->neurons[ORDER_IDX2D(x, neurons_y, cortex->width, cortex->neurons_order)].pulse > 0) {
+                cortex_size_t bit = x + padding;
+                row[bit / 64] |= 0x01UL << (bit % 64);
+            }
+        }
 
-                            // Functional plasticity: strengthen or weaken a synapse.
-                            if (prev_ac_mask & 0x01U) {
-                                if (syn_strength < MAX_SYN_STRENGTH &&
-                                    prev_neuron.tot_syn_strength < prev_cortex->max_tot_strength &&
-                                    random < prev_cortex->synstr_chance * (chance_t) neighbor.pulse * (chance_t) strength_diff) {
-                                    syn_strength++;
-                                    next_neuron->synstr_mask_a = (prev_neuron.synstr_mask_a & ~(0x01UL << neighbor_nh_index)) | ((syn_strength & 0x01U) << neighbor_nh_index);
-                                    next_neuron->synstr_mask_b = (prev_neuron.synstr_mask_b & ~(0x01UL << neighbor_nh_index)) | (((syn_strength >> 0x01U) & 0x01U) << neighbor_nh_index);
-                                    next_neuron->synstr_mask_c = (prev_neuron.synstr_mask_c & ~(0x01UL << neighbor_nh_index)) | (((syn_strength >> 0x02U) & 0x01U) << neighbor_nh_index);
-
-                                    next_neuron->tot_syn_strength++;
-                                } else if (syn_strength > 0x00U &&
-                                           random < prev_cortex->synstr_chance / (neighbor.pulse + syn_strength + 1)) {
-                                    syn_strength--;
-                                    next_neuron->synstr_mask_a = (prev_neuron.synstr_mask_a & ~(0x01UL << neighbor_nh_index)) | ((syn_strength & 0x01U) << neighbor_nh_index);
-                                    next_neuron->synstr_mask_b = (prev_neuron.synstr_mask_b & ~(0x01UL << neighbor_nh_index)) | (((syn_strength >> 0x01U) & 0x01U) << neighbor_nh_index);
-                                    next_neuron->synstr_mask_c = (prev_neuron.synstr_mask_c & ~(0x01UL << neighbor_nh_index)) | (((syn_strength >> 0x02U) & 0x01U) << neighbor_nh_index);
-
-                                    next_neuron->tot_syn_strength--;
-                                }
-                            }
+        if (cortex->wrapped) {
+            // So are columns: [-padding, 0) on the left, then [width, width + padding) on the right.
+            for (cortex_size_t i = 0; i < 2 * padding; i++) {
+                cortex_size_t x = i < padding ? i - padding : cortex->width + i - padding;
+                if (cortex->neurons[ORDER_IDX2D(WRAP(x, cortex->width), neurons_y, cortex->width, cortex->neurons_order)].pulse > 0) {
+                    cortex_size_t bit = x + padding;
+                    row[bit / 64] |= 0x01UL << (bit % 64);
+                }
+            }
+        }
+    }
 
-                            // Increment evolutions count.
-                            next_cortex->evols_count++;
-                        }
-                    }
+    return ERROR_NONE;
+}
+
+// Gathers the active bits of the neighborhood of (x, y) into a neighborhood mask.
+static inline nh_mask_t c2d_active_map_gather(const active_map_t* map, cortex_size_t x, cortex_size_t y, cortex_size_t nh_diameter) {
+    nh_mask_t row_mask = (0x01UL << nh_diameter) - 1;
+    nh_mask_t result = 0x00U;
+
+    // Padding shifts the whole map by nh_radius, so the neighborhood of (x, y) starts right at (x, y).
+    for (cortex_size_t j = 0; j < nh_diameter; j++) {
+        const uint64_t* row = map->words + (size_t) (y - map->y0 + j) * map->row_words + x / 64;
+        cortex_size_t offset = x % 64;
+        uint64_t bits = offset ? (row[0] >> offset) | (row[1] << (64 - offset)) : row[0];
+        result |= (bits & row_mask) << (j * nh_diameter);
+    }
+
+    return result;
+}
+
+// Returns the mask of the neighborhood positions of (x, y) that fall inside the cortex, central neuron excluded.
+static inline nh_mask_t c2d_nh_valid_mask(cortex2d_t* cortex, cortex_size_t x, cortex_size_t y, cortex_size_t nh_diameter) {
+    cortex_size_t nh_radius = cortex->nh_radius;
+    nh_mask_t center = 0x01UL << IDX2D(nh_radius, nh_radius, nh_diameter);
+
+    // Columns of the neighborhood falling inside the cortex, as a single row mask.
+    nh_mask_t row_mask = 0x00U;
+    for (cortex_size_t i = 0; i < nh_diameter; i++) {
+        cortex_size_t neighbor_x = x + (i - nh_radius);
+        if (neighbor_x >= 0 && neighbor_x < cortex->width) {
+            row_mask |= 0x01UL << i;
+        }
+    }
+
+    nh_mask_t result = 0x00U;
+    for (cortex_size_t j = 0; j < nh_diameter; j++) {
+        cortex_size_t neighbor_y = y + (j - nh_radius);
+        if (neighbor_y >= 0 && neighbor_y < cortex->height) {
+            result |= row_mask << (j * nh_diameter);
+        }
+    }
+
+    return result & ~center;
+}
+
+// Where a neuron reads its neighbors' state from: the value and pulse of the neighbor at neighborhood position k are found at
+// index + offsets[k] in values and pulses respectively, with the given stride in bytes between neurons.
+// Neighbors are usually read from the cortex neurons themselves, but edge neurons of wrapped cortices read them from a ghost border.
+typedef struct nh_source_t {
+    const byte* values;
+    const byte* pulses;
+    size_t stride;
+    const cortex_index_t* offsets;
+    cortex_index_t index;
+} nh_source_t;
+
+// Integrates a neuron by only visiting its active synapses, reading its neighbors from the given source.
+// Synapses are visited in neighborhood order, so that recovery clamping gives the same result as a full scan.
+static inline void c2d_integrate_neuron(cortex2d_t* prev_cortex,
+                                        const neuron_t* prev_neuron,
+                                        neuron_t* next_neuron,
+                                        const nh_source_t* source,
+                                        nh_mask_t valid_mask) {
+    for (nh_mask_t bits = prev_neuron->synac_mask & valid_mask; bits; bits &= bits - 1) {
+        cortex_size_t k = __builtin_ctzll(bits);
+        neuron_value_t neighbor_value = *((const neuron_value_t*) (source->values + (size_t) (source->index + source->offsets[k]) * source->stride));
+
+        if (neighbor_value > prev_cortex->fire_threshold) {
+            // Compute the current synapse strength.
+            syn_strength_t syn_strength = ((prev_neuron->synstr_mask_a >> k) & 0x01U) |
+                                          (((prev_neuron->synstr_mask_b >> k) & 0x01U) << 0x01U) |
+                                          (((prev_neuron->synstr_mask_c >> k) & 0x01U) << 0x02U);
+            neuron_value_t neighbor_influence = ((prev_neuron->synex_mask >> k) & 0x01U ? prev_cortex->exc_value : -prev_cortex->exc_value) * ((syn_strength / 4) + 1);
+            if (next_neuron->value + neighbor_influence < prev_cortex->recovery_value) {
+                next_neuron->value = prev_cortex->recovery_value;
+            } else {
+                next_neuron->value += neighbor_influence;
+            }
+        }
+    }
+}
+
+// Plasticity parameters of a cortex, shared by all of its neurons during a tick.
+typedef struct plasticity_t {
+    chance_t syngen_chance;
+    chance_t synstr_chance;
+    chance_t inhexc_range;
+    syn_strength_t max_tot_strength;
+    bool_t counter_rand;
+    rand_state_t rand_seed;
+    // Counter of the counter-based random numbers drawn during the tick.
+    uint64_t rand_counter;
+} plasticity_t;
+
+static inline plasticity_t c2d_plasticity(cortex2d_t* cortex) {
+    plasticity_t plasticity = {
+        cortex->syngen_chance,
+        cortex->synstr_chance,
+        cortex->inhexc_range,
+        cortex->max_tot_strength,
+        cortex->rand_mode == RAND_MODE_COUNTER,
+        cortex->rand_seed,
+        cortex->rand_ticks_count << 8
+    };
+    return plasticity;
+}
+
+// Computes the offset of each neighborhood position from the central neuron, in neurons, for 2D cortices of the given width.
+static inline void c2d_nh_offsets(cortex_index_t* nh_offsets, cortex_size_t width, nh_radius_t nh_radius) {
+    cortex_size_t nh_diameter = NH_DIAM_2D(nh_radius);
+    for (cortex_size_t k = 0; k < nh_diameter * nh_diameter; k++) {
+        nh_offsets[k] = IDX2D(k % nh_diameter - nh_radius, k / nh_diameter - nh_radius, width);
+    }
+}
+
+// Ghost border of a wrapped cortex: copies of the neurons around its edges, laid out where the wrapped neighborhoods of its edge
+// neurons expect them, so that edge neurons read their neighbors with no modulo nor bounds checks, just like inner neurons do.
+// The border is made of two planes, each one a regular 2D array:
+// - rows plane: rows [-r, 2r) and [h - 2r, h + r) of the cortex, over columns [-r, w + r), read by the neurons in the first and last r rows.
+// - columns plane: columns [-r, 2r) and [w - 2r, w + r) of the cortex, over rows [-r, h + r), read by the neurons in the first and last r columns.
+// Only O((w + h) * r) neurons are copied, so wrapped cortices tick at the same cost as bounded ones.
+// Both planes live in the cortex' own ghosts, allocated once by c2d_set_wrapped.
+typedef struct ghost_border_t {
+    ghost_t* rows;
+    ghost_t* columns;
+    cortex_size_t rows_width;
+    cortex_size_t columns_width;
+    cortex_index_t rows_offsets[NH_MASK_WORDS_MAX * 64];
+    cortex_index_t columns_offsets[NH_MASK_WORDS_MAX * 64];
+} ghost_border_t;
+
+// Copies the neuron at (x, y) of the given cortex to the given ghost, wrapping its coordinates around the cortex edges.
+static inline void c2d_ghost_copy(cortex2d_t* cortex, ghost_t* ghost, cortex_size_t x, cortex_size_t y) {
+    const neuron_t* neuron = &(cortex->neurons[ORDER_IDX2D(WRAP(x, cortex->width), WRAP(y, cortex->height), cortex->width, cortex->neurons_order)]);
+    ghost->value = neuron->value;
+    ghost->pulse = neuron->pulse;
+}
+
+// Refreshes the part of the given wrapped cortex' ghost border read by the neurons in rows [y0, y1).
+static void c2d_ghost_border_update(cortex2d_t* cortex, ghost_border_t* border, cortex_size_t y0, cortex_size_t y1) {
+    cortex_size_t nh_radius = cortex->nh_radius;
+    cortex_size_t width = cortex->width;
+    cortex_size_t height = cortex->height;
+
+    border->rows_width = width + 2 * nh_radius;
+    border->columns_width = 6 * nh_radius;
+    border->rows = cortex->ghosts;
+    border->columns = &(cortex->ghosts[(size_t) border->rows_width * 6 * nh_radius]);
+    c2d_nh_offsets(border->rows_offsets, border->rows_width, nh_radius);
+    c2d_nh_offsets(border->columns_offsets, border->columns_width, nh_radius);
+
+    // Rows plane, only if any of the first or last rows are going to be ticked.
+    for (cortex_size_t py = 0; py < 6 * nh_radius; py++) {
+        bool_t top = py < 3 * nh_radius;
+        if ((top && y0 < nh_radius) || (!top && y1 > height - nh_radius)) {
+            cortex_size_t y = top ? py - nh_radius : py + height - 5 * nh_radius;
+            for (cortex_size_t px = 0; px < border->rows_width; px++) {
+                c2d_ghost_copy(cortex, &(border->rows[IDX2D(px, py, border->rows_width)]), px - nh_radius, y);
+            }
+        }
+    }
+
+    // Columns plane, only over the rows read by the ticked rows.
+    for (cortex_size_t y = y0 - nh_radius; y < y1 + nh_radius; y++) {
+        for (cortex_size_t px = 0; px < border->columns_width; px++) {
+            cortex_size_t x = px < 3 * nh_radius ? px - nh_radius : px + width - 5 * nh_radius;
+            c2d_ghost_copy(cortex, &(border->columns[IDX2D(px, y + nh_radius, border->columns_width)]), x, y);
+        }
+    }
+}
+
+// Points the given neighbors source to the ghost border if the neuron at (x, y) is an edge neuron, otherwise leaves it untouched.
+static inline void c2d_ghost_source(const ghost_border_t* border, cortex2d_t* cortex, cortex_size_t x, cortex_size_t y, nh_source_t* source) {
+    cortex_size_t nh_radius = cortex->nh_radius;
+
+    if (y < nh_radius || y >= cortex->height - nh_radius) {
+        cortex_size_t py = y < nh_radius ? y + nh_radius : y - cortex->height + 5 * nh_radius;
+        source->values = (const byte*) &(border->rows[0].value);
+        source->pulses = (const byte*) &(border->rows[0].pulse);
+        source->stride = sizeof(ghost_t);
+        source->offsets = border->rows_offsets;
+        source->index = IDX2D(x + nh_radius, py, border->rows_width);
+    } else if (x < nh_radius || x >= cortex->width - nh_radius) {
+        cortex_size_t px = x < nh_radius ? x + nh_radius : x - cortex->width + 5 * nh_radius;
+        source->values = (const byte*) &(border->columns[0].value);
+        source->pulses = (const byte*) &(border->columns[0].pulse);
+        source->stride = sizeof(ghost_t);
+        source->offsets = border->columns_offsets;
+        source->index = IDX2D(px, y + nh_radius, border->columns_width);
+    }
+}
+
+// Performs structural and functional plasticity on a neuron, only visiting candidate synapses:
+// - creation: inactive synapses from active neighbors.
+// - deletion: active 0-strength synapses.
+// - strengthening: active synapses from active neighbors.
+// - weakening: active synapses with strength above 0.
+// Every other synapse would be left untouched whatever its random draw, so skipping it gives the same result as a full scan.
+// The pulse of the neighbor at position k is read from pulses at index pulses_index + nh_offsets[k], with the given stride in bytes
+// between neurons, so that any neurons layout and any neighborhood shape can be used.
+// nh_size is the number of neighborhood positions (central one included), while rand_index identifies the neuron for counter-based random numbers.
+static inline void nh_evolve_neuron(const plasticity_t* plasticity,
+                                    const byte* pulses,
+                                    size_t pulses_stride,
+                                    const cortex_index_t* nh_offsets,
+                                    cortex_index_t pulses_index,
+                                    cortex_size_t nh_size,
+                                    uint64_t rand_index,
+                                    const neuron_t* prev_neuron,
+                                    neuron_t* next_neuron,
+                                    nh_mask_t valid_mask,
+                                    nh_mask_t active_mask) {
+    nh_mask_t ac_mask = prev_neuron->synac_mask & valid_mask;
+    nh_mask_t nonzero_mask = prev_neuron->synstr_mask_a | prev_neuron->synstr_mask_b | prev_neuron->synstr_mask_c;
+
+    nh_mask_t create_mask = prev_neuron->syn_count < next_neuron->max_syn_count ? ~prev_neuron->synac_mask & active_mask : 0x00U;
+    nh_mask_t delete_mask = ac_mask & ~nonzero_mask;
+    nh_mask_t change_mask = ac_mask & (active_mask | nonzero_mask);
+    nh_mask_t candidates_mask = create_mask | delete_mask | change_mask;
+
+    bool_t counter_rand = plasticity->counter_rand;
+    uint64_t rand_key = 0;
+    uint64_t rand_counter = plasticity->rand_counter;
+    // Number of xorshift draws consumed so far: sequential draws belong to valid neighbors in neighborhood order, whether they're candidates or not.
+    cortex_size_t rand_draws = 0;
+
+    // Changes are collected over the whole neighborhood and applied at the end: decisions only depend on the previous state.
+    nh_mask_t created_mask = 0x00U;
+    nh_mask_t excitatory_mask = 0x00U;
+    nh_mask_t deleted_mask = 0x00U;
+    nh_mask_t inc_mask = 0x00U;
+    nh_mask_t dec_mask = 0x00U;
+
+    // Counter-based random numbers for dense neighborhoods are generated all at once, in a vectorizable loop.
+    chance_t randoms[sizeof(nh_mask_t) * 8];
+    bool_t bulk_rand = FALSE;
+    if (counter_rand) {
+        rand_key = squares_key(plasticity->rand_seed, rand_index);
+        bulk_rand = 2 * __builtin_popcountll(candidates_mask) > nh_size;
+        if (bulk_rand) {
+            #pragma omp simd
+            for (cortex_size_t k = 0; k < nh_size; k++) {
+                randoms[k] = squares32(rand_counter | (uint64_t) k, rand_key) % 0xFFFFU;
+            }
+        }
+    }
+
+    for (nh_mask_t bits = candidates_mask; bits; bits &= bits - 1) {
+        cortex_size_t k = __builtin_ctzll(bits);
+        nh_mask_t nh_bit = 0x01UL << k;
+        spikes_count_t neighbor_pulse = *((const spikes_count_t*) (pulses + (size_t) (pulses_index + nh_offsets[k]) * pulses_stride));
+
+        // Pick a random number for the neighbor, capped to the max uint16 value.
+        chance_t random;
+        if (counter_rand) {
+            random = bulk_rand ? randoms[k] : squares32(rand_counter | (uint64_t) k, rand_key) % 0xFFFFU;
+        } else {
+            // Catch up with the draws of all valid neighbors up to the current one.
+            cortex_size_t draws = __builtin_popcountll(valid_mask & ((nh_bit << 1) - 1));
+            for (; rand_draws < draws; rand_draws++) {
+                next_neuron->rand_state = xorshf32(next_neuron->rand_state);
+            }
+            random = next_neuron->rand_state % 0xFFFFU;
+        }
+
+        // Compute the current synapse strength.
+        syn_strength_t syn_strength = ((prev_neuron->synstr_mask_a >> k) & 0x01U) |
+                                      (((prev_neuron->synstr_mask_b >> k) & 0x01U) << 0x01U) |
+                                      (((prev_neuron->synstr_mask_c >> k) & 0x01U) << 0x02U);
+
+        // Inverse of the current synapse strength, useful when computing depression probability (synapse deletion and weakening).
+        syn_strength_t strength_diff = MAX_SYN_STRENGTH - syn_strength;
+
+        // Structural plasticity: create or destroy a synapse.
+        if ((create_mask & nh_bit) &&
+            // Frequency component.
+            random < plasticity->syngen_chance * (chance_t) neighbor_pulse) {
+            // Add synapse.
+            created_mask |= nh_bit;
+
+            // Define whether the new synapse is excitatory or inhibitory.
+            if (random % plasticity->inhexc_range >= next_neuron->inhexc_ratio) {
+                // Excitatory.
+                excitatory_mask |= nh_bit;
+            }
+        } else if ((delete_mask & nh_bit) &&
+                   // Frequency component.
+                   random < plasticity->syngen_chance / (neighbor_pulse + 1)) {
+            // Delete synapse.
+            deleted_mask |= nh_bit;
+        }
+
+        // Functional plasticity: strengthen or weaken a synapse.
+        if (ac_mask & nh_bit) {
+            if (syn_strength < MAX_SYN_STRENGTH &&
+                prev_neuron->tot_syn_strength < plasticity->max_tot_strength &&
+                random < plasticity->synstr_chance * (chance_t) neighbor_pulse * (chance_t) strength_diff) {
+                inc_mask |= nh_bit;
+            } else if (syn_strength > 0x00U &&
+                       random < plasticity->synstr_chance / (neighbor_pulse + syn_strength + 1)) {
+                dec_mask |= nh_bit;
+            }
+        }
+    }
+
+    // Apply all structural changes at once. New synapses start with strength 0.
+    next_neuron->synac_mask = (next_neuron->synac_mask | created_mask) & ~deleted_mask;
+    next_neuron->synex_mask = (next_neuron->synex_mask & ~created_mask) | excitatory_mask;
+    next_neuron->synstr_mask_a &= ~created_mask;
+    next_neuron->synstr_mask_b &= ~created_mask;
+    next_neuron->synstr_mask_c &= ~created_mask;
+    next_neuron->syn_count += __builtin_popcountll(created_mask);
+    next_neuron->syn_count -= __builtin_popcountll(deleted_mask);
+
+    // Apply all functional changes at once, as bit-sliced 3-bit additions and subtractions across the strength planes.
+    // Increments and decrements never overlap and never overflow, since saturated synapses are never selected.
+    if (inc_mask | dec_mask) {
+        nh_mask_t str_a = next_neuron->synstr_mask_a;
+        nh_mask_t str_b = next_neuron->synstr_mask_b;
+
+        // Ripple carry (increments) and borrow (decrements) from plane a to plane c.
+        nh_mask_t carry_a = (str_a & inc_mask) | (~str_a & dec_mask);
+        nh_mask_t carry_b = (str_b & carry_a & inc_mask) | (~str_b & carry_a & dec_mask);
+
+        next_neuron->synstr_mask_a = str_a ^ (inc_mask | dec_mask);
+        next_neuron->synstr_mask_b = str_b ^ carry_a;
+        next_neuron->synstr_mask_c ^= carry_b;
+
+        next_neuron->tot_syn_strength += __builtin_popcountll(inc_mask);
+        next_neuron->tot_syn_strength -= __builtin_popcountll(dec_mask);
+    }
+
+    if (!counter_rand) {
+        // Consume the draws of the remaining valid neighbors.
+        for (cortex_size_t draws = __builtin_popcountll(valid_mask); rand_draws < draws; rand_draws++) {
+            next_neuron->rand_state = xorshf32(next_neuron->rand_state);
+        }
+    }
+}
+
+// ORs the given bits into the given wide mask, starting at position pos. Bits must fit a single word.
+static inline void wide_mask_or_bits(wide_mask_t* mask, cortex_size_t pos, nh_mask_t bits) {
+    cortex_size_t word = pos / 64;
+    cortex_size_t offset = pos % 64;
+    mask->words[word] |= bits << offset;
+    if (offset > 0 && word + 1 < NH_MASK_WORDS_MAX) {
+        mask->words[word + 1] |= bits >> (64 - offset);
+    }
+}
+
+// Returns the number of bits set in the given wide mask.
+static inline cortex_size_t wide_mask_popcount(const wide_mask_t* mask) {
+    cortex_size_t result = 0;
+    for (cortex_size_t w = 0; w < NH_MASK_WORDS_MAX; w++) {
+        result += __builtin_popcountll(mask->words[w]);
+    }
+    return result;
+}
+
+// Returns the mask of all the positions of a square neighborhood with the given diameter, central neuron excluded.
+static inline wide_mask_t c2d_wide_full_mask(cortex_size_t nh_diameter) {
+    wide_mask_t result = {{0x00U}};
+    for (cortex_size_t j = 0; j < nh_diameter; j++) {
+        wide_mask_or_bits(&result, j * nh_diameter, (0x01UL << nh_diameter) - 1);
+    }
+    cortex_size_t center = IDX2D(nh_diameter / 2, nh_diameter / 2, nh_diameter);
+    result.words[center / 64] &= ~(0x01UL << (center % 64));
+    return result;
+}
+
+// Returns the wide mask of the neighborhood positions of (x, y) that fall inside the cortex, central neuron excluded.
+// Neurons far enough from the edges, as well as all neurons of wrapped cortices, get the full mask right away.
+static inline wide_mask_t c2d_nh_valid_wide(cortex2d_t* cortex, cortex_size_t x, cortex_size_t y, cortex_size_t nh_diameter, const wide_mask_t* full_mask) {
+    cortex_size_t nh_radius = cortex->nh_radius;
+    if (cortex->wrapped ||
+        (x >= nh_radius && x < cortex->width - nh_radius && y >= nh_radius && y < cortex->height - nh_radius)) {
+        return *full_mask;
+    }
+
+    // Columns of the neighborhood falling inside the cortex, as a single row mask.
+    nh_mask_t row_mask = 0x00U;
+    for (cortex_size_t i = 0; i < nh_diameter; i++) {
+        cortex_size_t neighbor_x = x + (i - nh_radius);
+        if (neighbor_x >= 0 && neighbor_x < cortex->width) {
+            row_mask |= 0x01UL << i;
+        }
+    }
+
+    wide_mask_t result = {{0x00U}};
+    for (cortex_size_t j = 0; j < nh_diameter; j++) {
+        cortex_size_t neighbor_y = y + (j - nh_radius);
+        if (neighbor_y >= 0 && neighbor_y < cortex->height) {
+            wide_mask_or_bits(&result, j * nh_diameter, row_mask);
+        }
+    }
+
+    // Drop the central neuron.
+    #pragma omp simd
+    for (cortex_size_t w = 0; w < NH_MASK_WORDS_MAX; w++) {
+        result.words[w] &= full_mask->words[w];
+    }
+
+    return result;
+}
+
+// Gathers the active bits of the neighborhood of (x, y) into a wide mask, see c2d_active_map_gather.
+static inline wide_mask_t c2d_active_map_gather_wide(const active_map_t* map, cortex_size_t x, cortex_size_t y, cortex_size_t nh_diameter) {
+    nh_mask_t row_mask = (0x01UL << nh_diameter) - 1;
+    wide_mask_t result = {{0x00U}};
+
+    for (cortex_size_t j = 0; j < nh_diameter; j++) {
+        const uint64_t* row = map->words + (size_t) (y - map->y0 + j) * map->row_words + x / 64;
+        cortex_size_t offset = x % 64;
+        uint64_t bits = offset ? (row[0] >> offset) | (row[1] << (64 - offset)) : row[0];
+        wide_mask_or_bits(&result, j * nh_diameter, bits & row_mask);
+    }
 
-                    // Shift the masks to check for the next neighbor.
-                    prev_ac_mask >>= 0x01U;
-                    prev_exc_mask >>= 0x01U;
-                    prev_str_mask_a >>= 0x01U;
-                    prev_str_mask_b >>= 0x01U;
-                    prev_str_mask_c >>= 0x01U;
+    return result;
+}
+
+// Integrates a neuron of a wide cortex by only visiting its active synapses, in neighborhood order, see c2d_integrate_neuron.
+static inline void c2d_integrate_neuron_wide(cortex2d_t* prev_cortex,
+                                             const wide_synapses_t* synapses,
+                                             neuron_t* next_neuron,
+                                             const nh_source_t* source,
+                                             const wide_mask_t* valid_mask) {
+    for (cortex_size_t w = 0; w < NH_MASK_WORDS_MAX; w++) {
+        for (nh_mask_t bits = synapses->synac_mask.words[w] & valid_mask->words[w]; bits; bits &= bits - 1) {
+            cortex_size_t b = __builtin_ctzll(bits);
+            neuron_value_t neighbor_value = *((const neuron_value_t*) (source->values + (size_t) (source->index + source->offsets[w * 64 + b]) * source->stride));
+
+            if (neighbor_value > prev_cortex->fire_threshold) {
+                // Compute the current synapse strength.
+                syn_strength_t syn_strength = ((synapses->synstr_mask_a.words[w] >> b) & 0x01U) |
+                                              (((synapses->synstr_mask_b.words[w] >> b) & 0x01U) << 0x01U) |
+                                              (((synapses->synstr_mask_c.words[w] >> b) & 0x01U) << 0x02U);
+                neuron_value_t neighbor_influence = ((synapses->synex_mask.words[w] >> b) & 0x01U ? prev_cortex->exc_value : -prev_cortex->exc_value) * ((syn_strength / 4) + 1);
+                if (next_neuron->value + neighbor_influence < prev_cortex->recovery_value) {
+                    next_neuron->value = prev_cortex->recovery_value;
+                } else {
+                    next_neuron->value += neighbor_influence;
+                }
+            }
+        }
+    }
+}
+
+// Performs structural and functional plasticity on a neuron of a wide cortex, see nh_evolve_neuron.
+// Masks are combined a whole wide mask at a time, so that all of their words are processed by the same vector instructions.
+static inline void nh_evolve_neuron_wide(const plasticity_t* plasticity,
+                                         const byte* pulses,
+                                         size_t pulses_stride,
+                                         const cortex_index_t* nh_offsets,
+                                         cortex_index_t pulses_index,
+                                         cortex_size_t nh_size,
+                                         uint64_t rand_index,
+                                         const neuron_t* prev_neuron,
+                                         neuron_t* next_neuron,
+                                         const wide_synapses_t* prev_synapses,
+                                         wide_synapses_t* next_synapses,
+                                         const wide_mask_t* valid_mask,
+                                         const wide_mask_t* active_mask) {
+    nh_mask_t create_enabled = prev_neuron->syn_count < next_neuron->max_syn_count ? ~0x00UL : 0x00U;
+
+    wide_mask_t ac_mask;
+    wide_mask_t create_mask;
+    wide_mask_t delete_mask;
+    wide_mask_t candidates_mask;
+    #pragma omp simd
+    for (cortex_size_t w = 0; w < NH_MASK_WORDS_MAX; w++) {
+        nh_mask_t nonzero = prev_synapses->synstr_mask_a.words[w] | prev_synapses->synstr_mask_b.words[w] | prev_synapses->synstr_mask_c.words[w];
+        ac_mask.words[w] = prev_synapses->synac_mask.words[w] & valid_mask->words[w];
+        create_mask.words[w] = ~prev_synapses->synac_mask.words[w] & active_mask->words[w] & create_enabled;
+        delete_mask.words[w] = ac_mask.words[w] & ~nonzero;
+        candidates_mask.words[w] = create_mask.words[w] | delete_mask.words[w] | (ac_mask.words[w] & (active_mask->words[w] | nonzero));
+    }
+
+    bool_t counter_rand = plasticity->counter_rand;
+    uint64_t rand_key = 0;
+    uint64_t rand_counter = plasticity->rand_counter;
+    // Number of xorshift draws consumed so far, see nh_evolve_neuron.
+    cortex_size_t rand_draws = 0;
+    // Number of valid neighbors in the words before the current one.
+    cortex_size_t valid_before = 0;
+
+    // Changes are collected over the whole neighborhood and applied at the end: decisions only depend on the previous state.
+    wide_mask_t created_mask = {{0x00U}};
+    wide_mask_t excitatory_mask = {{0x00U}};
+    wide_mask_t deleted_mask = {{0x00U}};
+    wide_mask_t inc_mask = {{0x00U}};
+    wide_mask_t dec_mask = {{0x00U}};
+
+    // Counter-based random numbers for dense neighborhoods are generated all at once, in a vectorizable loop.
+    chance_t randoms[NH_MASK_WORDS_MAX * 64];
+    bool_t bulk_rand = FALSE;
+    if (counter_rand) {
+        rand_key = squares_key(plasticity->rand_seed, rand_index);
+        bulk_rand = 2 * wide_mask_popcount(&candidates_mask) > nh_size;
+        if (bulk_rand) {
+            #pragma omp simd
+            for (cortex_size_t k = 0; k < nh_size; k++) {
+                randoms[k] = squares32(rand_counter | (uint64_t) k, rand_key) % 0xFFFFU;
+            }
+        }
+    }
+
+    for (cortex_size_t w = 0; w < NH_MASK_WORDS_MAX; w++) {
+        for (nh_mask_t bits = candidates_mask.words[w]; bits; bits &= bits - 1) {
+            cortex_size_t b = __builtin_ctzll(bits);
+            cortex_size_t k = w * 64 + b;
+            nh_mask_t nh_bit = 0x01UL << b;
+            spikes_count_t neighbor_pulse = *((const spikes_count_t*) (pulses + (size_t) (pulses_index + nh_offsets[k]) * pulses_stride));
+
+            // Pick a random number for the neighbor, capped to the max uint16 value.
+            chance_t random;
+            if (counter_rand) {
+                random = bulk_rand ? randoms[k] : squares32(rand_counter | (uint64_t) k, rand_key) % 0xFFFFU;
+            } else {
+                // Catch up with the draws of all valid neighbors up to the current one.
+                cortex_size_t draws = valid_before + __builtin_popcountll(valid_mask->words[w] & ((nh_bit << 1) - 1));
+                for (; rand_draws < draws; rand_draws++) {
+                    next_neuron->rand_state = xorshf32(next_neuron->rand_state);
+                }
+                random = next_neuron->rand_state % 0xFFFFU;
+            }
+
+            // Compute the current synapse strength.
+            syn_strength_t syn_strength = ((prev_synapses->synstr_mask_a.words[w] >> b) & 0x01U) |
+                                          (((prev_synapses->synstr_mask_b.words[w] >> b) & 0x01U) << 0x01U) |
+                                          (((prev_synapses->synstr_mask_c.words[w] >> b) & 0x01U) << 0x02U);
+
+            // Inverse of the current synapse strength, useful when computing depression probability (synapse deletion and weakening).
+            syn_strength_t strength_diff = MAX_SYN_STRENGTH - syn_strength;
+
+            // Structural plasticity: create or destroy a synapse.
+            if ((create_mask.words[w] & nh_bit) &&
+                random < plasticity->syngen_chance * (chance_t) neighbor_pulse) {
+                created_mask.words[w] |= nh_bit;
+
+                // Define whether the new synapse is excitatory or inhibitory.
+                if (random % plasticity->inhexc_range >= next_neuron->inhexc_ratio) {
+                    excitatory_mask.words[w] |= nh_bit;
+                }
+            } else if ((delete_mask.words[w] & nh_bit) &&
+                       random < plasticity->syngen_chance / (neighbor_pulse + 1)) {
+                deleted_mask.words[w] |= nh_bit;
+            }
+
+            // Functional plasticity: strengthen or weaken a synapse.
+            if (ac_mask.words[w] & nh_bit) {
+                if (syn_strength < MAX_SYN_STRENGTH &&
+                    prev_neuron->tot_syn_strength < plasticity->max_tot_strength &&
+                    random < plasticity->synstr_chance * (chance_t) neighbor_pulse * (chance_t) strength_diff) {
+                    inc_mask.words[w] |= nh_bit;
+                } else if (syn_strength > 0x00U &&
+                           random < plasticity->synstr_chance / (neighbor_pulse + syn_strength + 1)) {
+                    dec_mask.words[w] |= nh_bit;
                 }
             }
+        }
+
+        valid_before += __builtin_popcountll(valid_mask->words[w]);
+    }
+
+    // Apply all changes at once, see nh_evolve_neuron: new synapses start with strength 0, while strengths are updated as
+    // bit-sliced 3-bit additions and subtractions across the strength planes.
+    #pragma omp simd
+    for (cortex_size_t w = 0; w < NH_MASK_WORDS_MAX; w++) {
+        nh_mask_t created = created_mask.words[w];
+        next_synapses->synac_mask.words[w] = (next_synapses->synac_mask.words[w] | created) & ~deleted_mask.words[w];
+        next_synapses->synex_mask.words[w] = (next_synapses->synex_mask.words[w] & ~created) | excitatory_mask.words[w];
+
+        nh_mask_t str_a = next_synapses->synstr_mask_a.words[w] & ~created;
+        nh_mask_t str_b = next_synapses->synstr_mask_b.words[w] & ~created;
+        nh_mask_t str_c = next_synapses->synstr_mask_c.words[w] & ~created;
+        nh_mask_t inc = inc_mask.words[w];
+        nh_mask_t dec = dec_mask.words[w];
+
+        // Ripple carry (increments) and borrow (decrements) from plane a to plane c.
+        nh_mask_t carry_a = (str_a & inc) | (~str_a & dec);
+        nh_mask_t carry_b = (str_b & carry_a & inc) | (~str_b & carry_a & dec);
+
+        next_synapses->synstr_mask_a.words[w] = str_a ^ (inc | dec);
+        next_synapses->synstr_mask_b.words[w] = str_b ^ carry_a;
+        next_synapses->synstr_mask_c.words[w] = str_c ^ carry_b;
+    }
+    next_neuron->syn_count += wide_mask_popcount(&created_mask);
+    next_neuron->syn_count -= wide_mask_popcount(&deleted_mask);
+    next_neuron->tot_syn_strength += wide_mask_popcount(&inc_mask);
+    next_neuron->tot_syn_strength -= wide_mask_popcount(&dec_mask);
+
+    if (!counter_rand) {
+        // Consume the draws of the remaining valid neighbors.
+        for (; rand_draws < valid_before; rand_draws++) {
+            next_neuron->rand_state = xorshf32(next_neuron->rand_state);
+        }
+    }
+}
+
+// Integrates the neuron at (x, y) of a wide cortex and evolves it if required, reading its synapses from the previous cortex and
+// writing them to the next one.
+static inline void c2d_tick_neuron_wide(cortex2d_t* prev_cortex,
+                                        cortex2d_t* next_cortex,
+                                        const neuron_t* prev_neuron,
+                                        neuron_t* next_neuron,
+                                        cortex_index_t neuron_index,
+                                        uint64_t rand_index,
+                                        cortex_size_t x,
+                                        cortex_size_t y,
+                                        cortex_size_t nh_diameter,
+                                        const nh_source_t* source,
+                                        const wide_mask_t* full_mask,
+                                        const plasticity_t* plasticity,
+                                        const active_map_t* active_map,
+                                        bool_t evolve) {
+    const wide_synapses_t* prev_synapses = &(prev_cortex->wide_synapses[neuron_index]);
+    wide_synapses_t* next_synapses = &(next_cortex->wide_synapses[neuron_index]);
+    *next_synapses = *prev_synapses;
+
+    // Neighborhood positions falling inside the cortex.
+    wide_mask_t valid_mask = c2d_nh_valid_wide(prev_cortex, x, y, nh_diameter, full_mask);
+
+    // Increment the current neuron value by reading its connected neighbors.
+    c2d_integrate_neuron_wide(prev_cortex, prev_synapses, next_neuron, source, &valid_mask);
+
+    if (evolve) {
+        wide_mask_t active_mask = valid_mask;
+        if (active_map->words != NULL) {
+            active_mask = c2d_active_map_gather_wide(active_map, x, y, nh_diameter);
+            #pragma omp simd
+            for (cortex_size_t w = 0; w < NH_MASK_WORDS_MAX; w++) {
+                active_mask.words[w] &= valid_mask.words[w];
+            }
+        }
+        nh_evolve_neuron_wide(plasticity,
+                              source->pulses,
+                              source->stride,
+                              source->offsets,
+                              source->index,
+                              nh_diameter * nh_diameter,
+                              rand_index,
+                              prev_neuron,
+                              next_neuron,
+                              prev_synapses,
+                              next_synapses,
+                              &valid_mask,
+                              &active_mask);
+    } else if (!plasticity->counter_rand) {
+        // Sequential random numbers are drawn for every valid neighbor at every tick, whether evolving or not.
+        for (cortex_size_t k = wide_mask_popcount(&valid_mask); k > 0; k--) {
+            next_neuron->rand_state = xorshf32(next_neuron->rand_state);
+        }
+    }
+}
+
+// Computes the offset of each neighborhood position from the neuron at position m (in Morton order) of its tile, for tiled
+// cortices of the given width. Tiles are all laid out the same way, so offsets only depend on the position inside the tile.
+static inline void c2d_tile_offsets(cortex_index_t* nh_offsets, cortex_size_t width, nh_radius_t nh_radius, cortex_size_t m) {
+    cortex_size_t nh_diameter = NH_DIAM_2D(nh_radius);
+
+    // Any tile far enough from the edges will do, radii never exceed a tile side.
+    cortex_size_t x = TILE_SIDE_2D + MORTON_COMPACT_3(m);
+    cortex_size_t y = TILE_SIDE_2D + MORTON_COMPACT_3(m >> 1);
+    for (cortex_size_t k = 0; k < nh_diameter * nh_diameter; k++) {
+        nh_offsets[k] = TILED_IDX2D(x + k % nh_diameter - nh_radius, y + k / nh_diameter - nh_radius, width) -
+                        TILED_IDX2D(x, y, width);
+    }
+}
+
+// State shared by all neurons during a tick.
+typedef struct c2d_tick_state_t {
+    cortex2d_t* prev_cortex;
+    cortex2d_t* next_cortex;
+    plasticity_t plasticity;
+    active_map_t active_map;
+    ghost_border_t ghost_border;
+    wide_mask_t full_mask;
+    cortex_size_t nh_diameter;
+    cortex_size_t nh_size;
+    // Neighbor offsets in row-major order.
+    cortex_index_t nh_offsets[NH_MASK_WORDS_MAX * 64];
+    // Neighbor offsets of each position in a tile, only for tiled cortices. NULL if they couldn't be allocated.
+    cortex_index_t* tile_offsets;
+    // Position of the cortex in a bigger one it's a part of, if any (see dom2d_t): neurons draw random numbers and evolve according to
+    // their coordinates in the latter, so that they behave the same in both.
+    cortex_size_t origin_x;
+    cortex_size_t origin_y;
+    cortex_size_t outer_width;
+    evol_step_t evol_period;
+    evol_step_t evol_phase;
+    bool_t evolve;
+    bool_t amortized;
+    bool_t counter_rand;
+    bool_t wide;
+    bool_t wrapped;
+    bool_t tiled;
+} c2d_tick_state_t;
+
+// Returns the neighbor offsets of the neuron at position m of its tile, computing them in local_offsets if they're not cached.
+static inline const cortex_index_t* c2d_tick_tile_offsets(const c2d_tick_state_t* state, cortex_size_t m, cortex_index_t* local_offsets) {
+    if (state->tile_offsets != NULL) {
+        return &(state->tile_offsets[m * state->nh_size]);
+    }
+    c2d_tile_offsets(local_offsets, state->prev_cortex->width, state->prev_cortex->nh_radius, m);
+    return local_offsets;
+}
+
+// Ticks the neuron at (x, y), stored at neuron_index, reading its neighbors from the given source.
+static inline void c2d_tick_neuron(const c2d_tick_state_t* state,
+                                   cortex_size_t x,
+                                   cortex_size_t y,
+                                   cortex_index_t neuron_index,
+                                   nh_source_t source) {
+    cortex2d_t* prev_cortex = state->prev_cortex;
+    cortex2d_t* next_cortex = state->next_cortex;
+    cortex_size_t nh_diameter = state->nh_diameter;
+
+    // Retrieve the involved neurons.
+    neuron_t prev_neuron = prev_cortex->neurons[neuron_index];
+    neuron_t* next_neuron = &(next_cortex->neurons[neuron_index]);
+
+    // Copy prev neuron values to the new one.
+    *next_neuron = prev_neuron;
+
+    // Random streams are keyed by position rather than by storage, so that results don't depend on the neurons order.
+    cortex_size_t outer_x = x + state->origin_x;
+    cortex_size_t outer_y = y + state->origin_y;
+    uint64_t rand_index = (uint64_t) IDX2D(outer_x, outer_y, state->outer_width);
+
+    bool_t neuron_evolve = state->amortized ?
+                           c2d_evol_group(prev_cortex->evol_mode, outer_x, outer_y, state->outer_width, state->evol_period) == state->evol_phase :
+                           state->evolve;
+
+    // Edge neurons of wrapped cortices read their neighbors from ghosts instead.
+    if (state->wrapped) {
+        c2d_ghost_source(&(state->ghost_border), prev_cortex, x, y, &source);
+    }
+
+    if (state->wide) {
+        c2d_tick_neuron_wide(prev_cortex,
+                             next_cortex,
+                             &prev_neuron,
+                             next_neuron,
+                             neuron_index,
+                             rand_index,
+                             x,
+                             y,
+                             nh_diameter,
+                             &source,
+                             &(state->full_mask),
+                             &(state->plasticity),
+                             &(state->active_map),
+                             neuron_evolve);
+    } else {
+        // Neighborhood positions falling inside the cortex.
+        nh_mask_t valid_mask = state->wrapped ? state->full_mask.words[0] : c2d_nh_valid_mask(prev_cortex, x, y, nh_diameter);
+
+        // Increment the current neuron value by reading its connected neighbors.
+        c2d_integrate_neuron(prev_cortex, &prev_neuron, next_neuron, &source, valid_mask);
 
-            // Push to equilibrium by decaying to zero, both from above and below.
-            if (prev_neuron.value > 0x00) {
-                next_neuron->value -= next_cortex->decay_value;
-            } else if (prev_neuron.value < 0x00) {
-                next_neuron->value += next_cortex->decay_value;
+        // Perform the evolution phase if allowed.
+        if (neuron_evolve) {
+            nh_mask_t active_mask = state->active_map.words != NULL ?
+                                    c2d_active_map_gather(&(state->active_map), x, y, nh_diameter) & valid_mask :
+                                    valid_mask;
+            nh_evolve_neuron(&(state->plasticity),
+                             source.pulses,
+                             source.stride,
+                             source.offsets,
+                             source.index,
+                             nh_diameter * nh_diameter,
+                             rand_index,
+                             &prev_neuron,
+                             next_neuron,
+                             valid_mask,
+                             active_mask);
+        } else if (!state->counter_rand) {
+            // Sequential random numbers are drawn for every valid neighbor at every tick, whether evolving or not.
+            for (cortex_size_t k = __builtin_popcountll(valid_mask); k > 0; k--) {
+                next_neuron->rand_state = xorshf32(next_neuron->rand_state);
             }
+        }
+    }
+
+    // Push to equilibrium by decaying to zero, both from above and below.
+    if (prev_neuron.value > 0x00) {
+        next_neuron->value -= next_cortex->decay_value;
+    } else if (prev_neuron.value < 0x00) {
+        next_neuron->value += next_cortex->decay_value;
+    }
+
+    if ((prev_neuron.pulse_mask >> prev_cortex->pulse_window) & 0x01U) {
+        // Decrease pulse if the oldest recorded pulse is active.
+        next_neuron->pulse--;
+    }
+
+    next_neuron->pulse_mask <<= 0x01U;
+
+    // Bring the neuron back to recovery if it just fired, otherwise fire it if its value is over its threshold.
+    if (prev_neuron.value > prev_cortex->fire_threshold + prev_neuron.pulse) {
+        // Fired at the previous step.
+        next_neuron->value = next_cortex->recovery_value;
+
+        // Store pulse.
+        next_neuron->pulse_mask |= 0x01U;
+        next_neuron->pulse++;
+    }
+}
+
+// Prepares the state shared by all neurons when ticking rows [y0, y1) of prev_cortex into next_cortex, which may be the same.
+// Fails with ERROR_CORTEX_UNALLOC if prev_cortex is wrapped without a ghost border, in which case no buffer is held by the state.
+static error_code_t c2d_tick_state_init(c2d_tick_state_t* state, cortex2d_t* prev_cortex, cortex2d_t* next_cortex, cortex_size_t y0, cortex_size_t y1) {
+    // Wrapped cortices can't be ticked as bounded ones, which would silently give different results.
+    if (prev_cortex->wrapped && prev_cortex->ghosts == NULL) {
+        return ERROR_CORTEX_UNALLOC;
+    }
+
+    state->prev_cortex = prev_cortex;
+    state->next_cortex = next_cortex;
+    state->origin_x = 0;
+    state->origin_y = 0;
+    state->outer_width = prev_cortex->width;
+
+    // Defines whether to evolve or not.
+    // evol_step is incremented by 1 to account for edge cases and human readable behavior:
+    // 0x0000 -> 0 + 1 = 1, so the cortex evolves at every tick, meaning that there are no free ticks between evolutions.
+    // 0xFFFF -> 65535 + 1 = 65536, so the cortex never evolves, meaning that there is an infinite amount of ticks between evolutions.
+    state->evol_period = ((evol_step_t) prev_cortex->evol_step) + 1;
+    state->evol_phase = prev_cortex->ticks_count % state->evol_period;
+    state->evolve = state->evol_phase == 0;
+    // Amortized evolution: every tick evolves the group of neurons matching the current phase.
+    state->amortized = prev_cortex->evol_mode != EVOL_MODE_FULL;
+    state->counter_rand = prev_cortex->rand_mode == RAND_MODE_COUNTER;
+
+    // Build the active neurons bitmap if any neuron is going to evolve.
+    // If the bitmap can't be allocated, all neighbors are considered active: evolution is slower, but the result is the same.
+    state->active_map = (active_map_t) {NULL, 0, 0};
+    if (state->evolve || state->amortized) {
+        c2d_active_map_init(prev_cortex, &(state->active_map), y0, y1);
+    }
+
+    /* Compute the neighborhood diameter:
+           d = 7
+      <------------->
+       r = 3
+      <----->
+      +-|-|-|-|-|-|-+
+      |             |
+      |             |
+      |      X      |
+      |             |
+      |             |
+      +-|-|-|-|-|-|-+
+    */
+    state->nh_diameter = NH_DIAM_2D(prev_cortex->nh_radius);
+    state->nh_size = state->nh_diameter * state->nh_diameter;
+
+    state->plasticity = c2d_plasticity(prev_cortex);
+    c2d_nh_offsets(state->nh_offsets, prev_cortex->width, prev_cortex->nh_radius);
+
+    // Wide cortices keep their synapses aside, in wide masks.
+    state->wide = prev_cortex->wide_synapses != NULL;
+    state->full_mask = c2d_wide_full_mask(state->nh_diameter);
 
-            if ((prev_neuron.pulse_mask >> prev_cortex->pulse_window) & 0x01U) {
-                // Decrease pulse if the oldest recorded pulse is active.
-                next_neuron->pulse--;
+    // Edge neurons of wrapped cortices read their neighbors from a ghost border, while all of their neighborhood positions are valid.
+    state->wrapped = prev_cortex->wrapped;
+    if (state->wrapped) {
+        c2d_ghost_border_update(prev_cortex, &(state->ghost_border), y0, y1);
+    }
+
+    // Tiled cortices are ticked in storage order, one tile at a time: neighbor offsets then depend on the position inside the tile.
+    // If the offsets can't be allocated, each neuron computes its own: ticks are slower, but the result is the same.
+    state->tiled = prev_cortex->neurons_order == NEURONS_ORDER_TILED;
+    state->tile_offsets = NULL;
+    if (state->tiled) {
+        state->tile_offsets = (cortex_index_t*) malloc(TILE_SIZE_2D * state->nh_size * sizeof(cortex_index_t));
+        if (state->tile_offsets != NULL) {
+            for (cortex_size_t m = 0; m < TILE_SIZE_2D; m++) {
+                c2d_tile_offsets(&(state->tile_offsets[m * state->nh_size]), prev_cortex->width, prev_cortex->nh_radius, m);
             }
+        }
+    }
+
+    return ERROR_NONE;
+}
+
+// Releases the buffers held by the given tick state.
+static void c2d_tick_state_free(c2d_tick_state_t* state) {
+    free(state->tile_offsets);
+    free(state->active_map.words);
+}
 
-            next_neuron->pulse_mask <<= 0x01U;
+// Returns whether any neuron of the given cortex evolves during its next tick.
+static inline bool_t c2d_evolves(cortex2d_t* cortex) {
+    return cortex->evol_mode != EVOL_MODE_FULL || cortex->ticks_count % (((evol_step_t) cortex->evol_step) + 1) == 0;
+}
+
+// Ticks the neurons in rows [y0, y1) only, reading rows [y0 - nh_radius, y1 + nh_radius) of the previous cortex.
+// Ticks and evolutions counts are left untouched, so that a full tick can be performed as a sequence of bands.
+static error_code_t c2d_tick_rows(cortex2d_t* prev_cortex, cortex2d_t* next_cortex, cortex_size_t y0, cortex_size_t y1) {
+    c2d_tick_state_t state;
+    error_code_t error = c2d_tick_state_init(&state, prev_cortex, next_cortex, y0, y1);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+    prof_phase_t prof_phase = state.evolve || state.amortized ? PROF_PHASE_EVOLVE : PROF_PHASE_INTEGRATE;
+
+    #pragma omp parallel
+    {
+        // Each thread traces its own share of work, so that load imbalance shows up in traces.
+        uint64_t prof_thread_start = prof_span_begin();
 
-            // Bring the neuron back to recovery if it just fired, otherwise fire it if its value is over its threshold.
-            if (prev_neuron.value > prev_cortex->fire_threshold + prev_neuron.pulse) {
-                // Fired at the previous step.
-                next_neuron->value = next_cortex->recovery_value;
+        if (state.tiled) {
+            cortex_size_t tiles_x = prev_cortex->width / TILE_SIDE_2D;
+
+            #pragma omp for collapse(2) nowait
+            for (cortex_size_t tile_y = y0 / TILE_SIDE_2D; tile_y < (y1 + TILE_SIDE_2D - 1) / TILE_SIDE_2D; tile_y++) {
+                for (cortex_size_t tile_x = 0; tile_x < tiles_x; tile_x++) {
+                    cortex_index_t tile_index = IDX2D(tile_x, tile_y, tiles_x) * TILE_SIZE_2D;
+                    cortex_index_t local_offsets[NH_MASK_WORDS_MAX * 64];
+
+                    for (cortex_size_t m = 0; m < TILE_SIZE_2D; m++) {
+                        cortex_size_t x = tile_x * TILE_SIDE_2D + MORTON_COMPACT_3(m);
+                        cortex_size_t y = tile_y * TILE_SIDE_2D + MORTON_COMPACT_3(m >> 1);
+
+                        // Bands of rows don't need to be aligned to tiles.
+                        if (y < y0 || y >= y1) {
+                            continue;
+                        }
 
-                // Store pulse.
-                next_neuron->pulse_mask |= 0x01U;
-                next_neuron->pulse++;
+                        nh_source_t source = {
+                            (const byte*) &(prev_cortex->neurons[0].value),
+                            (const byte*) &(prev_cortex->neurons[0].pulse),
+                            sizeof(neuron_t),
+                            c2d_tick_tile_offsets(&state, m, local_offsets),
+                            tile_index + m
+                        };
+                        c2d_tick_neuron(&state, x, y, tile_index + m, source);
+                    }
+                }
+            }
+        } else {
+            #pragma omp for collapse(2) nowait
+            for (cortex_size_t y = y0; y < y1; y++) {
+                for (cortex_size_t x = 0; x < prev_cortex->width; x++) {
+                    cortex_index_t neuron_index = IDX2D(x, y, prev_cortex->width);
+                    nh_source_t source = {
+                        (const byte*) &(prev_cortex->neurons[0].value),
+                        (const byte*) &(prev_cortex->neurons[0].pulse),
+                        sizeof(neuron_t),
+                        state.nh_offsets,
+                        neuron_index
+                    };
+                    c2d_tick_neuron(&state, x, y, neuron_index, source);
+                }
             }
         }
+
+        prof_trace_end(prof_phase, prof_thread_start);
+    }
+
+    c2d_tick_state_free(&state);
+
+    return ERROR_NONE;
+}
+
+error_code_t c2d_tick(cortex2d_t* prev_cortex, cortex2d_t* next_cortex) {
+    bool_t evolves = c2d_evolves(prev_cortex);
+    prof_phase_t prof_phase = evolves ? PROF_PHASE_EVOLVE : PROF_PHASE_INTEGRATE;
+    uint64_t prof_start = prof_span_begin();
+
+    error_code_t error = c2d_tick_rows(prev_cortex, next_cortex, 0, prev_cortex->height);
+    if (error != ERROR_NONE) {
+        return error;
     }
 
+    if (evolves) {
+        // Increment evolutions count.
+        next_cortex->evols_count++;
+    }
     next_cortex->ticks_count++;
+    next_cortex->rand_ticks_count++;
+
+    prof_span_end(prof_phase, prof_start);
+
+    return ERROR_NONE;
+}
+
+error_code_t c2d_pair_tick(c2d_pair_t* pair) {
+    error_code_t error = c2d_tick(c2d_pair_current(pair), c2d_pair_next(pair));
+    if (error != ERROR_NONE) {
+        return error;
+    }
+    c2d_pair_swap(pair);
+
+    return ERROR_NONE;
+}
+
+// Copies the state neighbors read from count consecutive neurons to as many ghosts.
+static inline void c2d_ghosts_store(ghost_t* ghosts, const neuron_t* neurons, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        ghosts[i].value = neurons[i].value;
+        ghosts[i].pulse = neurons[i].pulse;
+    }
+}
+
+// Returns the first slot of the given stripe, of stripe_size neurons, in an in-place tick window. Its second slot follows window_stripes stripes later.
+static inline ghost_t* c2d_window_slot(ghost_t* window, cortex_size_t window_stripes, cortex_size_t stripe_size, cortex_size_t stripe) {
+    return &(window[(size_t) WRAP(stripe, window_stripes) * stripe_size]);
+}
+
+// Stores the previous state of the given stripe in both of its slots of an in-place tick window, reading it from the stripe's neurons.
+static inline void c2d_window_store_neurons(ghost_t* window,
+                                            cortex_size_t window_stripes,
+                                            cortex_size_t stripe_size,
+                                            cortex_size_t stripe,
+                                            const neuron_t* neurons) {
+    ghost_t* slot = c2d_window_slot(window, window_stripes, stripe_size, stripe);
+    c2d_ghosts_store(slot, neurons, stripe_size);
+    memcpy(&(slot[(size_t) window_stripes * stripe_size]), slot, stripe_size * sizeof(ghost_t));
+}
+
+// Stores the previous state of the given stripe in both of its slots of an in-place tick window, reading it from its previously saved ghosts.
+static inline void c2d_window_store_ghosts(ghost_t* window,
+                                           cortex_size_t window_stripes,
+                                           cortex_size_t stripe_size,
+                                           cortex_size_t stripe,
+                                           const ghost_t* ghosts) {
+    ghost_t* slot = c2d_window_slot(window, window_stripes, stripe_size, stripe);
+    memcpy(slot, ghosts, stripe_size * sizeof(ghost_t));
+    memcpy(&(slot[(size_t) window_stripes * stripe_size]), slot, stripe_size * sizeof(ghost_t));
+}
+
+error_code_t c2d_tick_inplace(cortex2d_t* cortex) {
+    bool_t evolves = c2d_evolves(cortex);
+    prof_phase_t prof_phase = evolves ? PROF_PHASE_EVOLVE : PROF_PHASE_INTEGRATE;
+    uint64_t prof_start = prof_span_begin();
+
+    // Neurons are ticked one stripe at a time, in storage order: a stripe is a row, or a row of tiles for tiled cortices.
+    // All neighbors of a stripe lie within stripes_radius stripes from it.
+    bool_t tiled = cortex->neurons_order == NEURONS_ORDER_TILED;
+    cortex_size_t stripe_rows = tiled ? TILE_SIDE_2D : 1;
+    cortex_size_t stripe_size = stripe_rows * cortex->width;
+    cortex_size_t stripes_count = cortex->height / stripe_rows;
+    cortex_size_t stripes_radius = (cortex->nh_radius + stripe_rows - 1) / stripe_rows;
+    cortex_size_t window_stripes = 2 * stripes_radius + 1;
+
+    // Each band of stripes keeps the previous state of the stripes its neighbors are read from in a rolling window.
+    // Windows are stored twice in a row, so that the stripes read by any stripe are always contiguous and neighbor offsets still apply.
+    // The stripes following a band are saved separately, before the next band overwrites them.
+    int bands_count = omp_get_max_threads();
+    size_t band_size = (size_t) (2 * window_stripes + stripes_radius) * stripe_size;
+    ghost_t* windows = (ghost_t*) malloc(bands_count * band_size * sizeof(ghost_t));
+    if (windows == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    c2d_tick_state_t state;
+    error_code_t error = c2d_tick_state_init(&state, cortex, cortex, 0, cortex->height);
+    if (error != ERROR_NONE) {
+        free(windows);
+        return error;
+    }
+
+    #pragma omp parallel
+    {
+        uint64_t prof_thread_start = prof_span_begin();
+
+        int band = omp_get_thread_num();
+        int bands = omp_get_num_threads();
+        cortex_size_t s0 = (cortex_size_t) ((int64_t) stripes_count * band / bands);
+        cortex_size_t s1 = (cortex_size_t) ((int64_t) stripes_count * (band + 1) / bands);
+        ghost_t* window = &(windows[band * band_size]);
+        ghost_t* following = &(window[(size_t) 2 * window_stripes * stripe_size]);
+
+        // Save all stripes read by the band but owned by other ones before any neuron is overwritten, along with its first ones.
+        if (s0 < s1) {
+            for (cortex_size_t s = s0 - stripes_radius; s < s0 + stripes_radius; s++) {
+                if (s >= 0 && s < stripes_count) {
+                    c2d_window_store_neurons(window, window_stripes, stripe_size, s, &(cortex->neurons[(size_t) s * stripe_size]));
+                }
+            }
+            for (cortex_size_t s = s1; s < s1 + stripes_radius && s < stripes_count; s++) {
+                c2d_ghosts_store(&(following[(size_t) (s - s1) * stripe_size]), &(cortex->neurons[(size_t) s * stripe_size]), stripe_size);
+            }
+        }
+
+        #pragma omp barrier
+
+        cortex_index_t local_offsets[NH_MASK_WORDS_MAX * 64];
+        for (cortex_size_t s = s0; s < s1; s++) {
+            // The last stripe read by the current one takes the place of the first one read by the previous one.
+            cortex_size_t last = s + stripes_radius;
+            if (last < s1) {
+                c2d_window_store_neurons(window, window_stripes, stripe_size, last, &(cortex->neurons[(size_t) last * stripe_size]));
+            } else if (last < stripes_count) {
+                c2d_window_store_ghosts(window, window_stripes, stripe_size, last, &(following[(size_t) (last - s1) * stripe_size]));
+            }
+
+            // Index of the current stripe's first neuron in the window.
+            cortex_index_t window_index = (cortex_index_t) (WRAP(s - stripes_radius, window_stripes) + stripes_radius) * stripe_size;
+
+            for (cortex_size_t i = 0; i < stripe_size; i++) {
+                cortex_size_t x = i;
+                cortex_size_t y = s;
+                const cortex_index_t* offsets = state.nh_offsets;
+                if (tiled) {
+                    cortex_size_t m = i % TILE_SIZE_2D;
+                    x = (i / TILE_SIZE_2D) * TILE_SIDE_2D + MORTON_COMPACT_3(m);
+                    y = s * TILE_SIDE_2D + MORTON_COMPACT_3(m >> 1);
+                    offsets = c2d_tick_tile_offsets(&state, m, local_offsets);
+                }
+
+                nh_source_t source = {
+                    (const byte*) &(window[0].value),
+                    (const byte*) &(window[0].pulse),
+                    sizeof(ghost_t),
+                    offsets,
+                    window_index + i
+                };
+                c2d_tick_neuron(&state, x, y, (cortex_index_t) s * stripe_size + i, source);
+            }
+        }
+
+        prof_trace_end(prof_phase, prof_thread_start);
+    }
+
+    c2d_tick_state_free(&state);
+    free(windows);
+
+    if (evolves) {
+        // Increment evolutions count.
+        cortex->evols_count++;
+    }
+    cortex->ticks_count++;
+    cortex->rand_ticks_count++;
+
+    prof_span_end(prof_phase, prof_start);
+
+    return ERROR_NONE;
+}
+
+// Hints the kernel about the rows [y0, y1) of the given out-of-core cortex view: they're either about to be read, or done with.
+// Rows being read are widened to whole pages, while released rows are narrowed, so that pages shared with other rows are not dropped.
+static void ooc2d_advise_rows(ooc2d_t* ooc, cortex2d_t* view, cortex_size_t y0, cortex_size_t y1, bool_t release) {
+    y0 = y0 > 0 ? y0 : 0;
+    y1 = y1 < view->height ? y1 : view->height;
+    if (y0 >= y1) {
+        return;
+    }
+
+    // Tiled views store rows in whole rows of tiles, which are rounded just like pages.
+    if (view->neurons_order == NEURONS_ORDER_TILED) {
+        if (release) {
+            y0 = (y0 + TILE_SIDE_2D - 1) / TILE_SIDE_2D * TILE_SIDE_2D;
+            y1 = y1 / TILE_SIDE_2D * TILE_SIDE_2D;
+        } else {
+            y0 = y0 / TILE_SIDE_2D * TILE_SIDE_2D;
+            y1 = (y1 + TILE_SIDE_2D - 1) / TILE_SIDE_2D * TILE_SIDE_2D;
+        }
+    }
+
+    size_t start = (size_t) ((byte*) &(view->neurons[IDX2D(0, y0, view->width)]) - ooc->mapping);
+    size_t end = (size_t) ((byte*) &(view->neurons[IDX2D(0, y1, view->width)]) - ooc->mapping);
+    if (release) {
+        start = (start + OOC_ALIGNMENT - 1) / OOC_ALIGNMENT * OOC_ALIGNMENT;
+        end = end / OOC_ALIGNMENT * OOC_ALIGNMENT;
+    } else {
+        start = start / OOC_ALIGNMENT * OOC_ALIGNMENT;
+        end = (end + OOC_ALIGNMENT - 1) / OOC_ALIGNMENT * OOC_ALIGNMENT;
+    }
+    if (start >= end) {
+        return;
+    }
+
+    if (release) {
+        // Unmapping shared file pages is safe: their content stays in the page cache, which is asked to write them back and drop them.
+        madvise(ooc->mapping + start, end - start, MADV_DONTNEED);
+        posix_fadvise(ooc->file, (off_t) start, (off_t) (end - start), POSIX_FADV_DONTNEED);
+    } else {
+        posix_fadvise(ooc->file, (off_t) start, (off_t) (end - start), POSIX_FADV_WILLNEED);
+        madvise(ooc->mapping + start, end - start, MADV_WILLNEED);
+    }
+}
+
+error_code_t ooc2d_tick(ooc2d_t* ooc) {
+    cortex2d_t* prev_cortex = c2d_pair_current(&(ooc->pair));
+    cortex2d_t* next_cortex = c2d_pair_next(&(ooc->pair));
+    cortex_size_t nh_radius = prev_cortex->nh_radius;
+    cortex_size_t band_rows = ooc->band_rows;
+
+    bool_t evolves = c2d_evolves(prev_cortex);
+    prof_phase_t prof_phase = evolves ? PROF_PHASE_EVOLVE : PROF_PHASE_INTEGRATE;
+    uint64_t prof_start = prof_span_begin();
+
+    ooc2d_advise_rows(ooc, prev_cortex, 0, band_rows + nh_radius, FALSE);
+
+    for (cortex_size_t y0 = 0; y0 < prev_cortex->height; y0 += band_rows) {
+        cortex_size_t y1 = y0 + band_rows < prev_cortex->height ? y0 + band_rows : prev_cortex->height;
+
+        // Read ahead the rows needed by the next band.
+        ooc2d_advise_rows(ooc, prev_cortex, y1 + nh_radius, y1 + band_rows + nh_radius, FALSE);
+
+        // Bands share the same state checks, so only the first one can fail, before anything is ticked.
+        error_code_t error = c2d_tick_rows(prev_cortex, next_cortex, y0, y1);
+        if (error != ERROR_NONE) {
+            return error;
+        }
+
+        // Release the previous rows no longer needed by the next bands, as well as the ticked rows.
+        ooc2d_advise_rows(ooc, prev_cortex, y0 - nh_radius, y1 - nh_radius, TRUE);
+        ooc2d_advise_rows(ooc, next_cortex, y0, y1, TRUE);
+    }
+
+    if (evolves) {
+        // Increment evolutions count.
+        next_cortex->evols_count++;
+    }
+    next_cortex->ticks_count++;
+    next_cortex->rand_ticks_count++;
+
+    c2d_pair_swap(&(ooc->pair));
+
+    prof_span_end(prof_phase, prof_start);
+
+    return ERROR_NONE;
+}
+
+// Returns the rank owning the subdomain next to the given one in direction (dx, dy), or -1 if there's none.
+static inline int64_t dom2d_neighbor(dom2d_t* dom, int dx, int dy) {
+    int64_t rank_x = (int64_t) (dom->rank % dom->ranks_x) + dx;
+    int64_t rank_y = (int64_t) (dom->rank / dom->ranks_x) + dy;
+    if (dom->wrapped) {
+        rank_x = WRAP(rank_x, (int64_t) dom->ranks_x);
+        rank_y = WRAP(rank_y, (int64_t) dom->ranks_y);
+    } else if (rank_x < 0 || rank_x >= dom->ranks_x || rank_y < 0 || rank_y >= dom->ranks_y) {
+        return -1;
+    }
+    return rank_y * dom->ranks_x + rank_x;
+}
+
+// Computes the bounds [start, end) along a single axis of the strip of owned neurons on side d (-1, 0 or 1) of the owned range [owned_start, owned_end),
+// or of the halo beyond it.
+static inline void dom2d_strip_bounds(int d, cortex_size_t owned_start, cortex_size_t owned_end, cortex_size_t width, bool_t halo, cortex_size_t* start, cortex_size_t* end) {
+    if (d < 0) {
+        *start = halo ? owned_start - width : owned_start;
+        *end = halo ? owned_start : owned_start + width;
+    } else if (d > 0) {
+        *start = halo ? owned_end : owned_end - width;
+        *end = halo ? owned_end + width : owned_end;
+    } else {
+        *start = owned_start;
+        *end = owned_end;
+    }
+}
+
+// Exchanges the state of the given strip of the local cortex with the halo buffer, either packing it or unpacking it: values first, then pulses.
+// Returns the size of the strip in the buffer.
+static size_t dom2d_strip_copy(dom2d_t* dom, cortex2d_t* cortex, int dx, int dy, bool_t halo) {
+    cortex_size_t x0, x1, y0, y1;
+    dom2d_strip_bounds(dx, dom->halo_left, dom->halo_left + dom->x1 - dom->x0, cortex->nh_radius, halo, &x0, &x1);
+    dom2d_strip_bounds(dy, dom->halo_top, dom->halo_top + dom->y1 - dom->y0, cortex->nh_radius, halo, &y0, &y1);
+
+    size_t count = (size_t) (x1 - x0) * (size_t) (y1 - y0);
+    neuron_value_t* values = (neuron_value_t*) dom->halo_buffer;
+    spikes_count_t* pulses = (spikes_count_t*) (dom->halo_buffer + count * sizeof(neuron_value_t));
+
+    size_t i = 0;
+    for (cortex_size_t y = y0; y < y1; y++) {
+        for (cortex_size_t x = x0; x < x1; x++, i++) {
+            neuron_t* neuron = &(cortex->neurons[IDX2D(x, y, cortex->width)]);
+            if (halo) {
+                neuron->value = values[i];
+                neuron->pulse = pulses[i];
+            } else {
+                values[i] = neuron->value;
+                pulses[i] = neuron->pulse;
+            }
+        }
+    }
+
+    return count * DOM_HALO_NEURON_SIZE;
+}
+
+// Ticks the neurons in the rectangle [x0, x1) x [y0, y1) of a row-major cortex, whose rows must be covered by the given state.
+static void c2d_tick_rect(const c2d_tick_state_t* state, cortex_size_t x0, cortex_size_t x1, cortex_size_t y0, cortex_size_t y1) {
+    cortex2d_t* prev_cortex = state->prev_cortex;
+
+    #pragma omp parallel for collapse(2)
+    for (cortex_size_t y = y0; y < y1; y++) {
+        for (cortex_size_t x = x0; x < x1; x++) {
+            cortex_index_t neuron_index = IDX2D(x, y, prev_cortex->width);
+            nh_source_t source = {
+                (const byte*) &(prev_cortex->neurons[0].value),
+                (const byte*) &(prev_cortex->neurons[0].pulse),
+                sizeof(neuron_t),
+                state->nh_offsets,
+                neuron_index
+            };
+            c2d_tick_neuron(state, x, y, neuron_index, source);
+        }
+    }
+}
+
+void dom2d_feed2d(dom2d_t* dom, input2d_t* input) {
+    uint64_t prof_start = prof_span_begin();
+    cortex2d_t* cortex = dom2d_current(dom);
+
+    // Only the part of the input falling inside the subdomain is fed.
+    cortex_size_t x0 = input->x0 > dom->x0 ? input->x0 : dom->x0;
+    cortex_size_t x1 = input->x1 < dom->x1 ? input->x1 : dom->x1;
+    cortex_size_t y0 = input->y0 > dom->y0 ? input->y0 : dom->y0;
+    cortex_size_t y1 = input->y1 < dom->y1 ? input->y1 : dom->y1;
+
+    #pragma omp parallel for collapse(2)
+    for (cortex_size_t y = y0; y < y1; y++) {
+        for (cortex_size_t x = x0; x < x1; x++) {
+            if (pulse_map(cortex->sample_window,
+                          cortex->ticks_count % cortex->sample_window,
+                          input->values[IDX2D(x - input->x0, y - input->y0, input->x1 - input->x0)],
+                          cortex->pulse_mapping)) {
+                cortex->neurons[IDX2D(x - dom->x0 + dom->halo_left, y - dom->y0 + dom->halo_top, cortex->width)].value += input->exc_value;
+            }
+        }
+    }
+
+    prof_span_end(PROF_PHASE_FEED, prof_start);
+}
+
+error_code_t dom2d_tick(dom2d_t* dom) {
+    cortex2d_t* prev_cortex = c2d_pair_current(dom->pair);
+    cortex2d_t* next_cortex = c2d_pair_next(dom->pair);
+    cortex_size_t nh_radius = prev_cortex->nh_radius;
+
+    // Halos take the place of the local cortex' wrapping, and rectangles are ticked in rows order.
+    if (prev_cortex->wrapped || prev_cortex->neurons_order != NEURONS_ORDER_ROWS) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    bool_t evolves = c2d_evolves(prev_cortex);
+    prof_phase_t prof_phase = evolves ? PROF_PHASE_EVOLVE : PROF_PHASE_INTEGRATE;
+    uint64_t prof_start = prof_span_begin();
+
+    // Send the owned neurons along each side to the neighbor facing it, in a fixed order of directions.
+    // Sends don't wait for neighbors to receive, so halos travel while the interior is ticked.
+    for (int d = 0; d < 9; d++) {
+        int dx = d % 3 - 1;
+        int dy = d / 3 - 1;
+        int64_t neighbor = dom2d_neighbor(dom, dx, dy);
+        if ((dx == 0 && dy == 0) || neighbor < 0) {
+            continue;
+        }
+
+        size_t size = dom2d_strip_copy(dom, prev_cortex, dx, dy, FALSE);
+        error_code_t error = dom->transport.send(dom->transport.context, (uint32_t) neighbor, dom->halo_buffer, size);
+        if (error != ERROR_NONE) {
+            return error;
+        }
+    }
+
+    // Owned neurons, then the interior ones: neurons whose neighborhoods don't reach any halo.
+    cortex_size_t owned_x0 = dom->halo_left;
+    cortex_size_t owned_x1 = dom->halo_left + dom->x1 - dom->x0;
+    cortex_size_t owned_y0 = dom->halo_top;
+    cortex_size_t owned_y1 = dom->halo_top + dom->y1 - dom->y0;
+    cortex_size_t inner_x0 = owned_x0 + (dom->halo_left > 0 ? nh_radius : 0);
+    cortex_size_t inner_x1 = owned_x1 - (dom->halo_right > 0 ? nh_radius : 0);
+    cortex_size_t inner_y0 = owned_y0 + (dom->halo_top > 0 ? nh_radius : 0);
+    cortex_size_t inner_y1 = owned_y1 - (dom->halo_bottom > 0 ? nh_radius : 0);
+    inner_x1 = inner_x1 > inner_x0 ? inner_x1 : inner_x0;
+    inner_y1 = inner_y1 > inner_y0 ? inner_y1 : inner_y0;
+
+    c2d_tick_state_t state;
+    error_code_t error;
+    if (inner_x0 < inner_x1 && inner_y0 < inner_y1) {
+        error = c2d_tick_state_init(&state, prev_cortex, next_cortex, inner_y0, inner_y1);
+        if (error != ERROR_NONE) {
+            return error;
+        }
+        state.origin_x = dom->x0 - dom->halo_left;
+        state.origin_y = dom->y0 - dom->halo_top;
+        state.outer_width = dom->width;
+        c2d_tick_rect(&state, inner_x0, inner_x1, inner_y0, inner_y1);
+        c2d_tick_state_free(&state);
+    }
+
+    // Receive halos: the strip a neighbor sent towards (dx, dy) fills the halo on the opposite side,
+    // so that strips are received in the same order they're sent through every channel.
+    for (int d = 0; d < 9; d++) {
+        int dx = d % 3 - 1;
+        int dy = d / 3 - 1;
+        int64_t neighbor = dom2d_neighbor(dom, -dx, -dy);
+        if ((dx == 0 && dy == 0) || neighbor < 0) {
+            continue;
+        }
+
+        // Halos are unpacked right away, so the buffer is only sized once.
+        cortex_size_t x0, x1, y0, y1;
+        dom2d_strip_bounds(-dx, owned_x0, owned_x1, nh_radius, TRUE, &x0, &x1);
+        dom2d_strip_bounds(-dy, owned_y0, owned_y1, nh_radius, TRUE, &y0, &y1);
+        size_t size = (size_t) (x1 - x0) * (size_t) (y1 - y0) * DOM_HALO_NEURON_SIZE;
+        error = dom->transport.recv(dom->transport.context, (uint32_t) neighbor, dom->halo_buffer, size);
+        if (error != ERROR_NONE) {
+            return error;
+        }
+        dom2d_strip_copy(dom, prev_cortex, -dx, -dy, TRUE);
+    }
+
+    // Then the remaining owned neurons, in four rectangles around the interior.
+    error = c2d_tick_state_init(&state, prev_cortex, next_cortex, owned_y0, owned_y1);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+    state.origin_x = dom->x0 - dom->halo_left;
+    state.origin_y = dom->y0 - dom->halo_top;
+    state.outer_width = dom->width;
+    c2d_tick_rect(&state, owned_x0, owned_x1, owned_y0, inner_y0);
+    c2d_tick_rect(&state, owned_x0, owned_x1, inner_y1, owned_y1);
+    c2d_tick_rect(&state, owned_x0, inner_x0, inner_y0, inner_y1);
+    c2d_tick_rect(&state, inner_x1, owned_x1, inner_y0, inner_y1);
+    c2d_tick_state_free(&state);
+
+    if (evolves) {
+        // Increment evolutions count.
+        next_cortex->evols_count++;
+    }
+    next_cortex->ticks_count++;
+    next_cortex->rand_ticks_count++;
+
+    c2d_pair_swap(dom->pair);
+
+    prof_span_end(prof_phase, prof_start);
+
+    return ERROR_NONE;
+}
+
+void c3d_feed3d(cortex3d_t* cortex, input3d_t* input) {
+    uint64_t prof_start = prof_span_begin();
+
+    #pragma omp parallel for collapse(3)
+    for (cortex_size_t z = input->z0; z < input->z1; z++) {
+        for (cortex_size_t y = input->y0; y < input->y1; y++) {
+            for (cortex_size_t x = input->x0; x < input->x1; x++) {
+                if (pulse_map(cortex->sample_window,
+                              cortex->ticks_count % cortex->sample_window,
+                              input->values[IDX3D(x - input->x0, y - input->y0, z - input->z0, input->x1 - input->x0, input->y1 - input->y0)],
+                              cortex->pulse_mapping)) {
+                    cortex->neurons[BRICK_IDX3D(x, y, z, cortex->bricks_x, cortex->bricks_y)].value += input->exc_value;
+                }
+            }
+        }
+    }
+
+    prof_span_end(PROF_PHASE_FEED, prof_start);
+}
+
+// Side of the tiles gathered by 3D ticks: a brick plus a halo as wide as the biggest allowed neighborhood radius on each side.
+#define C3D_TILE_SIDE (BRICK_SIDE_3D + 2)
+#define C3D_TILE_SIZE (C3D_TILE_SIDE * C3D_TILE_SIDE * C3D_TILE_SIDE)
+
+// Side of the columns of bricks ticked by 3D ticks, in bricks.
+#define C3D_COLUMN_SIDE 0x04
+
+static inline plasticity_t c3d_plasticity(cortex3d_t* cortex) {
+    plasticity_t plasticity = {
+        cortex->syngen_chance,
+        cortex->synstr_chance,
+        cortex->inhexc_range,
+        cortex->max_tot_strength,
+        cortex->rand_mode == RAND_MODE_COUNTER,
+        cortex->rand_seed,
+        cortex->rand_ticks_count << 8
+    };
+    return plasticity;
+}
+
+// Returns the mask of the neighborhood positions of a neuron at coordinate c along one axis that fall inside [0, size) along that axis,
+// given the masks of the positions at each offset along the axis. The valid mask of a neuron is the AND of its three axis masks.
+static inline nh_mask_t c3d_nh_axis_mask(cortex_size_t c, cortex_size_t size, const nh_mask_t* offset_masks, cortex_size_t nh_radius, cortex_size_t nh_diameter) {
+    nh_mask_t result = 0x00U;
+    for (cortex_size_t i = 0; i < nh_diameter; i++) {
+        cortex_size_t neighbor_c = c + (i - nh_radius);
+        if (neighbor_c >= 0 && neighbor_c < size) {
+            result |= offset_masks[i];
+        }
+    }
+    return result;
+}
+
+// Gathers the values and pulses of the neurons of the brick at (bx, by, bz) and of its halo into the given tiles.
+// Halo positions falling outside the bricks are zeroed, while the ones falling in bricks padding are gathered as they are:
+// either way they're never part of valid neighborhoods.
+static inline void c3d_gather_tile(cortex3d_t* cortex, cortex_size_t bx, cortex_size_t by, cortex_size_t bz, neuron_value_t* values, spikes_count_t* pulses) {
+    for (cortex_size_t tz = 0; tz < C3D_TILE_SIDE; tz++) {
+        cortex_size_t z = bz * BRICK_SIDE_3D + tz - 1;
+        for (cortex_size_t ty = 0; ty < C3D_TILE_SIDE; ty++) {
+            cortex_size_t y = by * BRICK_SIDE_3D + ty - 1;
+            neuron_value_t* row_values = &(values[IDX3D(0, ty, tz, C3D_TILE_SIDE, C3D_TILE_SIDE)]);
+            spikes_count_t* row_pulses = &(pulses[IDX3D(0, ty, tz, C3D_TILE_SIDE, C3D_TILE_SIDE)]);
+
+            if (z < 0 || z >= cortex->bricks_z * BRICK_SIDE_3D || y < 0 || y >= cortex->bricks_y * BRICK_SIDE_3D) {
+                memset(row_values, 0x00, C3D_TILE_SIDE * sizeof(neuron_value_t));
+                memset(row_pulses, 0x00, C3D_TILE_SIDE * sizeof(spikes_count_t));
+                continue;
+            }
+
+            // The row is contiguous inside the brick, while its halo neurons are the last and first ones of the same row in the previous and next bricks.
+            const neuron_t* row = &(cortex->neurons[BRICK_IDX3D(bx * BRICK_SIDE_3D, y, z, cortex->bricks_x, cortex->bricks_y)]);
+            for (cortex_size_t i = 0; i < BRICK_SIDE_3D; i++) {
+                row_values[i + 1] = row[i].value;
+                row_pulses[i + 1] = row[i].pulse;
+            }
+            row_values[0] = bx > 0 ? row[BRICK_SIDE_3D - 1 - BRICK_SIZE_3D].value : 0x00;
+            row_pulses[0] = bx > 0 ? row[BRICK_SIDE_3D - 1 - BRICK_SIZE_3D].pulse : 0x00;
+            row_values[C3D_TILE_SIDE - 1] = bx < cortex->bricks_x - 1 ? row[BRICK_SIZE_3D].value : 0x00;
+            row_pulses[C3D_TILE_SIDE - 1] = bx < cortex->bricks_x - 1 ? row[BRICK_SIZE_3D].pulse : 0x00;
+        }
+    }
+}
+
+// Neighborhood of the neurons of 3D cortices, shared by all neurons during a tick.
+typedef struct c3d_nh_t {
+    cortex_size_t radius;
+    cortex_size_t diameter;
+    // Number of neighborhood positions, central one included.
+    cortex_size_t size;
+    nh_mask_t center_mask;
+    // Offsets of the neighborhood positions inside tiles, which are the same for all neurons.
+    cortex_index_t offsets[sizeof(nh_mask_t) * 8];
+    // Masks of the neighborhood positions at each offset along each axis.
+    nh_mask_t x_offset_masks[NH_DIAM_3D(1)];
+    nh_mask_t y_offset_masks[NH_DIAM_3D(1)];
+    nh_mask_t z_offset_masks[NH_DIAM_3D(1)];
+} c3d_nh_t;
+
+static inline void c3d_nh_init(c3d_nh_t* nh, nh_radius_t nh_radius) {
+    memset(nh, 0x00, sizeof(c3d_nh_t));
+    nh->radius = nh_radius;
+    nh->diameter = NH_DIAM_3D(nh_radius);
+    nh->size = nh->diameter * nh->diameter * nh->diameter;
+    nh->center_mask = 0x01UL << IDX3D(nh_radius, nh_radius, nh_radius, nh->diameter, nh->diameter);
+
+    for (cortex_size_t k = 0; k < nh->size; k++) {
+        cortex_size_t i = k % nh->diameter;
+        cortex_size_t j = k / nh->diameter % nh->diameter;
+        cortex_size_t l = k / (nh->diameter * nh->diameter);
+        nh->offsets[k] = IDX3D(i - nh_radius, j - nh_radius, l - nh_radius, C3D_TILE_SIDE, C3D_TILE_SIDE);
+        nh->x_offset_masks[i] |= 0x01UL << k;
+        nh->y_offset_masks[j] |= 0x01UL << k;
+        nh->z_offset_masks[l] |= 0x01UL << k;
+    }
+}
+
+// Ticks the neurons of the brick at (bx, by, bz), reading their neighbors from the given tiles, previously gathered by c3d_gather_tile.
+static inline void c3d_tick_brick(cortex3d_t* prev_cortex,
+                                  cortex3d_t* next_cortex,
+                                  cortex_size_t bx,
+                                  cortex_size_t by,
+                                  cortex_size_t bz,
+                                  const c3d_nh_t* nh,
+                                  const plasticity_t* plasticity,
+                                  bool_t evolve,
+                                  const neuron_value_t* values,
+                                  const spikes_count_t* pulses) {
+    // Neighborhood positions falling inside the cortex along each axis, for each coordinate in the brick.
+    nh_mask_t x_masks[BRICK_SIDE_3D];
+    nh_mask_t y_masks[BRICK_SIDE_3D];
+    nh_mask_t z_masks[BRICK_SIDE_3D];
+    for (cortex_size_t l = 0; l < BRICK_SIDE_3D; l++) {
+        x_masks[l] = c3d_nh_axis_mask(bx * BRICK_SIDE_3D + l, prev_cortex->width, nh->x_offset_masks, nh->radius, nh->diameter);
+        y_masks[l] = c3d_nh_axis_mask(by * BRICK_SIDE_3D + l, prev_cortex->height, nh->y_offset_masks, nh->radius, nh->diameter);
+        z_masks[l] = c3d_nh_axis_mask(bz * BRICK_SIDE_3D + l, prev_cortex->depth, nh->z_offset_masks, nh->radius, nh->diameter);
+    }
+
+    for (cortex_size_t lz = 0; lz < BRICK_SIDE_3D; lz++) {
+        for (cortex_size_t ly = 0; ly < BRICK_SIDE_3D; ly++) {
+            for (cortex_size_t lx = 0; lx < BRICK_SIDE_3D; lx++) {
+                cortex_size_t x = bx * BRICK_SIDE_3D + lx;
+                cortex_size_t y = by * BRICK_SIDE_3D + ly;
+                cortex_size_t z = bz * BRICK_SIDE_3D + lz;
+                if (x >= prev_cortex->width || y >= prev_cortex->height || z >= prev_cortex->depth) {
+                    // Bricks padding.
+                    continue;
+                }
+
+                // Retrieve the involved neurons.
+                cortex_index_t neuron_index = BRICK_IDX3D(x, y, z, prev_cortex->bricks_x, prev_cortex->bricks_y);
+                neuron_t prev_neuron = prev_cortex->neurons[neuron_index];
+                neuron_t* next_neuron = &(next_cortex->neurons[neuron_index]);
+                cortex_index_t tile_index = IDX3D(lx + 1, ly + 1, lz + 1, C3D_TILE_SIDE, C3D_TILE_SIDE);
+
+                // Copy prev neuron values to the new one.
+                *next_neuron = prev_neuron;
+
+                // Neighborhood positions falling inside the cortex, central neuron excluded.
+                nh_mask_t valid_mask = x_masks[lx] & y_masks[ly] & z_masks[lz] & ~nh->center_mask;
+
+                // Increment the current neuron value by reading its connected neighbors, in neighborhood order.
+                for (nh_mask_t bits = prev_neuron.synac_mask & valid_mask; bits; bits &= bits - 1) {
+                    cortex_size_t k = __builtin_ctzll(bits);
+                    if (values[tile_index + nh->offsets[k]] > prev_cortex->fire_threshold) {
+                        // Compute the current synapse strength.
+                        syn_strength_t syn_strength = ((prev_neuron.synstr_mask_a >> k) & 0x01U) |
+                                                      (((prev_neuron.synstr_mask_b >> k) & 0x01U) << 0x01U) |
+                                                      (((prev_neuron.synstr_mask_c >> k) & 0x01U) << 0x02U);
+                        neuron_value_t neighbor_influence = ((prev_neuron.synex_mask >> k) & 0x01U ? prev_cortex->exc_value : -prev_cortex->exc_value) * ((syn_strength / 4) + 1);
+                        if (next_neuron->value + neighbor_influence < prev_cortex->recovery_value) {
+                            next_neuron->value = prev_cortex->recovery_value;
+                        } else {
+                            next_neuron->value += neighbor_influence;
+                        }
+                    }
+                }
+
+                // Perform the evolution phase if allowed.
+                if (evolve) {
+                    nh_mask_t active_mask = 0x00U;
+                    for (cortex_size_t k = 0; k < nh->size; k++) {
+                        if (pulses[tile_index + nh->offsets[k]] > 0) {
+                            active_mask |= 0x01UL << k;
+                        }
+                    }
+                    nh_evolve_neuron(plasticity,
+                                     (const byte*) pulses,
+                                     sizeof(spikes_count_t),
+                                     nh->offsets,
+                                     tile_index,
+                                     nh->size,
+                                     (uint64_t) IDX3D(x, y, z, prev_cortex->width, prev_cortex->height),
+                                     &prev_neuron,
+                                     next_neuron,
+                                     valid_mask,
+                                     active_mask & valid_mask);
+                } else if (!plasticity->counter_rand) {
+                    // Sequential random numbers are drawn for every valid neighbor at every tick, whether evolving or not.
+                    for (cortex_size_t k = __builtin_popcountll(valid_mask); k > 0; k--) {
+                        next_neuron->rand_state = xorshf32(next_neuron->rand_state);
+                    }
+                }
+
+                // Push to equilibrium by decaying to zero, both from above and below.
+                if (prev_neuron.value > 0x00) {
+                    next_neuron->value -= next_cortex->decay_value;
+                } else if (prev_neuron.value < 0x00) {
+                    next_neuron->value += next_cortex->decay_value;
+                }
+
+                if ((prev_neuron.pulse_mask >> prev_cortex->pulse_window) & 0x01U) {
+                    // Decrease pulse if the oldest recorded pulse is active.
+                    next_neuron->pulse--;
+                }
+
+                next_neuron->pulse_mask <<= 0x01U;
+
+                // Bring the neuron back to recovery if it just fired, otherwise fire it if its value is over its threshold.
+                if (prev_neuron.value > prev_cortex->fire_threshold + prev_neuron.pulse) {
+                    // Fired at the previous step.
+                    next_neuron->value = next_cortex->recovery_value;
+
+                    // Store pulse.
+                    next_neuron->pulse_mask |= 0x01U;
+                    next_neuron->pulse++;
+                }
+            }
+        }
+    }
+}
+
+void c3d_tick(cortex3d_t* prev_cortex, cortex3d_t* next_cortex) {
+    // Defines whether to evolve or not, see c2d_tick_rows.
+    evol_step_t evol_period = ((evol_step_t) prev_cortex->evol_step) + 1;
+    bool_t evolve = prev_cortex->ticks_count % evol_period == 0;
+
+    prof_phase_t prof_phase = evolve ? PROF_PHASE_EVOLVE : PROF_PHASE_INTEGRATE;
+    uint64_t prof_start = prof_span_begin();
+
+    c3d_nh_t nh;
+    c3d_nh_init(&nh, prev_cortex->nh_radius);
+    plasticity_t plasticity = c3d_plasticity(prev_cortex);
+
+    #pragma omp parallel
+    {
+        uint64_t prof_thread_start = prof_span_begin();
+
+        // Neighbors only ever read values and pulses, so they're gathered once per brick in a small tile, which then serves all the brick's neurons.
+        neuron_value_t values[C3D_TILE_SIZE];
+        spikes_count_t pulses[C3D_TILE_SIZE];
+
+        // Bricks are visited in columns of C3D_COLUMN_SIDE x C3D_COLUMN_SIDE bricks spanning the whole depth, so that the halo
+        // shared by consecutive layers of a column is still cached when the next layer is ticked.
+        #pragma omp for collapse(2) nowait
+        for (cortex_size_t cy = 0; cy < prev_cortex->bricks_y; cy += C3D_COLUMN_SIDE) {
+            for (cortex_size_t cx = 0; cx < prev_cortex->bricks_x; cx += C3D_COLUMN_SIDE) {
+                for (cortex_size_t bz = 0; bz < prev_cortex->bricks_z; bz++) {
+                    for (cortex_size_t by = cy; by < cy + C3D_COLUMN_SIDE && by < prev_cortex->bricks_y; by++) {
+                        for (cortex_size_t bx = cx; bx < cx + C3D_COLUMN_SIDE && bx < prev_cortex->bricks_x; bx++) {
+                            c3d_gather_tile(prev_cortex, bx, by, bz, values, pulses);
+                            c3d_tick_brick(prev_cortex, next_cortex, bx, by, bz, &nh, &plasticity, evolve, values, pulses);
+                        }
+                    }
+                }
+            }
+        }
+
+        prof_trace_end(prof_phase, prof_thread_start);
+    }
+
+    if (evolve) {
+        // Increment evolutions count.
+        next_cortex->evols_count++;
+    }
+    next_cortex->ticks_count++;
+    next_cortex->rand_ticks_count++;
+
+    prof_span_end(prof_phase, prof_start);
+}
+
+void f2d_feed2d(frozen2d_t* frozen, input2d_t* input) {
+    uint64_t prof_start = prof_span_begin();
+
+    #pragma omp parallel for collapse(2)
+    for (cortex_size_t y = input->y0; y < input->y1; y++) {
+        for (cortex_size_t x = input->x0; x < input->x1; x++) {
+            if (pulse_map(frozen->sample_window,
+                          frozen->ticks_count % frozen->sample_window,
+                          input->values[IDX2D(x - input->x0, y - input->y0, input->x1 - input->x0)],
+                          frozen->pulse_mapping)) {
+                frozen->values[IDX2D(x, y, frozen->width)] += input->exc_value;
+            }
+        }
+    }
+
+    prof_span_end(PROF_PHASE_FEED, prof_start);
+}
+
+// Computes the next state of a frozen cortex' neuron, given its value after integration. Returns whether it's over the fire threshold in the next state.
+static inline bool_t f2d_update_neuron(frozen2d_t* frozen, cortex_index_t neuron_index, neuron_value_t value) {
+    neuron_value_t prev_value = frozen->values[neuron_index];
+    spikes_count_t prev_pulse = frozen->pulses[neuron_index];
+
+    // Push to equilibrium by decaying to zero, both from above and below.
+    if (prev_value > 0x00) {
+        value -= frozen->decay_value;
+    } else if (prev_value < 0x00) {
+        value += frozen->decay_value;
+    }
+
+    // Pulses only depend on the neuron's own state, so they can be updated in place.
+    pulse_mask_t pulse_mask = frozen->pulse_masks[neuron_index];
+    if ((pulse_mask >> frozen->pulse_window) & 0x01U) {
+        // Decrease pulse if the oldest recorded pulse is active.
+        frozen->pulses[neuron_index]--;
+    }
+
+    pulse_mask <<= 0x01U;
+
+    // Bring the neuron back to recovery if it just fired, otherwise fire it if its value is over its threshold.
+    if (prev_value > frozen->fire_threshold + prev_pulse) {
+        // Fired at the previous step.
+        value = frozen->recovery_value;
+
+        // Store pulse.
+        pulse_mask |= 0x01U;
+        frozen->pulses[neuron_index]++;
+    }
+
+    frozen->pulse_masks[neuron_index] = pulse_mask;
+    frozen->next_values[neuron_index] = value;
+
+    return value > frozen->fire_threshold;
+}
+
+// Adds the weight of an incoming edge to a neuron value.
+static inline neuron_value_t f2d_apply_edge(frozen2d_t* frozen, neuron_value_t value, size_t edge) {
+    neuron_value_t neighbor_influence = frozen->edges_weights[edge];
+    return value + neighbor_influence < frozen->recovery_value ? frozen->recovery_value : value + neighbor_influence;
+}
+
+void f2d_tick(frozen2d_t* frozen) {
+    uint64_t prof_start = prof_span_begin();
+
+    cortex_index_t neurons_count = (cortex_index_t) frozen->width * frozen->height;
+    bool_t push = frozen->propagation == PROPAGATION_PUSH ||
+                  (frozen->propagation == PROPAGATION_AUTO &&
+                   (float) frozen->active_count < frozen->push_fraction * (float) neurons_count);
+    size_t active_count = 0;
+
+    #pragma omp parallel
+    {
+        uint64_t prof_thread_start = prof_span_begin();
+
+        if (push) {
+            // Scatter: neurons over the fire threshold mark their slot in each target's arrivals.
+            #pragma omp for
+            for (cortex_index_t source = 0; source < neurons_count; source++) {
+                if (frozen->values[source] > frozen->fire_threshold) {
+                    for (size_t out_edge = frozen->out_offsets[source]; out_edge < frozen->out_offsets[source + 1]; out_edge++) {
+                        nh_mask_t slot = 0x01UL << frozen->out_slots[out_edge];
+                        nh_mask_t* arrivals = &(frozen->arrivals[frozen->out_targets[out_edge]]);
+                        #pragma omp atomic
+                        *arrivals |= slot;
+                    }
+                }
+            }
+
+            // Gather: arrived edges are applied in slot order, so recovery clamping gives the same result as pulling.
+            #pragma omp for reduction(+:active_count) nowait
+            for (cortex_index_t neuron_index = 0; neuron_index < neurons_count; neuron_index++) {
+                neuron_value_t value = frozen->values[neuron_index];
+                nh_mask_t arrivals = frozen->arrivals[neuron_index];
+                if (arrivals) {
+                    frozen->arrivals[neuron_index] = 0x00U;
+                    for (; arrivals; arrivals &= arrivals - 1) {
+                        value = f2d_apply_edge(frozen, value, frozen->edges_offsets[neuron_index] + __builtin_ctzll(arrivals));
+                    }
+                }
+                active_count += f2d_update_neuron(frozen, neuron_index, value);
+            }
+        } else {
+            #pragma omp for reduction(+:active_count) nowait
+            for (cortex_index_t neuron_index = 0; neuron_index < neurons_count; neuron_index++) {
+                neuron_value_t value = frozen->values[neuron_index];
+
+                // Edges are in neighborhood order, so recovery clamping gives the same result as c2d_tick.
+                for (size_t edge = frozen->edges_offsets[neuron_index]; edge < frozen->edges_offsets[neuron_index + 1]; edge++) {
+                    if (frozen->values[frozen->edges_sources[edge]] > frozen->fire_threshold) {
+                        value = f2d_apply_edge(frozen, value, edge);
+                    }
+                }
+                active_count += f2d_update_neuron(frozen, neuron_index, value);
+            }
+        }
+
+        prof_trace_end(PROF_PHASE_INTEGRATE, prof_thread_start);
+    }
+
+    // Swap values buffers.
+    neuron_value_t* values = frozen->values;
+    frozen->values = frozen->next_values;
+    frozen->next_values = values;
+
+    frozen->active_count = active_count;
+    frozen->ticks_count++;
+    frozen->rand_ticks_count++;
+    frozen->frozen_ticks_count++;
+
+    prof_span_end(PROF_PHASE_INTEGRATE, prof_start);
+}
+
+void e2d_feed2d(ensemble2d_t* ensemble, input2d_t* input) {
+    uint64_t prof_start = prof_span_begin();
+
+    cortex_size_t lanes_count = ensemble->lanes_count;
+
+    #pragma omp parallel for collapse(2)
+    for (cortex_size_t y = input->y0; y < input->y1; y++) {
+        for (cortex_size_t x = input->x0; x < input->x1; x++) {
+            ticks_count_t input_value = input->values[IDX2D(x - input->x0, y - input->y0, input->x1 - input->x0)];
+            neuron_value_t* values = &(ensemble->neurons.values[(size_t) IDX2D(x, y, ensemble->width) * lanes_count]);
+
+            for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+                cortex2d_t* cortex = &(ensemble->lanes[lane]);
+                if (pulse_map(cortex->sample_window,
+                              cortex->ticks_count % cortex->sample_window,
+                              input_value,
+                              cortex->pulse_mapping)) {
+                    values[lane] += input->exc_value;
+                }
+            }
+        }
+    }
+
+    prof_span_end(PROF_PHASE_FEED, prof_start);
+}
+
+// Gathers a single lane of an ensemble's neuron, at the given interleaved index.
+static inline void e2d_load_neuron(const ensemble_neurons_t* neurons, size_t index, neuron_t* neuron) {
+    neuron->synac_mask = neurons->synac_masks[index];
+    neuron->synex_mask = neurons->synex_masks[index];
+    neuron->synstr_mask_a = neurons->synstr_masks_a[index];
+    neuron->synstr_mask_b = neurons->synstr_masks_b[index];
+    neuron->synstr_mask_c = neurons->synstr_masks_c[index];
+    neuron->rand_state = neurons->rand_states[index];
+    neuron->pulse_mask = neurons->pulse_masks[index];
+    neuron->pulse = neurons->pulses[index];
+    neuron->value = neurons->values[index];
+    neuron->max_syn_count = neurons->max_syn_counts[index];
+    neuron->syn_count = neurons->syn_counts[index];
+    neuron->tot_syn_strength = neurons->tot_syn_strengths[index];
+    neuron->inhexc_ratio = neurons->inhexc_ratios[index];
+}
+
+// Scatters back the fields changed by evolution to a single lane of an ensemble's neuron.
+static inline void e2d_store_evolved_neuron(ensemble_neurons_t* neurons, size_t index, const neuron_t* neuron) {
+    neurons->synac_masks[index] = neuron->synac_mask;
+    neurons->synex_masks[index] = neuron->synex_mask;
+    neurons->synstr_masks_a[index] = neuron->synstr_mask_a;
+    neurons->synstr_masks_b[index] = neuron->synstr_mask_b;
+    neurons->synstr_masks_c[index] = neuron->synstr_mask_c;
+    neurons->rand_states[index] = neuron->rand_state;
+    neurons->syn_counts[index] = neuron->syn_count;
+    neurons->tot_syn_strengths[index] = neuron->tot_syn_strength;
+}
+
+void e2d_tick(ensemble2d_t* ensemble) {
+    uint64_t prof_start = prof_span_begin();
+
+    cortex_size_t lanes_count = ensemble->lanes_count;
+    cortex_size_t nh_diameter = NH_DIAM_2D(ensemble->nh_radius);
+
+    // Arrays are copied to locals, so that the compiler knows they can't change while looping over lanes.
+    ensemble_neurons_t neurons = ensemble->neurons;
+    neuron_value_t* next_values = ensemble->next_values;
+    spikes_count_t* next_pulses = ensemble->next_pulses;
+    const uint64_t* fired_lanes = ensemble->fired_lanes;
+    const uint64_t* active_lanes = ensemble->active_lanes;
+    const neuron_value_t* fire_thresholds = ensemble->fire_thresholds;
+    const neuron_value_t* recovery_values = ensemble->recovery_values;
+    const neuron_value_t* exc_values = ensemble->exc_values;
+    const neuron_value_t* decay_values = ensemble->decay_values;
+    const spikes_count_t* pulse_windows = ensemble->pulse_windows;
+
+    // Plasticity parameters of each lane.
+    plasticity_t plasticities[ENSEMBLE_MAX_LANES];
+    cortex_index_t nh_offsets[sizeof(nh_mask_t) * 8];
+    c2d_nh_offsets(nh_offsets, ensemble->width, ensemble->nh_radius);
+
+    // Evolution schedule of each lane, see c2d_tick.
+    evol_step_t evol_periods[ENSEMBLE_MAX_LANES];
+    evol_step_t evol_phases[ENSEMBLE_MAX_LANES];
+    bool_t any_evolve = FALSE;
+    // Lanes drawing sequential random numbers even when not evolving.
+    bool_t any_xorshift = FALSE;
+    for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+        cortex2d_t* cortex = &(ensemble->lanes[lane]);
+        plasticities[lane] = c2d_plasticity(cortex);
+        evol_periods[lane] = ((evol_step_t) cortex->evol_step) + 1;
+        evol_phases[lane] = cortex->ticks_count % evol_periods[lane];
+        any_evolve = any_evolve || evol_phases[lane] == 0 || cortex->evol_mode != EVOL_MODE_FULL;
+        any_xorshift = any_xorshift || cortex->rand_mode == RAND_MODE_XORSHIFT;
+    }
+
+    prof_phase_t prof_phase = any_evolve ? PROF_PHASE_EVOLVE : PROF_PHASE_INTEGRATE;
+
+    #pragma omp parallel
+    {
+        uint64_t prof_thread_start = prof_span_begin();
+
+        // Summarize each neuron's lanes into bit masks, so that neighbors can be tested for all lanes at once.
+        #pragma omp for
+        for (cortex_index_t neuron_index = 0; neuron_index < (cortex_index_t) ensemble->width * ensemble->height; neuron_index++) {
+            size_t base = (size_t) neuron_index * lanes_count;
+            uint64_t fired = 0x00U;
+            uint64_t active = 0x00U;
+            for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+                fired |= ((uint64_t) (neurons.values[base + lane] > fire_thresholds[lane])) << lane;
+                active |= ((uint64_t) (neurons.pulses[base + lane] > 0)) << lane;
+            }
+            ensemble->fired_lanes[neuron_index] = fired;
+            ensemble->active_lanes[neuron_index] = active;
+        }
+
+        #pragma omp for collapse(2) nowait
+        for (cortex_size_t y = 0; y < ensemble->height; y++) {
+            for (cortex_size_t x = 0; x < ensemble->width; x++) {
+                // Lanes of the current neuron start here, in all neurons arrays.
+                size_t base = (size_t) IDX2D(x, y, ensemble->width) * lanes_count;
+
+                // Neighborhood geometry is the same for all lanes.
+                nh_mask_t valid_mask = c2d_nh_valid_mask(&(ensemble->lanes[0]), x, y, nh_diameter);
+
+                // Synapses active in any lane.
+                nh_mask_t ac_mask = 0x00U;
+                #pragma omp simd reduction(|:ac_mask)
+                for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+                    ac_mask |= neurons.synac_masks[base + lane];
+                }
+
+                #pragma omp simd
+                for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+                    next_values[base + lane] = neurons.values[base + lane];
+                }
+
+                // Increment the current neuron value by reading its connected neighbors, one neighbor at a time for all lanes.
+                // Neighbors are visited in neighborhood order, so that each lane's recovery clamping gives the same result as c2d_tick.
+                for (nh_mask_t bits = ac_mask & valid_mask; bits; bits &= bits - 1) {
+                    cortex_size_t k = __builtin_ctzll(bits);
+                    cortex_size_t neighbor_x = x + (k % nh_diameter - ensemble->nh_radius);
+                    cortex_size_t neighbor_y = y + (k / nh_diameter - ensemble->nh_radius);
+
+                    for (uint64_t lanes = fired_lanes[IDX2D(neighbor_x, neighbor_y, ensemble->width)]; lanes; lanes &= lanes - 1) {
+                        cortex_size_t lane = __builtin_ctzll(lanes);
+                        size_t i = base + lane;
+                        if ((neurons.synac_masks[i] >> k) & 0x01U) {
+                            syn_strength_t syn_strength = ((neurons.synstr_masks_a[i] >> k) & 0x01U) |
+                                                          (((neurons.synstr_masks_b[i] >> k) & 0x01U) << 0x01U) |
+                                                          (((neurons.synstr_masks_c[i] >> k) & 0x01U) << 0x02U);
+                            neuron_value_t neighbor_influence = ((neurons.synex_masks[i] >> k) & 0x01U ? exc_values[lane] : -exc_values[lane]) * ((syn_strength / 4) + 1);
+                            if (next_values[i] + neighbor_influence < recovery_values[lane]) {
+                                next_values[i] = recovery_values[lane];
+                            } else {
+                                next_values[i] += neighbor_influence;
+                            }
+                        }
+                    }
+                }
+
+                if (any_evolve || any_xorshift) {
+                    // Gather the active neighbors of all lanes.
+                    nh_mask_t active_masks[ENSEMBLE_MAX_LANES];
+                    memset(active_masks, 0x00, lanes_count * sizeof(nh_mask_t));
+                    for (nh_mask_t bits = any_evolve ? valid_mask : 0x00U; bits; bits &= bits - 1) {
+                        cortex_size_t k = __builtin_ctzll(bits);
+                        cortex_size_t neighbor_x = x + (k % nh_diameter - ensemble->nh_radius);
+                        cortex_size_t neighbor_y = y + (k / nh_diameter - ensemble->nh_radius);
+
+                        for (uint64_t lanes = active_lanes[IDX2D(neighbor_x, neighbor_y, ensemble->width)]; lanes; lanes &= lanes - 1) {
+                            active_masks[__builtin_ctzll(lanes)] |= 0x01UL << k;
+                        }
+                    }
+
+                    // Perform the evolution phase for the lanes that allow it.
+                    for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+                        cortex2d_t* cortex = &(ensemble->lanes[lane]);
+                        bool_t neuron_evolve = cortex->evol_mode != EVOL_MODE_FULL ?
+                                               c2d_evol_group(cortex->evol_mode, x, y, cortex->width, evol_periods[lane]) == evol_phases[lane] :
+                                               evol_phases[lane] == 0;
+                        if (neuron_evolve) {
+                            // Masks are only read by the neuron itself, so they're evolved in place.
+                            neuron_t prev_neuron;
+                            e2d_load_neuron(&neurons, base + lane, &prev_neuron);
+                            neuron_t next_neuron = prev_neuron;
+                            nh_evolve_neuron(&(plasticities[lane]),
+                                             (const byte*) &(neurons.pulses[lane]),
+                                             lanes_count * sizeof(spikes_count_t),
+                                             nh_offsets,
+                                             IDX2D(x, y, ensemble->width),
+                                             nh_diameter * nh_diameter,
+                                             (uint64_t) IDX2D(x, y, ensemble->width),
+                                             &prev_neuron,
+                                             &next_neuron,
+                                             valid_mask,
+                                             active_masks[lane]);
+                            e2d_store_evolved_neuron(&neurons, base + lane, &next_neuron);
+                        } else if (cortex->rand_mode == RAND_MODE_XORSHIFT) {
+                            // Sequential random numbers are drawn for every valid neighbor at every tick, whether evolving or not.
+                            for (cortex_size_t k = __builtin_popcountll(valid_mask); k > 0; k--) {
+                                neurons.rand_states[base + lane] = xorshf32(neurons.rand_states[base + lane]);
+                            }
+                        }
+                    }
+                }
+
+                #pragma omp simd
+                for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+                    size_t i = base + lane;
+                    neuron_value_t prev_value = neurons.values[i];
+                    spikes_count_t prev_pulse = neurons.pulses[i];
+                    pulse_mask_t pulse_mask = neurons.pulse_masks[i];
+
+                    // Push to equilibrium by decaying to zero, both from above and below.
+                    neuron_value_t value = next_values[i] - (prev_value > 0x00) * decay_values[lane] + (prev_value < 0x00) * decay_values[lane];
+
+                    // Decrease pulse if the oldest recorded pulse is active.
+                    spikes_count_t pulse = prev_pulse - ((pulse_mask >> pulse_windows[lane]) & 0x01U);
+
+                    // Bring the neuron back to recovery if it just fired, otherwise fire it if its value is over its threshold.
+                    bool_t fired = prev_value > fire_thresholds[lane] + prev_pulse;
+                    next_values[i] = fired ? recovery_values[lane] : value;
+                    neurons.pulse_masks[i] = (pulse_mask << 0x01U) | fired;
+                    next_pulses[i] = pulse + fired;
+                }
+            }
+        }
+
+        prof_trace_end(prof_phase, prof_thread_start);
+    }
+
+    // Swap values and pulses buffers.
+    ensemble->neurons.values = next_values;
+    ensemble->neurons.pulses = next_pulses;
+    ensemble->next_values = neurons.values;
+    ensemble->next_pulses = neurons.pulses;
+
+    for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+        cortex2d_t* cortex = &(ensemble->lanes[lane]);
+        if (evol_phases[lane] == 0 || cortex->evol_mode != EVOL_MODE_FULL) {
+            cortex->evols_count++;
+        }
+        cortex->ticks_count++;
+        cortex->rand_ticks_count++;
+    }
+
+    prof_span_end(prof_phase, prof_start);
+}
+
+error_code_t c2d_sat_update(cortex2d_t* cortex, sat2d_t* sat) {
+    if (cortex->width != sat->width || cortex->height != sat->height) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    cortex_size_t sat_width = sat->width + 1;
+
+    // Row-wise prefix sums: rows are independent.
+    #pragma omp parallel for
+    for (cortex_size_t y = 0; y < cortex->height; y++) {
+        int64_t spikes = 0;
+        int64_t pulse = 0;
+        int64_t value = 0;
+        for (cortex_size_t x = 0; x < cortex->width; x++) {
+            neuron_t* neuron = &(cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)]);
+            spikes += neuron->pulse_mask & 0x01U;
+            pulse += neuron->pulse;
+            value += neuron->value;
+
+            cortex_size_t sat_index = IDX2D(x + 1, y + 1, sat_width);
+            sat->spikes[sat_index] = spikes;
+            sat->pulse[sat_index] = pulse;
+            sat->value[sat_index] = value;
+        }
+    }
+
+    // Column-wise prefix sums: columns are independent, so they're split in blocks among threads while each block walks rows in order,
+    // keeping memory accesses contiguous.
+    #pragma omp parallel for
+    for (cortex_size_t block_x = 1; block_x < sat_width; block_x += SAT_BLOCK_SIZE) {
+        cortex_size_t block_end = block_x + SAT_BLOCK_SIZE < sat_width ? block_x + SAT_BLOCK_SIZE : sat_width;
+        for (cortex_size_t y = 2; y < sat->height + 1; y++) {
+            for (cortex_size_t x = block_x; x < block_end; x++) {
+                cortex_size_t sat_index = IDX2D(x, y, sat_width);
+                sat->spikes[sat_index] += sat->spikes[sat_index - sat_width];
+                sat->pulse[sat_index] += sat->pulse[sat_index - sat_width];
+                sat->value[sat_index] += sat->value[sat_index - sat_width];
+            }
+        }
+    }
+
+    return ERROR_NONE;
+}
+
+// Sums the given plane of a summed-area table over the [x0, x1) x [y0, y1) rectangle.
+static inline int64_t sat2d_sum(const int64_t* plane, cortex_size_t sat_width, cortex_size_t x0, cortex_size_t y0, cortex_size_t x1, cortex_size_t y1) {
+    return plane[IDX2D(x1, y1, sat_width)] - plane[IDX2D(x0, y1, sat_width)] - plane[IDX2D(x1, y0, sat_width)] + plane[IDX2D(x0, y0, sat_width)];
+}
+
+bool_t o2d_read(output2d_t* output, sat2d_t* sat) {
+    // Outputs reaching past the table are never read.
+    if (output->x1 > sat->width || output->y1 > sat->height) {
+        return FALSE;
+    }
+
+    const int64_t* plane = output->readout == READOUT_SPIKES ? sat->spikes : output->readout == READOUT_PULSE ? sat->pulse : sat->value;
+    cortex_size_t sat_width = sat->width + 1;
+    cortex_size_t width = output->x1 - output->x0;
+    cortex_size_t height = output->y1 - output->y0;
+
+    output->samples_count++;
+    bool_t window_complete = output->samples_count >= output->window;
+
+    for (cortex_size_t row = 0; row < output->rows; row++) {
+        // Cells split the area as evenly as possible.
+        cortex_size_t y0 = output->y0 + (row * height) / output->rows;
+        cortex_size_t y1 = output->y0 + ((row + 1) * height) / output->rows;
+        for (cortex_size_t col = 0; col < output->cols; col++) {
+            cortex_size_t x0 = output->x0 + (col * width) / output->cols;
+            cortex_size_t x1 = output->x0 + ((col + 1) * width) / output->cols;
+            cortex_size_t cell_index = IDX2D(col, row, output->cols);
+
+            output->sums[cell_index] += sat2d_sum(plane, sat_width, x0, y0, x1, y1);
+
+            if (window_complete) {
+                if (output->readout == READOUT_SPIKES) {
+                    output->values[cell_index] = (float) output->sums[cell_index];
+                } else {
+                    output->values[cell_index] = (float) output->sums[cell_index] / (float) ((x1 - x0) * (y1 - y0) * output->samples_count);
+                }
+                output->sums[cell_index] = 0;
+            }
+        }
+    }
+
+    if (window_complete) {
+        output->samples_count = 0x00U;
+    }
+
+    return window_complete;
 }
 
 bool_t pulse_map(ticks_count_t sample_window, ticks_count_t sample_step, ticks_count_t input, pulse_mapping_t pulse_mapping) {
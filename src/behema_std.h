@@ -19,15 +19,45 @@ Copyright (C) 2021 Luka Micheletti
 #include "cortex.h"
 #include "error.h"
 #include "utils.h"
+#include "profiler.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Number of columns processed by each thread when computing summed-area tables.
+#define SAT_BLOCK_SIZE 0x40
+
 // Util functions:
 
 /// Marsiglia's xorshift pseudo-random number generator with period 2^32-1.
-uint32_t xorshf32();
+uint32_t xorshf32(uint32_t state);
+
+/// Widynski's "Squares" counter-based pseudo-random number generator.
+/// Returns the draw at position counter in the stream identified by key: draws are random-access and independent from each other.
+/// @param counter The position of the draw in the stream.
+/// @param key The stream key, use squares_key to derive one.
+static inline uint32_t squares32(uint64_t counter, uint64_t key) {
+    uint64_t x = counter * key;
+    uint64_t y = x;
+    uint64_t z = y + key;
+    x = x * x + y;
+    x = (x >> 32) | (x << 32);
+    x = x * x + z;
+    x = (x >> 32) | (x << 32);
+    x = x * x + y;
+    x = (x >> 32) | (x << 32);
+    return (uint32_t) ((x * x + z) >> 32);
+}
+
+/// Derives a well-mixed squares32 key (odd, with dense high bits) from a seed and a stream index (e.g. a neuron index).
+static inline uint64_t squares_key(uint32_t seed, uint64_t index) {
+    // Splitmix64 finalizer.
+    uint64_t z = (((uint64_t) seed) << 32 ^ index) + 0x9E3779B97F4A7C15UL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+    return (z ^ (z >> 31)) | 0x01U;
+}
 
 
 // Execution functions:
@@ -38,7 +68,75 @@ uint32_t xorshf32();
 void c2d_feed2d(cortex2d_t* cortex, input2d_t* input);
 
 /// Performs a full run cycle over the network cortex.
-void c2d_tick(cortex2d_t* prev_cortex, cortex2d_t* next_cortex);
+/// @return ERROR_CORTEX_UNALLOC if prev_cortex is wrapped without its ghost border (see c2d_set_wrapped), in which case nothing is ticked.
+error_code_t c2d_tick(cortex2d_t* prev_cortex, cortex2d_t* next_cortex);
+
+/// Performs a full run cycle over the given pair's current view, then makes the result the current view.
+/// @return ERROR_CORTEX_UNALLOC if the current view is wrapped without its ghost border, in which case nothing is ticked.
+error_code_t c2d_pair_tick(c2d_pair_t* pair);
+
+/// Performs a full run cycle over the given cortex in place, with no second cortex involved: the previous state of the few rows
+/// around the ones being ticked is kept aside, in small rolling windows. Gives the same result as c2d_tick.
+/// @param cortex The cortex to tick.
+/// @return ERROR_FAILED_ALLOC if the rolling windows can't be allocated, ERROR_CORTEX_UNALLOC if the cortex is wrapped without its ghost border,
+/// in which case the cortex is left untouched.
+error_code_t c2d_tick_inplace(cortex2d_t* cortex);
+
+/// Performs a full run cycle over the given out-of-core cortex, one band of rows at a time, then makes the result its current view.
+/// @return ERROR_CORTEX_UNALLOC if the current view is wrapped without its ghost border, in which case nothing is ticked.
+error_code_t ooc2d_tick(ooc2d_t* ooc);
+
+/// Feeds the given subdomain with the part of the provided input2d falling inside it.
+/// @param dom The subdomain to feed.
+/// @param input The input to feed the subdomain, in whole cortex coordinates.
+void dom2d_feed2d(dom2d_t* dom, input2d_t* input);
+
+/// Performs a full run cycle over the given subdomain, then makes the result its current view. All ranks must tick their subdomains together.
+/// Owned neurons are sent to neighboring subdomains first, then interior neurons are ticked while halos are being exchanged, and only then
+/// the neurons along the halos.
+/// @return Any error from the transport, in which case the current view is left untouched.
+error_code_t dom2d_tick(dom2d_t* dom);
+
+/// Feeds a 3D cortex with the provided input3d.
+/// @param cortex The cortex to feed.
+/// @param input The input to feed the cortex.
+void c3d_feed3d(cortex3d_t* cortex, input3d_t* input);
+
+/// Performs a full run cycle over the 3D cortex, one brick at a time: each brick's neighbors are gathered once in a small tile,
+/// which then serves all of the brick's neurons.
+void c3d_tick(cortex3d_t* prev_cortex, cortex3d_t* next_cortex);
+
+/// Feeds a frozen cortex with the provided input2d.
+/// @param frozen The frozen cortex to feed.
+/// @param input The input to feed the frozen cortex.
+void f2d_feed2d(frozen2d_t* frozen, input2d_t* input);
+
+/// Performs a run cycle over the frozen cortex, only walking its compiled edges, either pulling or pushing them according to its propagation strategy.
+/// Gives the same neurons state as c2d_tick on the cortex it was compiled from, as long as the latter doesn't evolve. Random states are only
+/// caught up when copied back by f2d_to_cortex.
+void f2d_tick(frozen2d_t* frozen);
+
+/// Feeds all lanes of an ensemble with the provided input2d.
+/// @param ensemble The ensemble to feed.
+/// @param input The input to feed the ensemble.
+void e2d_feed2d(ensemble2d_t* ensemble, input2d_t* input);
+
+/// Performs a full run cycle over all lanes of the ensemble. Each lane gets the same result as c2d_tick on the cortex it was built from.
+/// Neighborhood math is shared by all lanes, while integration and neurons update are vectorized across lanes.
+void e2d_tick(ensemble2d_t* ensemble);
+
+/// Rebuilds the summed-area table of the given cortex. Should be called once per tick, after c2d_tick, on its next_cortex.
+/// Any number of outputs can then be read from the table at almost no cost.
+/// @param cortex The cortex to summarize.
+/// @param sat The table to update, must have the same size as the cortex.
+error_code_t c2d_sat_update(cortex2d_t* cortex, sat2d_t* sat);
+
+/// Reads the given output from an updated summed-area table, in O(1) per output cell.
+/// Values are updated once every output->window calls, accumulating in between.
+/// @param output The output to read.
+/// @param sat The summed-area table to read from.
+/// @return TRUE if output->values has been updated by this call, FALSE otherwise or if the output doesn't fit in the table.
+bool_t o2d_read(output2d_t* output, sat2d_t* sat);
 
 
 // Mapping functions.
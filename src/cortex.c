@@ -1,8 +1,82 @@
+// Must come before any include in order to bring in mmap() flags under -std=c17.
+#define _DEFAULT_SOURCE
+
 #include "cortex.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(neuron_t) == (NEURON_PROFILE == NEURON_PROFILE_COMPACT ? NEURON_SIZE_COMPACT : NEURON_SIZE_STANDARD),
+               "neuron_t size does not match its profile");
+
+
+// Magic number identifying out-of-core cortex files ("OOC2").
+#define OOC_MAGIC 0x4F4F4332U
+
+// Header of out-of-core cortex files, stored at the start of the file.
+typedef struct ooc2d_header_t {
+    uint32_t magic;
+    // Size of the neurons in the file, which must match the library's neurons profile.
+    uint32_t neuron_size;
+    // Index of the current neurons buffer.
+    byte current;
+    // Properties of the cortex, neurons pointer excluded.
+    cortex2d_t properties;
+} ooc2d_header_t;
+
+// Size of the header of out-of-core cortex files, padded so that neurons buffers start aligned.
+#define OOC_HEADER_SIZE ((sizeof(ooc2d_header_t) + OOC_ALIGNMENT - 1) / OOC_ALIGNMENT * OOC_ALIGNMENT)
 
 
 // ########################################## Initialization functions ##########################################
 
+// Returns the size in bytes actually allocated for the given amount of neurons.
+static size_t neurons_alloc_size(size_t count) {
+    size_t size = count * sizeof(neuron_t);
+    return size < HUGE_PAGE_SIZE ?
+           (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE :
+           (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+error_code_t neurons_alloc(neuron_t** neurons, size_t count) {
+    size_t size = neurons_alloc_size(count);
+
+    if (size < HUGE_PAGE_SIZE) {
+        // Small arrays span too few pages for TLB misses to matter.
+        (*neurons) = (neuron_t*) aligned_alloc(CACHE_LINE_SIZE, size > 0 ? size : CACHE_LINE_SIZE);
+        return (*neurons) == NULL ? ERROR_FAILED_ALLOC : ERROR_NONE;
+    }
+
+    void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // Explicit huge pages are only available if reserved (see /proc/sys/vm/nr_hugepages).
+    memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (memory == MAP_FAILED) {
+        // Fall back to transparent huge pages, which are only used for huge page aligned ranges:
+        // map an extra huge page and trim the unaligned head and tail.
+        byte* mapped = (byte*) mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            (*neurons) = NULL;
+            return ERROR_FAILED_ALLOC;
+        }
+        size_t head = (HUGE_PAGE_SIZE - (uintptr_t) mapped % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+        if (head > 0) {
+            munmap(mapped, head);
+        }
+        munmap(mapped + head + size, HUGE_PAGE_SIZE - head);
+        memory = mapped + head;
+
+#ifdef MADV_HUGEPAGE
+        madvise(memory, size, MADV_HUGEPAGE);
+#endif
+    }
+
+    (*neurons) = (neuron_t*) memory;
+    return ERROR_NONE;
+}
+
 error_code_t i2d_init(input2d_t** input, cortex_size_t x0, cortex_size_t y0, cortex_size_t x1, cortex_size_t y1, neuron_value_t exc_value, pulse_mapping_t pulse_mapping) {
     // Allocate the input.
     (*input) = (input2d_t*) malloc(sizeof(input2d_t));
@@ -26,8 +100,168 @@ error_code_t i2d_init(input2d_t** input, cortex_size_t x0, cortex_size_t y0, cor
     return ERROR_NONE;
 }
 
+error_code_t i3d_init(input3d_t** input, cortex_size_t x0, cortex_size_t y0, cortex_size_t z0, cortex_size_t x1, cortex_size_t y1, cortex_size_t z1, neuron_value_t exc_value, pulse_mapping_t pulse_mapping) {
+    // Allocate the input.
+    (*input) = (input3d_t*) malloc(sizeof(input3d_t));
+    if ((*input) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    (*input)->x0 = x0;
+    (*input)->y0 = y0;
+    (*input)->z0 = z0;
+    (*input)->x1 = x1;
+    (*input)->y1 = y1;
+    (*input)->z1 = z1;
+    (*input)->exc_value = exc_value;
+    (*input)->pulse_mapping = pulse_mapping;
+
+    // Allocate values.
+    (*input)->values = (ticks_count_t*) malloc((size_t) (x1 - x0) * (size_t) (y1 - y0) * (size_t) (z1 - z0) * sizeof(ticks_count_t));
+    if ((*input)->values == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    return ERROR_NONE;
+}
+
+error_code_t o2d_init(output2d_t** output, cortex_size_t x0, cortex_size_t y0, cortex_size_t x1, cortex_size_t y1, cortex_size_t cols, cortex_size_t rows, readout_t readout, ticks_count_t window) {
+    // Every cell must contain at least one neuron, and the area can't start before the cortex.
+    if (x0 < 0 || y0 < 0 || cols <= 0 || rows <= 0 || x1 - x0 < cols || y1 - y0 < rows) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    // Allocate the output.
+    (*output) = (output2d_t*) malloc(sizeof(output2d_t));
+    if ((*output) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    (*output)->x0 = x0;
+    (*output)->y0 = y0;
+    (*output)->x1 = x1;
+    (*output)->y1 = y1;
+    (*output)->cols = cols;
+    (*output)->rows = rows;
+    (*output)->readout = readout;
+    (*output)->window = window > 0 ? window : 1;
+    (*output)->samples_count = 0x00U;
+
+    // Allocate sums and values.
+    (*output)->sums = (int64_t*) calloc(cols * rows, sizeof(int64_t));
+    (*output)->values = (float*) calloc(cols * rows, sizeof(float));
+    if ((*output)->sums == NULL || (*output)->values == NULL) {
+        o2d_destroy(*output);
+        (*output) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    return ERROR_NONE;
+}
+
+error_code_t sat2d_init(sat2d_t** sat, cortex_size_t width, cortex_size_t height) {
+    // Allocate the table.
+    (*sat) = (sat2d_t*) malloc(sizeof(sat2d_t));
+    if ((*sat) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    (*sat)->width = width;
+    (*sat)->height = height;
+
+    // Allocate the planes, leading row and column are zeroed once here and never written again.
+    size_t size = (size_t) (width + 1) * (size_t) (height + 1);
+    (*sat)->spikes = (int64_t*) calloc(size, sizeof(int64_t));
+    (*sat)->pulse = (int64_t*) calloc(size, sizeof(int64_t));
+    (*sat)->value = (int64_t*) calloc(size, sizeof(int64_t));
+    if ((*sat)->spikes == NULL || (*sat)->pulse == NULL || (*sat)->value == NULL) {
+        sat2d_destroy(*sat);
+        (*sat) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    return ERROR_NONE;
+}
+
+// Returns whether cortices with the given neighborhood radius need wide masks.
+static bool_t c2d_nh_wide(nh_radius_t nh_radius) {
+    return NH_MASK_WORDS_2D(NH_DIAM_2D(nh_radius)) > 1;
+}
+
+// Allocates the given amount of cleared wide synapses, cache line aligned.
+static error_code_t wide_synapses_alloc(wide_synapses_t** wide_synapses, size_t count) {
+    size_t size = (count * sizeof(wide_synapses_t) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    (*wide_synapses) = (wide_synapses_t*) aligned_alloc(CACHE_LINE_SIZE, size > 0 ? size : CACHE_LINE_SIZE);
+    if ((*wide_synapses) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+    memset(*wide_synapses, 0x00, size);
+    return ERROR_NONE;
+}
+
+// Sets up the given cortex' properties to their default values.
+static void c2d_init_props(cortex2d_t* cortex, cortex_size_t width, cortex_size_t height, nh_radius_t nh_radius) {
+    cortex->width = width;
+    cortex->height = height;
+    cortex->ticks_count = 0x00U;
+    cortex->evols_count = 0x00U;
+    cortex->evol_step = DEFAULT_EVOL_STEP;
+    cortex->evol_mode = EVOL_MODE_FULL;
+    cortex->pulse_window = DEFAULT_PULSE_WINDOW;
+
+    cortex->nh_radius = nh_radius;
+    cortex->wrapped = FALSE;
+    cortex->fire_threshold = DEFAULT_THRESHOLD;
+    cortex->recovery_value = DEFAULT_RECOVERY_VALUE;
+    cortex->exc_value = DEFAULT_EXC_VALUE;
+    cortex->decay_value = DEFAULT_DECAY_RATE;
+    cortex->syngen_chance = DEFAULT_SYNGEN_CHANCE;
+    cortex->synstr_chance = DEFAULT_SYNSTR_CHANCE;
+    cortex->max_tot_strength = DEFAULT_MAX_TOT_STRENGTH;
+    cortex->max_syn_count = DEFAULT_MAX_TOUCH * NH_COUNT_2D(NH_DIAM_2D(nh_radius));
+    cortex->inhexc_range = DEFAULT_INHEXC_RANGE;
+
+    cortex->sample_window = DEFAULT_SAMPLE_WINDOW;
+    cortex->pulse_mapping = PULSE_MAPPING_LINEAR;
+    cortex->rand_mode = RAND_MODE_XORSHIFT;
+    cortex->rand_seed = 0x00U;
+    cortex->rand_ticks_count = 0x00U;
+    cortex->neurons_order = NEURONS_ORDER_ROWS;
+    cortex->ghosts = NULL;
+}
+
+// Sets up the given cortex' neurons to their default values.
+// The cortex may be part of a bigger one of the given size, whose neurons it should match: its origin is then the position of its top left neuron
+// in the latter. Neurons falling outside of the bigger cortex (e.g. halos of a wrapped one) match the ones on the opposite edges.
+static void c2d_init_neurons(cortex2d_t* cortex, cortex_size_t x_origin, cortex_size_t y_origin, cortex_size_t outer_width, cortex_size_t outer_height) {
+    for (cortex_size_t y = 0; y < cortex->height; y++) {
+        for (cortex_size_t x = 0; x < cortex->width; x++) {
+            uint32_t outer_x = (uint32_t) WRAP(x + x_origin, outer_width);
+            uint32_t outer_y = (uint32_t) WRAP(y + y_origin, outer_height);
+
+            neuron_t* neuron = &(cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)]);
+            neuron->synac_mask = 0x00U;
+            neuron->synex_mask = 0x00U;
+            neuron->synstr_mask_a = 0x00U;
+            neuron->synstr_mask_b = 0x00U;
+            neuron->synstr_mask_c = 0x00U;
+
+            // The starting random state should be different for each neuron, otherwise repeting patterns occur.
+            // The shift is computed on unsigned values and modulo the state width, so that it's defined for any coordinates.
+            neuron->rand_state = (rand_state_t) (outer_x << (outer_y % (sizeof(rand_state_t) * 8)));
+            neuron->pulse_mask = 0x00U;
+            neuron->pulse = 0x00U;
+            neuron->value = DEFAULT_STARTING_VALUE;
+            neuron->max_syn_count = cortex->max_syn_count;
+            neuron->syn_count = 0x00U;
+            neuron->tot_syn_strength = 0x00U;
+            neuron->inhexc_ratio = DEFAULT_INHEXC_RATIO;
+        }
+    }
+}
+
 error_code_t c2d_init(cortex2d_t** cortex, cortex_size_t width, cortex_size_t height, nh_radius_t nh_radius) {
-    if (NH_COUNT_2D(NH_DIAM_2D(nh_radius)) > sizeof(nh_mask_t) * 8) {
+    if (NH_MASK_WORDS_2D(NH_DIAM_2D(nh_radius)) > NH_MASK_WORDS_MAX) {
         // The provided radius makes for too many neighbors, which will end up in overflows, resulting in unexpected behavior during syngen.
         return ERROR_NH_RADIUS_TOO_BIG;
     }
@@ -38,9 +272,56 @@ error_code_t c2d_init(cortex2d_t** cortex, cortex_size_t width, cortex_size_t he
         return ERROR_FAILED_ALLOC;
     }
 
+    // Setup cortex properties.
+    c2d_init_props(*cortex, width, height, nh_radius);
+
+    // Allocate neurons.
+    error_code_t error = neurons_alloc(&((*cortex)->neurons), (size_t) width * (size_t) height);
+    if (error != ERROR_NONE) {
+        free(*cortex);
+        (*cortex) = NULL;
+        return error;
+    }
+
+    // Setup neurons' properties.
+    c2d_init_neurons(*cortex, 0, 0, width, height);
+
+    // Allocate wide synapses if the neighborhood doesn't fit the neurons' masks.
+    (*cortex)->wide_synapses = NULL;
+    if (c2d_nh_wide(nh_radius)) {
+        error = wide_synapses_alloc(&((*cortex)->wide_synapses), (size_t) width * (size_t) height);
+        if (error != ERROR_NONE) {
+            neurons_free((*cortex)->neurons, (size_t) width * (size_t) height);
+            free(*cortex);
+            (*cortex) = NULL;
+            return error;
+        }
+    }
+
+    return ERROR_NONE;
+}
+
+// Returns the number of neurons stored by the given 3D cortex, bricks padding included.
+static size_t c3d_neurons_count(cortex3d_t* cortex) {
+    return (size_t) cortex->bricks_x * (size_t) cortex->bricks_y * (size_t) cortex->bricks_z * BRICK_SIZE_3D;
+}
+
+error_code_t c3d_init(cortex3d_t** cortex, cortex_size_t width, cortex_size_t height, cortex_size_t depth, nh_radius_t nh_radius) {
+    if (nh_radius < 0 || (size_t) NH_COUNT_3D(NH_DIAM_3D(nh_radius)) >= sizeof(nh_mask_t) * 8) {
+        // The whole neighborhood, central neuron included, must fit a mask.
+        return ERROR_NH_RADIUS_TOO_BIG;
+    }
+
+    // Allocate the cortex.
+    (*cortex) = (cortex3d_t*) malloc(sizeof(cortex3d_t));
+    if ((*cortex) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
     // Setup cortex properties.
     (*cortex)->width = width;
     (*cortex)->height = height;
+    (*cortex)->depth = depth;
     (*cortex)->ticks_count = 0x00U;
     (*cortex)->evols_count = 0x00U;
     (*cortex)->evol_step = DEFAULT_EVOL_STEP;
@@ -54,42 +335,757 @@ error_code_t c2d_init(cortex2d_t** cortex, cortex_size_t width, cortex_size_t he
     (*cortex)->syngen_chance = DEFAULT_SYNGEN_CHANCE;
     (*cortex)->synstr_chance = DEFAULT_SYNSTR_CHANCE;
     (*cortex)->max_tot_strength = DEFAULT_MAX_TOT_STRENGTH;
-    (*cortex)->max_syn_count = DEFAULT_MAX_TOUCH * NH_COUNT_2D(NH_DIAM_2D(nh_radius));
+    (*cortex)->max_syn_count = DEFAULT_MAX_TOUCH * NH_COUNT_3D(NH_DIAM_3D(nh_radius));
     (*cortex)->inhexc_range = DEFAULT_INHEXC_RANGE;
 
     (*cortex)->sample_window = DEFAULT_SAMPLE_WINDOW;
     (*cortex)->pulse_mapping = PULSE_MAPPING_LINEAR;
+    (*cortex)->rand_mode = RAND_MODE_XORSHIFT;
+    (*cortex)->rand_seed = 0x00U;
+    (*cortex)->rand_ticks_count = 0x00U;
+
+    (*cortex)->bricks_x = (width + BRICK_SIDE_3D - 1) / BRICK_SIDE_3D;
+    (*cortex)->bricks_y = (height + BRICK_SIDE_3D - 1) / BRICK_SIDE_3D;
+    (*cortex)->bricks_z = (depth + BRICK_SIDE_3D - 1) / BRICK_SIDE_3D;
 
     // Allocate neurons.
-    (*cortex)->neurons = (neuron_t*) malloc((*cortex)->width * (*cortex)->height * sizeof(neuron_t));
-    if ((*cortex)->neurons == NULL) {
+    error_code_t error = neurons_alloc(&((*cortex)->neurons), c3d_neurons_count(*cortex));
+    if (error != ERROR_NONE) {
+        return error;
+    }
+
+    // Setup neurons' properties, padding ones included.
+    for (cortex_size_t z = 0; z < (*cortex)->bricks_z * BRICK_SIDE_3D; z++) {
+        for (cortex_size_t y = 0; y < (*cortex)->bricks_y * BRICK_SIDE_3D; y++) {
+            for (cortex_size_t x = 0; x < (*cortex)->bricks_x * BRICK_SIDE_3D; x++) {
+                neuron_t* neuron = c3d_neuron(*cortex, x, y, z);
+                neuron->synac_mask = 0x00U;
+                neuron->synex_mask = 0x00U;
+                neuron->synstr_mask_a = 0x00U;
+                neuron->synstr_mask_b = 0x00U;
+                neuron->synstr_mask_c = 0x00U;
+
+                // The starting random state should be different for each neuron, otherwise repeting patterns occur.
+                // The first layer starts like a 2D cortex of the same size.
+                neuron->rand_state = (x << y) ^ (z << 0x10U);
+                neuron->pulse_mask = 0x00U;
+                neuron->pulse = 0x00U;
+                neuron->value = DEFAULT_STARTING_VALUE;
+                neuron->max_syn_count = (*cortex)->max_syn_count;
+                neuron->syn_count = 0x00U;
+                neuron->tot_syn_strength = 0x00U;
+                neuron->inhexc_ratio = DEFAULT_INHEXC_RATIO;
+            }
+        }
+    }
+
+    return ERROR_NONE;
+}
+
+error_code_t c2d_pair_init(c2d_pair_t** pair, cortex_size_t width, cortex_size_t height, nh_radius_t nh_radius) {
+    if (NH_MASK_WORDS_2D(NH_DIAM_2D(nh_radius)) > NH_MASK_WORDS_MAX) {
+        return ERROR_NH_RADIUS_TOO_BIG;
+    }
+
+    // Allocate the pair.
+    (*pair) = (c2d_pair_t*) malloc(sizeof(c2d_pair_t));
+    if ((*pair) == NULL) {
         return ERROR_FAILED_ALLOC;
     }
 
-    // Setup neurons' properties.
-    for (cortex_size_t y = 0; y < (*cortex)->height; y++) {
-        for (cortex_size_t x = 0; x < (*cortex)->width; x++) {
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].synac_mask = 0x00U;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].synex_mask = 0x00U;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].synstr_mask_a = 0x00U;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].synstr_mask_b = 0x00U;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].synstr_mask_c = 0x00U;
+    // Allocate both neurons buffers in a single arena. Neurons fill whole cache lines, so both buffers start on their own.
+    size_t neurons_count = (size_t) width * (size_t) height;
+    error_code_t error = neurons_alloc(&((*pair)->arena), neurons_count * 2);
+    if (error != ERROR_NONE) {
+        return error;
+    }
 
-            // The starting random state should be different for each neuron, otherwise repeting patterns occur.
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].rand_state = x << y;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].pulse_mask = 0x00U;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].pulse = 0x00U;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].value = DEFAULT_STARTING_VALUE;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].max_syn_count = (*cortex)->max_syn_count;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].syn_count = 0x00U;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].tot_syn_strength = 0x00U;
-            (*cortex)->neurons[IDX2D(x, y, (*cortex)->width)].inhexc_ratio = DEFAULT_INHEXC_RATIO;
+    // Only the current view holds meaningful neurons: the next one is entirely overwritten by every tick.
+    (*pair)->current = 0x00U;
+    c2d_init_props(&((*pair)->views[0]), width, height, nh_radius);
+    (*pair)->views[0].neurons = (*pair)->arena;
+    c2d_init_neurons(&((*pair)->views[0]), 0, 0, width, height);
+
+    // Wide synapses get their own arena, split between the views in the same way.
+    (*pair)->wide_arena = NULL;
+    if (c2d_nh_wide(nh_radius)) {
+        error = wide_synapses_alloc(&((*pair)->wide_arena), neurons_count * 2);
+        if (error != ERROR_NONE) {
+            return error;
+        }
+    }
+    (*pair)->views[0].wide_synapses = (*pair)->wide_arena;
+
+    (*pair)->views[1] = (*pair)->views[0];
+    (*pair)->views[1].neurons = (*pair)->arena + neurons_count;
+    (*pair)->views[1].wide_synapses = (*pair)->wide_arena != NULL ? (*pair)->wide_arena + neurons_count : NULL;
+
+    return ERROR_NONE;
+}
+
+// Returns the size of each of the neurons buffers in an out-of-core cortex file.
+static size_t ooc2d_buffer_size(cortex_size_t width, cortex_size_t height) {
+    size_t size = (size_t) width * (size_t) height * sizeof(neuron_t);
+    return (size + OOC_ALIGNMENT - 1) / OOC_ALIGNMENT * OOC_ALIGNMENT;
+}
+
+// Maps the given file, which must already have the right size, and points the views' neurons to its buffers.
+static error_code_t ooc2d_map(ooc2d_t** ooc, int file, cortex_size_t width, cortex_size_t height) {
+    (*ooc) = (ooc2d_t*) calloc(1, sizeof(ooc2d_t));
+    if ((*ooc) == NULL) {
+        close(file);
+        return ERROR_FAILED_ALLOC;
+    }
+
+    (*ooc)->file = file;
+    (*ooc)->mapping_size = OOC_HEADER_SIZE + 2 * ooc2d_buffer_size(width, height);
+    (*ooc)->mapping = (byte*) mmap(NULL, (*ooc)->mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if ((*ooc)->mapping == MAP_FAILED) {
+        close(file);
+        free(*ooc);
+        (*ooc) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    (*ooc)->pair.arena = (neuron_t*) ((*ooc)->mapping + OOC_HEADER_SIZE);
+    (*ooc)->pair.views[0].neurons = (*ooc)->pair.arena;
+    (*ooc)->pair.views[1].neurons = (neuron_t*) ((*ooc)->mapping + OOC_HEADER_SIZE + ooc2d_buffer_size(width, height));
+
+    // Default to bands holding about DEFAULT_OOC_BAND_SIZE bytes of neurons.
+    size_t row_size = (size_t) width * sizeof(neuron_t);
+    (*ooc)->band_rows = row_size > 0 && DEFAULT_OOC_BAND_SIZE / row_size > 0 ? (cortex_size_t) (DEFAULT_OOC_BAND_SIZE / row_size) : 1;
+
+    return ERROR_NONE;
+}
+
+error_code_t ooc2d_init(ooc2d_t** ooc, cortex_size_t width, cortex_size_t height, nh_radius_t nh_radius, char* file_name) {
+    if (nh_radius < 0 || (size_t) NH_COUNT_2D(NH_DIAM_2D(nh_radius)) > sizeof(nh_mask_t) * 8) {
+        return ERROR_NH_RADIUS_TOO_BIG;
+    }
+
+    int file = open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+    if (ftruncate(file, (off_t) (OOC_HEADER_SIZE + 2 * ooc2d_buffer_size(width, height))) != 0) {
+        close(file);
+        return ERROR_FAILED_ALLOC;
+    }
+
+    error_code_t error = ooc2d_map(ooc, file, width, height);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+
+    // Only the current view holds meaningful neurons: the next one is entirely overwritten by every tick.
+    neuron_t* next_neurons = (*ooc)->pair.views[1].neurons;
+    (*ooc)->pair.current = 0x00U;
+    c2d_init_props(&((*ooc)->pair.views[0]), width, height, nh_radius);
+    c2d_init_neurons(&((*ooc)->pair.views[0]), 0, 0, width, height);
+    (*ooc)->pair.views[1] = (*ooc)->pair.views[0];
+    (*ooc)->pair.views[1].neurons = next_neurons;
+
+    return ooc2d_sync(*ooc);
+}
+
+error_code_t ooc2d_open(ooc2d_t** ooc, char* file_name) {
+    int file = open(file_name, O_RDWR);
+    if (file < 0) {
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+
+    // Read and check the header.
+    ooc2d_header_t header;
+    if (pread(file, &header, sizeof(ooc2d_header_t), 0) != sizeof(ooc2d_header_t) ||
+        header.magic != OOC_MAGIC ||
+        header.neuron_size != sizeof(neuron_t) ||
+        header.current > 0x01U) {
+        close(file);
+        return ERROR_FILE_WRONG_FORMAT;
+    }
+
+    struct stat file_stat;
+    cortex2d_t* properties = &(header.properties);
+    if (fstat(file, &file_stat) != 0 ||
+        (size_t) file_stat.st_size != OOC_HEADER_SIZE + 2 * ooc2d_buffer_size(properties->width, properties->height)) {
+        close(file);
+        return ERROR_FILE_SIZE_WRONG;
+    }
+
+    error_code_t error = ooc2d_map(ooc, file, properties->width, properties->height);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+
+    // Both views share the stored properties.
+    for (byte i = 0; i < 2; i++) {
+        neuron_t* neurons = (*ooc)->pair.views[i].neurons;
+        (*ooc)->pair.views[i] = *properties;
+        (*ooc)->pair.views[i].neurons = neurons;
+        (*ooc)->pair.views[i].wide_synapses = NULL;
+        (*ooc)->pair.views[i].ghosts = NULL;
+    }
+    (*ooc)->pair.current = header.current;
+
+    // Wrapped cortices need their ghost border back.
+    if (properties->wrapped) {
+        ooc2d_current(*ooc)->wrapped = FALSE;
+        error = c2d_set_wrapped(ooc2d_current(*ooc), TRUE);
+        if (error != ERROR_NONE) {
+            munmap((*ooc)->mapping, (*ooc)->mapping_size);
+            close(file);
+            free(*ooc);
+            (*ooc) = NULL;
+            return error;
+        }
+    }
+
+    return ERROR_NONE;
+}
+
+error_code_t dom2d_init(dom2d_t** dom,
+                        cortex_size_t width,
+                        cortex_size_t height,
+                        nh_radius_t nh_radius,
+                        bool_t wrapped,
+                        uint32_t ranks_x,
+                        uint32_t ranks_y,
+                        uint32_t rank,
+                        halo_transport_t transport) {
+    if (ranks_x == 0 || ranks_y == 0 || rank >= ranks_x * ranks_y) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    (*dom) = (dom2d_t*) calloc(1, sizeof(dom2d_t));
+    if ((*dom) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+    (*dom)->width = width;
+    (*dom)->height = height;
+    (*dom)->wrapped = wrapped;
+    (*dom)->ranks_x = ranks_x;
+    (*dom)->ranks_y = ranks_y;
+    (*dom)->rank = rank;
+
+    // Subdomains split the cortex as evenly as possible.
+    uint32_t rank_x = rank % ranks_x;
+    uint32_t rank_y = rank / ranks_x;
+    (*dom)->x0 = (cortex_size_t) ((int64_t) width * rank_x / ranks_x);
+    (*dom)->x1 = (cortex_size_t) ((int64_t) width * (rank_x + 1) / ranks_x);
+    (*dom)->y0 = (cortex_size_t) ((int64_t) height * rank_y / ranks_y);
+    (*dom)->y1 = (cortex_size_t) ((int64_t) height * (rank_y + 1) / ranks_y);
+
+    // Halos only face neighboring subdomains, so the local cortex is bounded exactly where the whole one is.
+    (*dom)->halo_left = wrapped || rank_x > 0 ? nh_radius : 0;
+    (*dom)->halo_right = wrapped || rank_x < ranks_x - 1 ? nh_radius : 0;
+    (*dom)->halo_top = wrapped || rank_y > 0 ? nh_radius : 0;
+    (*dom)->halo_bottom = wrapped || rank_y < ranks_y - 1 ? nh_radius : 0;
+
+    // Halos are only exchanged between direct neighbors (diagonal ones included), so subdomains can't be narrower than them.
+    // All halos sent in a tick must also fit in a channel, since they may all go to the same rank before any is received.
+    // Both checks are made on the smallest and biggest subdomains, so that all ranks agree on the outcome.
+    cortex_size_t owned_width = (*dom)->x1 - (*dom)->x0;
+    cortex_size_t owned_height = (*dom)->y1 - (*dom)->y0;
+    cortex_size_t max_width = (cortex_size_t) ((width + ranks_x - 1) / ranks_x);
+    cortex_size_t max_height = (cortex_size_t) ((height + ranks_y - 1) / ranks_y);
+    size_t halos_size = ((size_t) 2 * (max_width + max_height) + 4 * nh_radius) * nh_radius * DOM_HALO_NEURON_SIZE;
+    if (width / (cortex_size_t) ranks_x < nh_radius || height / (cortex_size_t) ranks_y < nh_radius || halos_size > transport.channel_size) {
+        free(*dom);
+        (*dom) = NULL;
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    size_t halo_size = (size_t) (owned_width > owned_height ? owned_width : owned_height) * nh_radius * DOM_HALO_NEURON_SIZE;
+    (*dom)->halo_buffer = (byte*) malloc(halo_size > 0 ? halo_size : 1);
+    if ((*dom)->halo_buffer == NULL) {
+        free(*dom);
+        (*dom) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    error_code_t error = c2d_pair_init(&((*dom)->pair),
+                                       (*dom)->halo_left + owned_width + (*dom)->halo_right,
+                                       (*dom)->halo_top + owned_height + (*dom)->halo_bottom,
+                                       nh_radius);
+    if (error != ERROR_NONE) {
+        free((*dom)->halo_buffer);
+        free(*dom);
+        (*dom) = NULL;
+        return error;
+    }
+
+    // Neurons start just like the ones of the whole cortex.
+    c2d_init_neurons(c2d_pair_current((*dom)->pair), (*dom)->x0 - (*dom)->halo_left, (*dom)->y0 - (*dom)->halo_top, width, height);
+
+    (*dom)->transport = transport;
+
+    return ERROR_NONE;
+}
+
+// Computes the coordinates of the neighbor at position k of the neighborhood of (x, y), wrapping them around the cortex edges if it's wrapped.
+// Returns whether the neighbor is read by ticks: the central neuron never is, nor are neighbors outside of a bounded cortex.
+static bool_t c2d_nh_neighbor(cortex2d_t* cortex, cortex_size_t x, cortex_size_t y, cortex_size_t k, cortex_size_t* neighbor_x, cortex_size_t* neighbor_y) {
+    cortex_size_t nh_diameter = NH_DIAM_2D(cortex->nh_radius);
+    if (k == IDX2D(cortex->nh_radius, cortex->nh_radius, nh_diameter)) {
+        return FALSE;
+    }
+
+    *neighbor_x = x + (k % nh_diameter - cortex->nh_radius);
+    *neighbor_y = y + (k / nh_diameter - cortex->nh_radius);
+    if (cortex->wrapped) {
+        *neighbor_x = WRAP(*neighbor_x, cortex->width);
+        *neighbor_y = WRAP(*neighbor_y, cortex->height);
+        return TRUE;
+    }
+
+    return *neighbor_x >= 0 && *neighbor_y >= 0 && *neighbor_x < cortex->width && *neighbor_y < cortex->height;
+}
+
+error_code_t c2d_freeze(frozen2d_t** frozen, cortex2d_t* cortex) {
+    // Frozen edges are compiled from the neurons' own masks.
+    if (cortex->wide_synapses != NULL) {
+        return ERROR_NH_RADIUS_TOO_BIG;
+    }
+
+    // Edges store neuron indexes as cortex_size_t, which keeps them half the size on the hot path of f2d_tick.
+    if ((cortex_index_t) cortex->width * cortex->height > INT32_MAX) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    // Allocate the frozen cortex.
+    (*frozen) = (frozen2d_t*) calloc(1, sizeof(frozen2d_t));
+    if ((*frozen) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    // Copy the properties needed for inference.
+    (*frozen)->width = cortex->width;
+    (*frozen)->height = cortex->height;
+    (*frozen)->ticks_count = cortex->ticks_count;
+    (*frozen)->pulse_window = cortex->pulse_window;
+    (*frozen)->fire_threshold = cortex->fire_threshold;
+    (*frozen)->recovery_value = cortex->recovery_value;
+    (*frozen)->decay_value = cortex->decay_value;
+    (*frozen)->sample_window = cortex->sample_window;
+    (*frozen)->pulse_mapping = cortex->pulse_mapping;
+    (*frozen)->propagation = PROPAGATION_AUTO;
+    (*frozen)->push_fraction = DEFAULT_PUSH_FRACTION;
+    (*frozen)->rand_mode = cortex->rand_mode;
+    (*frozen)->rand_ticks_count = cortex->rand_ticks_count;
+    (*frozen)->frozen_ticks_count = 0;
+
+    size_t neurons_count = (size_t) cortex->width * (size_t) cortex->height;
+
+    // Allocate neurons state.
+    (*frozen)->edges_offsets = (size_t*) malloc((neurons_count + 1) * sizeof(size_t));
+    (*frozen)->values = (neuron_value_t*) malloc(neurons_count * sizeof(neuron_value_t));
+    (*frozen)->next_values = (neuron_value_t*) malloc(neurons_count * sizeof(neuron_value_t));
+    (*frozen)->pulse_masks = (pulse_mask_t*) malloc(neurons_count * sizeof(pulse_mask_t));
+    (*frozen)->pulses = (spikes_count_t*) malloc(neurons_count * sizeof(spikes_count_t));
+    (*frozen)->rand_states = (rand_state_t*) malloc(neurons_count * sizeof(rand_state_t));
+    (*frozen)->out_offsets = (size_t*) calloc(neurons_count + 1, sizeof(size_t));
+    (*frozen)->arrivals = (nh_mask_t*) calloc(neurons_count, sizeof(nh_mask_t));
+    if ((*frozen)->edges_offsets == NULL ||
+        (*frozen)->out_offsets == NULL ||
+        (*frozen)->arrivals == NULL ||
+        (*frozen)->values == NULL ||
+        (*frozen)->next_values == NULL ||
+        (*frozen)->pulse_masks == NULL ||
+        (*frozen)->pulses == NULL ||
+        (*frozen)->rand_states == NULL) {
+        // Arrays not allocated yet are still NULL, so the frozen cortex can be destroyed as a whole.
+        f2d_destroy(*frozen);
+        (*frozen) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    // Count edges first, so that edges can be allocated at once.
+    // Synapses pointing outside of the cortex or to the neuron itself are never used by ticks, so they're dropped.
+    // Synapses of wrapped cortices never point outside of the cortex, since they wrap around its edges like ticks do.
+    size_t edges_count = 0;
+    for (cortex_size_t y = 0; y < cortex->height; y++) {
+        for (cortex_size_t x = 0; x < cortex->width; x++) {
+            neuron_t* neuron = &(cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)]);
+            (*frozen)->edges_offsets[IDX2D(x, y, cortex->width)] = edges_count;
+
+            for (nh_mask_t bits = neuron->synac_mask; bits; bits &= bits - 1) {
+                cortex_size_t neighbor_x;
+                cortex_size_t neighbor_y;
+                if (c2d_nh_neighbor(cortex, x, y, __builtin_ctzll(bits), &neighbor_x, &neighbor_y)) {
+                    edges_count++;
+                }
+            }
+        }
+    }
+    (*frozen)->edges_offsets[neurons_count] = edges_count;
+    (*frozen)->edges_count = edges_count;
+
+    // Allocate edges, at least one of each so that an empty cortex still gets valid pointers.
+    (*frozen)->edges_sources = (cortex_size_t*) malloc((edges_count + 1) * sizeof(cortex_size_t));
+    (*frozen)->edges_weights = (neuron_value_t*) malloc((edges_count + 1) * sizeof(neuron_value_t));
+    if ((*frozen)->edges_sources == NULL || (*frozen)->edges_weights == NULL) {
+        f2d_destroy(*frozen);
+        (*frozen) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    // Fill edges and neurons state.
+    #pragma omp parallel for collapse(2)
+    for (cortex_size_t y = 0; y < cortex->height; y++) {
+        for (cortex_size_t x = 0; x < cortex->width; x++) {
+            cortex_index_t neuron_index = IDX2D(x, y, cortex->width);
+            neuron_t* neuron = &(cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)]);
+            size_t edge = (*frozen)->edges_offsets[neuron_index];
+
+            for (nh_mask_t bits = neuron->synac_mask; bits; bits &= bits - 1) {
+                cortex_size_t k = __builtin_ctzll(bits);
+                cortex_size_t neighbor_x;
+                cortex_size_t neighbor_y;
+                if (c2d_nh_neighbor(cortex, x, y, k, &neighbor_x, &neighbor_y)) {
+                    syn_strength_t syn_strength = ((neuron->synstr_mask_a >> k) & 0x01U) |
+                                                  (((neuron->synstr_mask_b >> k) & 0x01U) << 0x01U) |
+                                                  (((neuron->synstr_mask_c >> k) & 0x01U) << 0x02U);
+
+                    (*frozen)->edges_sources[edge] = IDX2D(neighbor_x, neighbor_y, cortex->width);
+                    (*frozen)->edges_weights[edge] = ((neuron->synex_mask >> k) & 0x01U ? cortex->exc_value : -cortex->exc_value) * ((syn_strength / 4) + 1);
+                    edge++;
+                }
+            }
+
+            (*frozen)->values[neuron_index] = neuron->value;
+            (*frozen)->pulse_masks[neuron_index] = neuron->pulse_mask;
+            (*frozen)->pulses[neuron_index] = neuron->pulse;
+            (*frozen)->rand_states[neuron_index] = neuron->rand_state;
+        }
+    }
+
+    // Build the reverse index: count outgoing edges, then fill them by walking incoming edges in order.
+    (*frozen)->out_targets = (cortex_size_t*) malloc((edges_count + 1) * sizeof(cortex_size_t));
+    (*frozen)->out_slots = (uint8_t*) malloc((edges_count + 1) * sizeof(uint8_t));
+    if ((*frozen)->out_targets == NULL || (*frozen)->out_slots == NULL) {
+        f2d_destroy(*frozen);
+        (*frozen) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    for (size_t edge = 0; edge < edges_count; edge++) {
+        (*frozen)->out_offsets[(*frozen)->edges_sources[edge] + 1]++;
+    }
+    for (size_t i = 0; i < neurons_count; i++) {
+        (*frozen)->out_offsets[i + 1] += (*frozen)->out_offsets[i];
+    }
+
+    // Number of outgoing edges already filled for each neuron.
+    size_t* out_fill = (size_t*) calloc(neurons_count, sizeof(size_t));
+    if (out_fill == NULL) {
+        f2d_destroy(*frozen);
+        (*frozen) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+    size_t active_count = 0;
+    for (size_t target = 0; target < neurons_count; target++) {
+        for (size_t edge = (*frozen)->edges_offsets[target]; edge < (*frozen)->edges_offsets[target + 1]; edge++) {
+            cortex_size_t source = (*frozen)->edges_sources[edge];
+            size_t out_edge = (*frozen)->out_offsets[source] + out_fill[source]++;
+            (*frozen)->out_targets[out_edge] = (cortex_size_t) target;
+            (*frozen)->out_slots[out_edge] = (uint8_t) (edge - (*frozen)->edges_offsets[target]);
+        }
+        if ((*frozen)->values[target] > (*frozen)->fire_threshold) {
+            active_count++;
+        }
+    }
+    free(out_fill);
+    (*frozen)->active_count = active_count;
+
+    return ERROR_NONE;
+}
+
+// Xorshift generators are linear over GF(2), so any number of steps is a 32x32 bit matrix, stored as the images of each state bit.
+// Applies the given steps to the given state.
+static inline uint32_t xorshf32_jump_apply(const uint32_t* jump, uint32_t state) {
+    uint32_t result = 0x00U;
+    for (; state; state &= state - 1) {
+        result ^= jump[__builtin_ctz(state)];
+    }
+    return result;
+}
+
+// Composes the given steps, first then second, into result, which may be either of them.
+static void xorshf32_jump_compose(uint32_t* result, const uint32_t* first, const uint32_t* second) {
+    uint32_t composed[32];
+    for (uint32_t i = 0; i < 32; i++) {
+        composed[i] = xorshf32_jump_apply(second, first[i]);
+    }
+    memcpy(result, composed, sizeof(composed));
+}
+
+// Computes the matrix of the given number of xorshf32 steps, by squaring.
+static void xorshf32_jump_init(uint32_t* jump, uint64_t steps_count) {
+    uint32_t step[32];
+    for (uint32_t i = 0; i < 32; i++) {
+        // Same as xorshf32.
+        uint32_t x = 0x01U << i;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        step[i] = x;
+        jump[i] = 0x01U << i;
+    }
+
+    for (; steps_count > 0; steps_count >>= 1) {
+        if (steps_count & 0x01U) {
+            xorshf32_jump_compose(jump, jump, step);
+        }
+        xorshf32_jump_compose(step, step, step);
+    }
+}
+
+error_code_t f2d_to_cortex(frozen2d_t* frozen, cortex2d_t* cortex) {
+    if (frozen->width != cortex->width || frozen->height != cortex->height) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    // c2d_tick draws a sequential random number for every neighbor inside the cortex at every tick, whether evolving or not.
+    // Each neuron's state is jumped ahead from the one it had when frozen, so that calling this again doesn't advance it twice.
+    if (frozen->rand_mode == RAND_MODE_XORSHIFT) {
+        cortex_size_t nh_size = NH_DIAM_2D(cortex->nh_radius) * NH_DIAM_2D(cortex->nh_radius);
+
+        // Jumps for each possible number of neighbors inside the cortex.
+        uint32_t jumps[sizeof(nh_mask_t) * 8][32];
+        xorshf32_jump_init(jumps[0], 0);
+        if (nh_size > 1) {
+            xorshf32_jump_init(jumps[1], frozen->frozen_ticks_count);
+        }
+        for (cortex_size_t draws_count = 2; draws_count < nh_size; draws_count++) {
+            xorshf32_jump_compose(jumps[draws_count], jumps[draws_count - 1], jumps[1]);
+        }
+
+        #pragma omp parallel for collapse(2)
+        for (cortex_size_t y = 0; y < cortex->height; y++) {
+            for (cortex_size_t x = 0; x < cortex->width; x++) {
+                cortex_size_t draws_count = 0;
+                for (cortex_size_t k = 0; k < nh_size; k++) {
+                    cortex_size_t neighbor_x;
+                    cortex_size_t neighbor_y;
+                    draws_count += c2d_nh_neighbor(cortex, x, y, k, &neighbor_x, &neighbor_y) ? 1 : 0;
+                }
+                cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)].rand_state =
+                    xorshf32_jump_apply(jumps[draws_count], frozen->rand_states[IDX2D(x, y, cortex->width)]);
+            }
+        }
+    }
+
+    #pragma omp parallel for
+    for (cortex_index_t i = 0; i < (cortex_index_t) frozen->width * frozen->height; i++) {
+        // Frozen neurons are in row-major order.
+        neuron_t* neuron = &(cortex->neurons[ORDER_IDX1D(i, cortex->width, cortex->neurons_order)]);
+        neuron->value = frozen->values[i];
+        neuron->pulse_mask = frozen->pulse_masks[i];
+        neuron->pulse = frozen->pulses[i];
+    }
+    cortex->ticks_count = frozen->ticks_count;
+    cortex->rand_ticks_count = frozen->rand_ticks_count;
+
+    return ERROR_NONE;
+}
+
+// Allocates all arrays of an ensemble's neurons state, for the given amount of neurons and lanes.
+static error_code_t e2d_neurons_init(ensemble_neurons_t* neurons, size_t size) {
+    neurons->synac_masks = (nh_mask_t*) malloc(size * sizeof(nh_mask_t));
+    neurons->synex_masks = (nh_mask_t*) malloc(size * sizeof(nh_mask_t));
+    neurons->synstr_masks_a = (nh_mask_t*) malloc(size * sizeof(nh_mask_t));
+    neurons->synstr_masks_b = (nh_mask_t*) malloc(size * sizeof(nh_mask_t));
+    neurons->synstr_masks_c = (nh_mask_t*) malloc(size * sizeof(nh_mask_t));
+    neurons->rand_states = (rand_state_t*) malloc(size * sizeof(rand_state_t));
+    neurons->pulse_masks = (pulse_mask_t*) malloc(size * sizeof(pulse_mask_t));
+    neurons->pulses = (spikes_count_t*) malloc(size * sizeof(spikes_count_t));
+    neurons->values = (neuron_value_t*) malloc(size * sizeof(neuron_value_t));
+    neurons->max_syn_counts = (syn_count_t*) malloc(size * sizeof(syn_count_t));
+    neurons->syn_counts = (syn_count_t*) malloc(size * sizeof(syn_count_t));
+    neurons->tot_syn_strengths = (syn_strength_t*) malloc(size * sizeof(syn_strength_t));
+    neurons->inhexc_ratios = (inhexc_ratio_t*) malloc(size * sizeof(inhexc_ratio_t));
+    if (neurons->synac_masks == NULL ||
+        neurons->synex_masks == NULL ||
+        neurons->synstr_masks_a == NULL ||
+        neurons->synstr_masks_b == NULL ||
+        neurons->synstr_masks_c == NULL ||
+        neurons->rand_states == NULL ||
+        neurons->pulse_masks == NULL ||
+        neurons->pulses == NULL ||
+        neurons->values == NULL ||
+        neurons->max_syn_counts == NULL ||
+        neurons->syn_counts == NULL ||
+        neurons->tot_syn_strengths == NULL ||
+        neurons->inhexc_ratios == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    return ERROR_NONE;
+}
+
+static void e2d_neurons_destroy(ensemble_neurons_t* neurons) {
+    free(neurons->synac_masks);
+    free(neurons->synex_masks);
+    free(neurons->synstr_masks_a);
+    free(neurons->synstr_masks_b);
+    free(neurons->synstr_masks_c);
+    free(neurons->rand_states);
+    free(neurons->pulse_masks);
+    free(neurons->pulses);
+    free(neurons->values);
+    free(neurons->max_syn_counts);
+    free(neurons->syn_counts);
+    free(neurons->tot_syn_strengths);
+    free(neurons->inhexc_ratios);
+}
+
+error_code_t e2d_init(ensemble2d_t** ensemble, cortex2d_t** cortices, cortex_size_t lanes_count) {
+    if (lanes_count <= 0 || lanes_count > ENSEMBLE_MAX_LANES) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    // Lanes hold the neurons' own masks only.
+    if (cortices[0]->wide_synapses != NULL) {
+        return ERROR_NH_RADIUS_TOO_BIG;
+    }
+
+    // All lanes share the same geometry, with neighborhoods cut by the cortex edges.
+    for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+        if (cortices[lane]->width != cortices[0]->width ||
+            cortices[lane]->height != cortices[0]->height ||
+            cortices[lane]->nh_radius != cortices[0]->nh_radius ||
+            cortices[lane]->wrapped) {
+            return ERROR_SIZE_MISMATCH;
+        }
+    }
+
+    // Allocate the ensemble.
+    (*ensemble) = (ensemble2d_t*) calloc(1, sizeof(ensemble2d_t));
+    if ((*ensemble) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    (*ensemble)->width = cortices[0]->width;
+    (*ensemble)->height = cortices[0]->height;
+    (*ensemble)->nh_radius = cortices[0]->nh_radius;
+    (*ensemble)->lanes_count = lanes_count;
+
+    // Allocate lanes properties.
+    (*ensemble)->lanes = (cortex2d_t*) malloc(lanes_count * sizeof(cortex2d_t));
+    (*ensemble)->fire_thresholds = (neuron_value_t*) malloc(lanes_count * sizeof(neuron_value_t));
+    (*ensemble)->recovery_values = (neuron_value_t*) malloc(lanes_count * sizeof(neuron_value_t));
+    (*ensemble)->exc_values = (neuron_value_t*) malloc(lanes_count * sizeof(neuron_value_t));
+    (*ensemble)->decay_values = (neuron_value_t*) malloc(lanes_count * sizeof(neuron_value_t));
+    (*ensemble)->pulse_windows = (spikes_count_t*) malloc(lanes_count * sizeof(spikes_count_t));
+    if ((*ensemble)->lanes == NULL ||
+        (*ensemble)->fire_thresholds == NULL ||
+        (*ensemble)->recovery_values == NULL ||
+        (*ensemble)->exc_values == NULL ||
+        (*ensemble)->decay_values == NULL ||
+        (*ensemble)->pulse_windows == NULL) {
+        // Arrays not allocated yet are still NULL, so the ensemble can be destroyed as a whole.
+        e2d_destroy(*ensemble);
+        (*ensemble) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    // Allocate neurons.
+    size_t neurons_count = (size_t) (*ensemble)->width * (size_t) (*ensemble)->height;
+    error_code_t error = e2d_neurons_init(&((*ensemble)->neurons), neurons_count * lanes_count);
+    if (error != ERROR_NONE) {
+        e2d_destroy(*ensemble);
+        (*ensemble) = NULL;
+        return error;
+    }
+    (*ensemble)->next_values = (neuron_value_t*) malloc(neurons_count * lanes_count * sizeof(neuron_value_t));
+    (*ensemble)->next_pulses = (spikes_count_t*) malloc(neurons_count * lanes_count * sizeof(spikes_count_t));
+    (*ensemble)->fired_lanes = (uint64_t*) malloc(neurons_count * sizeof(uint64_t));
+    (*ensemble)->active_lanes = (uint64_t*) malloc(neurons_count * sizeof(uint64_t));
+    if ((*ensemble)->next_values == NULL ||
+        (*ensemble)->next_pulses == NULL ||
+        (*ensemble)->fired_lanes == NULL ||
+        (*ensemble)->active_lanes == NULL) {
+        e2d_destroy(*ensemble);
+        (*ensemble) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    // Copy lanes properties.
+    for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+        (*ensemble)->lanes[lane] = *(cortices[lane]);
+        (*ensemble)->lanes[lane].neurons = NULL;
+
+        (*ensemble)->fire_thresholds[lane] = cortices[lane]->fire_threshold;
+        (*ensemble)->recovery_values[lane] = cortices[lane]->recovery_value;
+        (*ensemble)->exc_values[lane] = cortices[lane]->exc_value;
+        (*ensemble)->decay_values[lane] = cortices[lane]->decay_value;
+        (*ensemble)->pulse_windows[lane] = cortices[lane]->pulse_window;
+    }
+
+    // Copy neurons state, interleaving lanes. Ensemble neurons are in row-major order.
+    ensemble_neurons_t* neurons = &((*ensemble)->neurons);
+    #pragma omp parallel for
+    for (size_t i = 0; i < neurons_count; i++) {
+        for (cortex_size_t lane = 0; lane < lanes_count; lane++) {
+            neuron_t* neuron = &(cortices[lane]->neurons[ORDER_IDX1D((cortex_index_t) i, cortices[lane]->width, cortices[lane]->neurons_order)]);
+            size_t index = i * lanes_count + lane;
+
+            neurons->synac_masks[index] = neuron->synac_mask;
+            neurons->synex_masks[index] = neuron->synex_mask;
+            neurons->synstr_masks_a[index] = neuron->synstr_mask_a;
+            neurons->synstr_masks_b[index] = neuron->synstr_mask_b;
+            neurons->synstr_masks_c[index] = neuron->synstr_mask_c;
+            neurons->rand_states[index] = neuron->rand_state;
+            neurons->pulse_masks[index] = neuron->pulse_mask;
+            neurons->pulses[index] = neuron->pulse;
+            neurons->values[index] = neuron->value;
+            neurons->max_syn_counts[index] = neuron->max_syn_count;
+            neurons->syn_counts[index] = neuron->syn_count;
+            neurons->tot_syn_strengths[index] = neuron->tot_syn_strength;
+            neurons->inhexc_ratios[index] = neuron->inhexc_ratio;
         }
     }
 
     return ERROR_NONE;
 }
 
+error_code_t e2d_to_cortex(ensemble2d_t* ensemble, cortex_size_t lane, cortex2d_t* cortex) {
+    if (lane < 0 || lane >= ensemble->lanes_count || ensemble->width != cortex->width || ensemble->height != cortex->height) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    // Copy properties, keeping the cortex' own neurons.
+    neuron_t* cortex_neurons = cortex->neurons;
+    wide_synapses_t* cortex_wide_synapses = cortex->wide_synapses;
+    *cortex = ensemble->lanes[lane];
+    cortex->neurons = cortex_neurons;
+    cortex->wide_synapses = cortex_wide_synapses;
+
+    // Copy neurons state.
+    ensemble_neurons_t* neurons = &(ensemble->neurons);
+    #pragma omp parallel for
+    for (cortex_index_t i = 0; i < (cortex_index_t) ensemble->width * ensemble->height; i++) {
+        neuron_t* neuron = &(cortex->neurons[ORDER_IDX1D(i, cortex->width, cortex->neurons_order)]);
+        size_t index = (size_t) i * ensemble->lanes_count + lane;
+
+        neuron->synac_mask = neurons->synac_masks[index];
+        neuron->synex_mask = neurons->synex_masks[index];
+        neuron->synstr_mask_a = neurons->synstr_masks_a[index];
+        neuron->synstr_mask_b = neurons->synstr_masks_b[index];
+        neuron->synstr_mask_c = neurons->synstr_masks_c[index];
+        neuron->rand_state = neurons->rand_states[index];
+        neuron->pulse_mask = neurons->pulse_masks[index];
+        neuron->pulse = neurons->pulses[index];
+        neuron->value = neurons->values[index];
+        neuron->max_syn_count = neurons->max_syn_counts[index];
+        neuron->syn_count = neurons->syn_counts[index];
+        neuron->tot_syn_strength = neurons->tot_syn_strengths[index];
+        neuron->inhexc_ratio = neurons->inhexc_ratios[index];
+    }
+
+    return ERROR_NONE;
+}
+
 error_code_t i2d_destroy(input2d_t* input) {
     // Free values.
     free(input->values);
@@ -100,9 +1096,57 @@ error_code_t i2d_destroy(input2d_t* input) {
     return ERROR_NONE;
 }
 
+error_code_t i3d_destroy(input3d_t* input) {
+    // Free values.
+    free(input->values);
+
+    // Free input.
+    free(input);
+
+    return ERROR_NONE;
+}
+
+error_code_t o2d_destroy(output2d_t* output) {
+    // Free sums and values.
+    free(output->sums);
+    free(output->values);
+
+    // Free output.
+    free(output);
+
+    return ERROR_NONE;
+}
+
+error_code_t sat2d_destroy(sat2d_t* sat) {
+    // Free planes.
+    free(sat->spikes);
+    free(sat->pulse);
+    free(sat->value);
+
+    // Free table.
+    free(sat);
+
+    return ERROR_NONE;
+}
+
+void neurons_free(neuron_t* neurons, size_t count) {
+    if (neurons == NULL) {
+        return;
+    }
+
+    size_t size = neurons_alloc_size(count);
+    if (size < HUGE_PAGE_SIZE) {
+        free(neurons);
+    } else {
+        munmap(neurons, size);
+    }
+}
+
 error_code_t c2d_destroy(cortex2d_t* cortex) {
     // Free neurons.
-    free(cortex->neurons);
+    neurons_free(cortex->neurons, (size_t) cortex->width * (size_t) cortex->height);
+    free(cortex->wide_synapses);
+    free(cortex->ghosts);
 
     // Free cortex.
     free(cortex);
@@ -110,12 +1154,107 @@ error_code_t c2d_destroy(cortex2d_t* cortex) {
     return ERROR_NONE;
 }
 
+error_code_t c3d_destroy(cortex3d_t* cortex) {
+    // Free neurons.
+    neurons_free(cortex->neurons, c3d_neurons_count(cortex));
+
+    // Free cortex.
+    free(cortex);
+
+    return ERROR_NONE;
+}
+
+error_code_t c2d_pair_destroy(c2d_pair_t* pair) {
+    // Free neurons.
+    neurons_free(pair->arena, (size_t) pair->views[0].width * (size_t) pair->views[0].height * 2);
+    free(pair->wide_arena);
+
+    // Views share the current one's ghost border, if any.
+    free(pair->views[pair->current].ghosts);
+
+    // Free pair.
+    free(pair);
+
+    return ERROR_NONE;
+}
+
+error_code_t ooc2d_destroy(ooc2d_t* ooc) {
+    error_code_t error = ooc2d_sync(ooc);
+
+    // Unmap and close the file.
+    munmap(ooc->mapping, ooc->mapping_size);
+    close(ooc->file);
+    free(ooc2d_current(ooc)->ghosts);
+
+    // Free out-of-core cortex.
+    free(ooc);
+
+    return error;
+}
+
+error_code_t dom2d_destroy(dom2d_t* dom) {
+    c2d_pair_destroy(dom->pair);
+    dom->transport.destroy(dom->transport.context);
+
+    // Free subdomain.
+    free(dom->halo_buffer);
+    free(dom);
+
+    return ERROR_NONE;
+}
+
+error_code_t f2d_destroy(frozen2d_t* frozen) {
+    // Free edges.
+    free(frozen->edges_offsets);
+    free(frozen->edges_sources);
+    free(frozen->edges_weights);
+    free(frozen->out_offsets);
+    free(frozen->out_targets);
+    free(frozen->out_slots);
+    free(frozen->arrivals);
+
+    // Free neurons state.
+    free(frozen->values);
+    free(frozen->next_values);
+    free(frozen->pulse_masks);
+    free(frozen->pulses);
+    free(frozen->rand_states);
+
+    // Free frozen cortex.
+    free(frozen);
+
+    return ERROR_NONE;
+}
+
+error_code_t e2d_destroy(ensemble2d_t* ensemble) {
+    // Free neurons.
+    e2d_neurons_destroy(&(ensemble->neurons));
+    free(ensemble->next_values);
+    free(ensemble->next_pulses);
+    free(ensemble->fired_lanes);
+    free(ensemble->active_lanes);
+
+    // Free lanes properties.
+    free(ensemble->lanes);
+    free(ensemble->fire_thresholds);
+    free(ensemble->recovery_values);
+    free(ensemble->exc_values);
+    free(ensemble->decay_values);
+    free(ensemble->pulse_windows);
+
+    // Free ensemble.
+    free(ensemble);
+
+    return ERROR_NONE;
+}
+
 error_code_t c2d_copy(cortex2d_t* to, cortex2d_t* from) {
     to->width = from->width;
     to->height = from->height;
     to->ticks_count = from->ticks_count;
     to->evols_count = from->evols_count;
     to->evol_step = from->evol_step;
+    to->evol_mode = from->evol_mode;
     to->pulse_window = from->pulse_window;
 
     to->nh_radius = from->nh_radius;
@@ -131,22 +1270,103 @@ error_code_t c2d_copy(cortex2d_t* to, cortex2d_t* from) {
 
     to->sample_window = from->sample_window;
     to->pulse_mapping = from->pulse_mapping;
+    to->rand_mode = from->rand_mode;
+    to->rand_seed = from->rand_seed;
+    to->rand_ticks_count = from->rand_ticks_count;
+    to->neurons_order = from->neurons_order;
 
-    for (cortex_size_t y = 0; y < from->height; y++) {
-        for (cortex_size_t x = 0; x < from->width; x++) {
-            to->neurons[IDX2D(x, y, from->width)] = from->neurons[IDX2D(x, y, from->width)];
-        }
+    error_code_t error = c2d_set_wrapped(to, from->wrapped);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+
+    memcpy(to->neurons, from->neurons, (size_t) from->width * (size_t) from->height * sizeof(neuron_t));
+    if (to->wide_synapses != NULL && from->wide_synapses != NULL) {
+        memcpy(to->wide_synapses, from->wide_synapses, (size_t) from->width * (size_t) from->height * sizeof(wide_synapses_t));
     }
 
     return ERROR_NONE;
 }
 
+error_code_t c3d_copy(cortex3d_t* to, cortex3d_t* from) {
+    // Both cortices hold the same neurons count, so all properties but the neurons pointer can be copied at once.
+    neuron_t* to_neurons = to->neurons;
+    *to = *from;
+    to->neurons = to_neurons;
+
+    memcpy(to->neurons, from->neurons, c3d_neurons_count(from) * sizeof(neuron_t));
+
+    return ERROR_NONE;
+}
+
+cortex2d_t* c2d_pair_current(c2d_pair_t* pair) {
+    return &(pair->views[pair->current]);
+}
+
+cortex2d_t* c2d_pair_next(c2d_pair_t* pair) {
+    cortex2d_t* current = &(pair->views[pair->current]);
+    cortex2d_t* next = &(pair->views[pair->current ^ 0x01U]);
+
+    // Share the parameters block: the next view always starts from the current one's properties, so that setters only ever need to target the current view.
+    neuron_t* next_neurons = next->neurons;
+    wide_synapses_t* next_wide_synapses = next->wide_synapses;
+    *next = *current;
+    next->neurons = next_neurons;
+    next->wide_synapses = next_wide_synapses;
+
+    return next;
+}
+
+void c2d_pair_swap(c2d_pair_t* pair) {
+    pair->current ^= 0x01U;
+}
+
+cortex2d_t* ooc2d_current(ooc2d_t* ooc) {
+    return c2d_pair_current(&(ooc->pair));
+}
+
+error_code_t ooc2d_sync(ooc2d_t* ooc) {
+    // Store the current view's properties in the header.
+    ooc2d_header_t header;
+    memset(&header, 0, sizeof(ooc2d_header_t));
+    header.magic = OOC_MAGIC;
+    header.neuron_size = sizeof(neuron_t);
+    header.current = ooc->pair.current;
+    header.properties = *ooc2d_current(ooc);
+    header.properties.neurons = NULL;
+    header.properties.wide_synapses = NULL;
+    header.properties.ghosts = NULL;
+    memcpy(ooc->mapping, &header, sizeof(ooc2d_header_t));
+
+    if (msync(ooc->mapping, ooc->mapping_size, MS_SYNC) != 0) {
+        return ERROR_FILE_WRITE_FAILED;
+    }
+
+    return ERROR_NONE;
+}
+
+
+cortex2d_t* dom2d_current(dom2d_t* dom) {
+    return c2d_pair_current(dom->pair);
+}
+
+neuron_t* dom2d_neuron(dom2d_t* dom, cortex_size_t x, cortex_size_t y) {
+    if (x < dom->x0 || x >= dom->x1 || y < dom->y0 || y >= dom->y1) {
+        return NULL;
+    }
+    return c2d_neuron(dom2d_current(dom), x - dom->x0 + dom->halo_left, y - dom->y0 + dom->halo_top);
+}
 
 // ################################################## Setters ###################################################
 
 error_code_t c2d_set_nhradius(cortex2d_t* cortex, nh_radius_t radius) {
     // Make sure the provided radius is valid.
-    if (radius <= 0 || NH_COUNT_2D(NH_DIAM_2D(radius)) > sizeof(nh_mask_t) * 8) {
+    if (radius <= 0 || NH_MASK_WORDS_2D(NH_DIAM_2D(radius)) > NH_MASK_WORDS_MAX) {
+        return ERROR_NH_RADIUS_TOO_BIG;
+    }
+
+    // Synapses are stored according to the radius the cortex was created with.
+    if (c2d_nh_wide(radius) != (cortex->wide_synapses != NULL)) {
         return ERROR_NH_RADIUS_TOO_BIG;
     }
 
@@ -158,7 +1378,11 @@ error_code_t c2d_set_nhradius(cortex2d_t* cortex, nh_radius_t radius) {
 void c2d_set_nhmask(cortex2d_t* cortex, nh_mask_t mask) {
     for (cortex_size_t y = 0; y < cortex->height; y++) {
         for (cortex_size_t x = 0; x < cortex->width; x++) {
-            cortex->neurons[IDX2D(x, y, cortex->width)].synac_mask = mask;
+            cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)].synac_mask = mask;
+            if (cortex->wide_synapses != NULL) {
+                wide_mask_t wide_mask = {{mask}};
+                cortex->wide_synapses[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)].synac_mask = wide_mask;
+            }
         }
     }
 }
@@ -167,6 +1391,10 @@ void c2d_set_evol_step(cortex2d_t* cortex, evol_step_t evol_step) {
     cortex->evol_step = evol_step;
 }
 
+void c2d_set_evol_mode(cortex2d_t* cortex, evol_mode_t evol_mode) {
+    cortex->evol_mode = evol_mode;
+}
+
 void c2d_set_pulse_window(cortex2d_t* cortex, spikes_count_t window) {
     // The given window size must be between 0 and the pulse mask size (in bits).
     if (window >= 0x00u && window < (sizeof(pulse_mask_t) * 8)) {
@@ -198,17 +1426,150 @@ void c2d_set_pulse_mapping(cortex2d_t* cortex, pulse_mapping_t pulse_mapping) {
 }
 
 void c2d_set_inhexc_range(cortex2d_t* cortex, chance_t inhexc_range) {
-    cortex->inhexc_range = inhexc_range;
+    // Ratios must fit the neurons' inhexc ratio type.
+    if (inhexc_range <= MAX_INHEXC_RANGE) {
+        cortex->inhexc_range = inhexc_range;
+    }
 }
 
 void c2d_set_inhexc_ratio(cortex2d_t* cortex, chance_t inhexc_ratio) {
     if (inhexc_ratio <= cortex->inhexc_range) {
         for (cortex_size_t y = 0; y < cortex->height; y++) {
             for (cortex_size_t x = 0; x < cortex->width; x++) {
-                cortex->neurons[IDX2D(x, y, cortex->width)].inhexc_ratio = inhexc_ratio;
+                cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)].inhexc_ratio = (inhexc_ratio_t) inhexc_ratio;
+            }
+        }
+    }
+}
+
+void ooc2d_set_band_rows(ooc2d_t* ooc, cortex_size_t band_rows) {
+    if (band_rows > 0) {
+        ooc->band_rows = band_rows;
+    }
+}
+
+void f2d_set_propagation(frozen2d_t* frozen, propagation_t propagation, float push_fraction) {
+    frozen->propagation = propagation;
+    frozen->push_fraction = push_fraction;
+}
+
+error_code_t c2d_set_wrapped(cortex2d_t* cortex, bool_t wrapped) {
+    // The ghost border only depends on the cortex size, so it's allocated once here, while ticks only refresh its content.
+    if (wrapped && cortex->ghosts == NULL) {
+        cortex_size_t nh_radius = cortex->nh_radius;
+        size_t ghosts_count = (size_t) (cortex->width + 2 * nh_radius) * 6 * nh_radius +
+                              (size_t) 6 * nh_radius * (cortex->height + 2 * nh_radius);
+        cortex->ghosts = (ghost_t*) malloc((ghosts_count > 0 ? ghosts_count : 1) * sizeof(ghost_t));
+        if (cortex->ghosts == NULL) {
+            return ERROR_FAILED_ALLOC;
+        }
+    } else if (!wrapped) {
+        free(cortex->ghosts);
+        cortex->ghosts = NULL;
+    }
+    cortex->wrapped = wrapped;
+
+    return ERROR_NONE;
+}
+
+void c2d_set_rand_mode(cortex2d_t* cortex, rand_mode_t rand_mode, rand_state_t seed) {
+    cortex->rand_mode = rand_mode;
+    cortex->rand_seed = seed;
+}
+
+error_code_t c2d_set_neurons_order(cortex2d_t* cortex, neurons_order_t neurons_order) {
+    if (neurons_order == cortex->neurons_order) {
+        return ERROR_NONE;
+    }
+    if (neurons_order == NEURONS_ORDER_TILED && (cortex->width % TILE_SIDE_2D != 0 || cortex->height % TILE_SIDE_2D != 0)) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    // Move neurons through a copy of the current ones.
+    size_t neurons_count = (size_t) cortex->width * (size_t) cortex->height;
+    neuron_t* neurons = (neuron_t*) malloc(neurons_count * sizeof(neuron_t));
+    wide_synapses_t* wide_synapses = cortex->wide_synapses != NULL ? (wide_synapses_t*) malloc(neurons_count * sizeof(wide_synapses_t)) : NULL;
+    if (neurons == NULL || (cortex->wide_synapses != NULL && wide_synapses == NULL)) {
+        free(neurons);
+        free(wide_synapses);
+        return ERROR_FAILED_ALLOC;
+    }
+    memcpy(neurons, cortex->neurons, neurons_count * sizeof(neuron_t));
+    if (wide_synapses != NULL) {
+        memcpy(wide_synapses, cortex->wide_synapses, neurons_count * sizeof(wide_synapses_t));
+    }
+
+    #pragma omp parallel for collapse(2)
+    for (cortex_size_t y = 0; y < cortex->height; y++) {
+        for (cortex_size_t x = 0; x < cortex->width; x++) {
+            cortex_index_t from = ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order);
+            cortex_index_t to = ORDER_IDX2D(x, y, cortex->width, neurons_order);
+            cortex->neurons[to] = neurons[from];
+            if (wide_synapses != NULL) {
+                cortex->wide_synapses[to] = wide_synapses[from];
             }
         }
     }
+    cortex->neurons_order = neurons_order;
+
+    free(neurons);
+    free(wide_synapses);
+
+    return ERROR_NONE;
+}
+
+void c3d_set_evol_step(cortex3d_t* cortex, evol_step_t evol_step) {
+    cortex->evol_step = evol_step;
+}
+
+void c3d_set_pulse_window(cortex3d_t* cortex, spikes_count_t window) {
+    // The given window size must be between 0 and the pulse mask size (in bits).
+    if (window >= 0 && (size_t) window < sizeof(pulse_mask_t) * 8) {
+        cortex->pulse_window = window;
+    }
+}
+
+void c3d_set_sample_window(cortex3d_t* cortex, ticks_count_t sample_window) {
+    cortex->sample_window = sample_window;
+}
+
+void c3d_set_fire_threshold(cortex3d_t* cortex, neuron_value_t threshold) {
+    cortex->fire_threshold = threshold;
+}
+
+void c3d_set_max_syn_count(cortex3d_t* cortex, syn_count_t syn_count) {
+    cortex->max_syn_count = syn_count;
+}
+
+void c3d_set_max_touch(cortex3d_t* cortex, float touch) {
+    // Only set touch if a valid value is provided.
+    if (touch <= 1 && touch >= 0) {
+        cortex->max_syn_count = touch * NH_COUNT_3D(NH_DIAM_3D(cortex->nh_radius));
+    }
+}
+
+void c3d_set_pulse_mapping(cortex3d_t* cortex, pulse_mapping_t pulse_mapping) {
+    cortex->pulse_mapping = pulse_mapping;
+}
+
+void c3d_set_inhexc_range(cortex3d_t* cortex, chance_t inhexc_range) {
+    // Ratios must fit the neurons' inhexc ratio type.
+    if (inhexc_range <= MAX_INHEXC_RANGE) {
+        cortex->inhexc_range = inhexc_range;
+    }
+}
+
+void c3d_set_inhexc_ratio(cortex3d_t* cortex, chance_t inhexc_ratio) {
+    if (inhexc_ratio <= cortex->inhexc_range) {
+        for (size_t i = 0; i < c3d_neurons_count(cortex); i++) {
+            cortex->neurons[i].inhexc_ratio = (inhexc_ratio_t) inhexc_ratio;
+        }
+    }
+}
+
+void c3d_set_rand_mode(cortex3d_t* cortex, rand_mode_t rand_mode, rand_state_t seed) {
+    cortex->rand_mode = rand_mode;
+    cortex->rand_seed = seed;
 }
 
 void c2d_syn_disable(cortex2d_t* cortex, cortex_size_t x0, cortex_size_t y0, cortex_size_t x1, cortex_size_t y1) {
@@ -216,8 +1577,38 @@ void c2d_syn_disable(cortex2d_t* cortex, cortex_size_t x0, cortex_size_t y0, cor
     if (x0 >= 0 && y0 >= 0 && x1 <= cortex->width && y1 <= cortex->height) {
         for (cortex_size_t y = y0; y < y1; y++) {
             for (cortex_size_t x = x0; x < x1; x++) {
-                cortex->neurons[IDX2D(x, y, cortex->width)].max_syn_count = 0x00U;
+                cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)].max_syn_count = 0x00U;
             }
         }
     }
-}
\ No newline at end of file
+}
+
+
+// ################################################## Getters ###################################################
+
+neuron_profile_t neuron_profile() {
+    return NEURON_PROFILE;
+}
+
+size_t neuron_size(neuron_profile_t profile) {
+    return profile == NEURON_PROFILE_COMPACT ? NEURON_SIZE_COMPACT : NEURON_SIZE_STANDARD;
+}
+
+size_t c2d_memory_usage(cortex2d_t* cortex) {
+    size_t neurons_count = (size_t) cortex->width * (size_t) cortex->height;
+    return sizeof(cortex2d_t) +
+           neurons_alloc_size(neurons_count) +
+           (cortex->wide_synapses != NULL ? neurons_count * sizeof(wide_synapses_t) : 0);
+}
+
+size_t c3d_memory_usage(cortex3d_t* cortex) {
+    return sizeof(cortex3d_t) + neurons_alloc_size(c3d_neurons_count(cortex));
+}
+
+neuron_t* c3d_neuron(cortex3d_t* cortex, cortex_size_t x, cortex_size_t y, cortex_size_t z) {
+    return &(cortex->neurons[BRICK_IDX3D(x, y, z, cortex->bricks_x, cortex->bricks_y)]);
+}
+
+neuron_t* c2d_neuron(cortex2d_t* cortex, cortex_size_t x, cortex_size_t y) {
+    return &(cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)]);
+}
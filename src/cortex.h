@@ -12,18 +12,25 @@ Copyright (C) 2021 Luka Micheletti
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "error.h"
+#include "transport.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Compact neurons profile: narrower neuron fields for memory bound targets (e.g. Raspberry Pi), at the cost of shorter pulse windows,
+// a smaller inhexc range and no cache line alignment.
+// Build with "make COMPACT=1" in order to enable it: the installed headers are updated accordingly.
+// #define BEHEMA_COMPACT
+
 // Translate an id wrapping it to the provided size (pacman effect).
 // WARNING: Only works with signed types and does not show errors otherwise.
 // [i] is the given index.
 // [n] is the size over which to wrap.
-#define WRAP(i, n) ((i) >= 0 ? ((i) % (n)) : ((n) + ((i) % (n))))
+#define WRAP(i, n) ((i) >= 0 ? ((i) % (n)) : (((n) + ((i) % (n))) % (n)))
 
 // Computes the diameter of a square neighborhood given its radius.
 #define NH_DIAM_2D(r) (2 * (r) + 1)
@@ -31,11 +38,54 @@ extern "C" {
 // Computes the number of neighbors in a square neighborhood given its diameter.
 #define NH_COUNT_2D(d) ((d) * (d) - 1)
 
+// Maximum number of nh_mask_t words in wide neighborhood masks: 4 words hold 256 positions, so the radius can be up to 7 (224 neighbors).
+#define NH_MASK_WORDS_MAX 0x04
+
+// Computes the number of nh_mask_t words needed by a square neighborhood given its diameter, central neuron included.
+#define NH_MASK_WORDS_2D(d) (((d) * (d) + 63) / 64)
+
+// Computes the diameter of a cubic neighborhood given its radius.
+#define NH_DIAM_3D(r) (2 * (r) + 1)
+
+// Computes the number of neighbors in a cubic neighborhood given its diameter.
+#define NH_COUNT_3D(d) ((d) * (d) * (d) - 1)
+
 // Translates bidimensional indexes to a monodimensional one.
 // |i| is the row index.
 // |j| is the column index.
 // |m| is the number of columns (length of the rows).
-#define IDX2D(i, j, m) (((m) * (j)) + (i))
+#define IDX2D(i, j, m) ((((cortex_index_t) (m)) * (j)) + (i))
+
+// Side of the square tiles 2D cortices store their neurons in when using NEURONS_ORDER_TILED.
+#define TILE_SIDE_2D 0x08
+// Number of neurons in a tile.
+#define TILE_SIZE_2D (TILE_SIDE_2D * TILE_SIDE_2D)
+
+// Spreads the 3 lowest bits of the given value to the even bits of the result (0b00000abc -> 0b000a0b0c).
+#define MORTON_SPREAD_3(v) (((v) & 0x01) | (((v) & 0x02) << 1) | (((v) & 0x04) << 2))
+// Compacts the 3 lowest even bits of the given value to its 3 lowest bits (0b00a0b0c -> 0b00000abc), inverse of MORTON_SPREAD_3.
+#define MORTON_COMPACT_3(v) (((v) & 0x01) | (((v) >> 1) & 0x02) | (((v) >> 2) & 0x04))
+
+// Translates bidimensional indexes to a monodimensional one in a tiled layout: tiles are stored one after the other in row-major order,
+// each holding its neurons contiguously in Morton (Z) order.
+// |i| is the row index.
+// |j| is the column index.
+// |m| is the number of columns (length of the rows), must be a multiple of TILE_SIDE_2D.
+#define TILED_IDX2D(i, j, m) (((((cortex_index_t) ((j) >> 3)) * ((m) >> 3) + ((i) >> 3)) << 6) | \
+                              (MORTON_SPREAD_3((i) & 0x07) | (MORTON_SPREAD_3((j) & 0x07) << 1)))
+
+// Translates bidimensional indexes to a monodimensional one according to the given neurons order.
+// |i| is the row index.
+// |j| is the column index.
+// |m| is the number of columns (length of the rows).
+// |o| is the neurons order.
+#define ORDER_IDX2D(i, j, m, o) ((o) == NEURONS_ORDER_TILED ? TILED_IDX2D(i, j, m) : IDX2D(i, j, m))
+
+// Translates a row-major monodimensional index to one according to the given neurons order.
+// |i| is the row-major index.
+// |m| is the number of columns (length of the rows).
+// |o| is the neurons order.
+#define ORDER_IDX1D(i, m, o) ((o) == NEURONS_ORDER_TILED ? TILED_IDX2D((i) % (m), (i) / (m), m) : (i))
 
 // Translates tridimensional indexes to a monodimensional one.
 // |i| is the index in the first dimension.
@@ -43,11 +93,50 @@ extern "C" {
 // |k| is the index in the third dimension.
 // |m| is the size of the first dimension.
 // |n| is the size of the second dimension.
-#define IDX3D(i, j, k, m, n) (((m) * (n) * (k)) + ((m) * (j)) + (i))
+#define IDX3D(i, j, k, m, n) ((((cortex_index_t) (m)) * (n) * (k)) + (((cortex_index_t) (m)) * (j)) + (i))
+
+// Side of the cubic bricks 3D cortices store their neurons in. A brick of standard neurons fills a whole page.
+#define BRICK_SIDE_3D 0x04
+// Number of neurons in a brick.
+#define BRICK_SIZE_3D (BRICK_SIDE_3D * BRICK_SIDE_3D * BRICK_SIDE_3D)
+
+// Translates tridimensional indexes to a monodimensional one in a bricked layout: bricks are stored one after the other,
+// each holding its neurons contiguously.
+// |i| is the index in the first dimension.
+// |j| is the index in the second dimension.
+// |k| is the index in the third dimension.
+// |bx| is the number of bricks in the first dimension.
+// |by| is the number of bricks in the second dimension.
+#define BRICK_IDX3D(i, j, k, bx, by) ((IDX3D((i) / BRICK_SIDE_3D, (j) / BRICK_SIDE_3D, (k) / BRICK_SIDE_3D, (bx), (by)) * BRICK_SIZE_3D) + \
+                                      IDX3D((i) % BRICK_SIDE_3D, (j) % BRICK_SIDE_3D, (k) % BRICK_SIDE_3D, BRICK_SIDE_3D, BRICK_SIDE_3D))
+
+// Maximum number of cortices in an ensemble.
+#define ENSEMBLE_MAX_LANES 0x40
+
+// Size of a cache line, in bytes.
+#define CACHE_LINE_SIZE 0x40
+
+// Size of a huge page, in bytes. Neuron arrays at least this big are backed by huge pages when available.
+#define HUGE_PAGE_SIZE 0x200000
+
+// Alignment of the neurons buffers in out-of-core cortex files, in bytes: a page.
+#define OOC_ALIGNMENT 0x1000
+
+// Default amount of neurons memory ticked at once by out-of-core cortices, in bytes.
+#define DEFAULT_OOC_BAND_SIZE 0x1000000
+
+// Size of a neuron in each profile, in bytes.
+#define NEURON_SIZE_STANDARD 0x40
+#define NEURON_SIZE_COMPACT 0x38
 
 #define EVOL_STEP_NEVER 0x0000FFFFU
 
+#ifdef BEHEMA_COMPACT
+// Compact pulse masks only hold 32 pulses.
+#define PULSE_WINDOW_LARGE 0x1FU
+#else
 #define PULSE_WINDOW_LARGE 0x3FU
+#endif
 #define PULSE_WINDOW_MID 0x1FU
 #define PULSE_WINDOW_SMALL 0x0AU
 
@@ -74,24 +163,38 @@ extern "C" {
 #define DEFAULT_SYNGEN_CHANCE 0x02A0U
 #define DEFAULT_SYNSTR_CHANCE 0x00A0U
 
+// Fraction of neurons over the fire threshold below which PROPAGATION_AUTO switches from pull to push.
+// Pushing merges arrivals atomically, which gets costlier with many threads hitting the same targets, so the default is conservative.
+#define DEFAULT_PUSH_FRACTION 0.25F
+
 typedef uint8_t byte;
 
 typedef int16_t neuron_value_t;
 
 // A mask made of 8 bytes can hold up to 48 neighbors (i.e. radius = 3).
-// Using 16 bytes the radius can be up to 5 (120 neighbors).
+// Bigger neighborhoods use wide masks, made of up to NH_MASK_WORDS_MAX masks.
 typedef uint64_t nh_mask_t;
 typedef int8_t nh_radius_t;
 typedef uint8_t syn_count_t;
 typedef uint8_t syn_strength_t;
 typedef uint16_t ticks_count_t;
 typedef uint32_t evol_step_t;
-typedef uint64_t pulse_mask_t;
 typedef int8_t spikes_count_t;
 typedef uint32_t chance_t;
 typedef uint32_t rand_state_t;
+#ifdef BEHEMA_COMPACT
+typedef uint32_t pulse_mask_t;
+typedef uint8_t inhexc_ratio_t;
+#define MAX_INHEXC_RANGE 0xFFU
+#else
+typedef uint64_t pulse_mask_t;
+typedef chance_t inhexc_ratio_t;
+#define MAX_INHEXC_RANGE 0xFFFFFFFFU
+#endif
 
 typedef int32_t cortex_size_t;
+// Linear index of a neuron: 64 bits wide, so that cortices can hold more than 2^31 neurons.
+typedef int64_t cortex_index_t;
 
 typedef enum bool_t {
     FALSE = 0,
@@ -120,53 +223,179 @@ typedef struct input2d_t {
     ticks_count_t* values;
 } input2d_t;
 
-// TODO output2d.
+typedef struct input3d_t {
+    cortex_size_t x0;
+    cortex_size_t y0;
+    cortex_size_t z0;
+    cortex_size_t x1;
+    cortex_size_t y1;
+    cortex_size_t z1;
+    neuron_value_t exc_value;
+    pulse_mapping_t pulse_mapping;
+    ticks_count_t* values;
+} input3d_t;
+
+typedef enum neurons_order_t {
+    // Row-major order: vertical neighbors are whole rows apart.
+    NEURONS_ORDER_ROWS = 0x00,
+    // Tiled order: neurons are stored in TILE_SIDE_2D x TILE_SIDE_2D tiles, each one in Morton order, see TILED_IDX2D.
+    // Most neighbors of a neuron then share its tile or a neighboring one, so ticks touch fewer cache lines and pages.
+    NEURONS_ORDER_TILED = 0x01
+} neurons_order_t;
+
+typedef enum rand_mode_t {
+    // Each neuron advances its own xorshift state once per neighbor: draws form a sequential chain.
+    RAND_MODE_XORSHIFT = 0x00,
+    // Draws are computed from (neuron, tick, neighbor) with a counter-based generator: they're random-access, so they can be generated
+    // in any order or all at once, and results don't depend on thread count or kernel variant.
+    RAND_MODE_COUNTER = 0x01
+} rand_mode_t;
+
+typedef enum evol_mode_t {
+    // The whole cortex evolves at once every evol_step + 1 ticks.
+    EVOL_MODE_FULL = 0x00,
+    // Every tick evolves one of evol_step + 1 groups of neurons, so that evolution cost is spread evenly across ticks.
+    // Each neuron still evolves once every evol_step + 1 ticks, so long-run plasticity rates are unchanged.
+    // Groups are rows: row y evolves when ticks_count % (evol_step + 1) == y % (evol_step + 1).
+    EVOL_MODE_STRIPES = 0x01,
+    // Groups are (generalized) checkerboard cells: (x + y) % (evol_step + 1).
+    EVOL_MODE_CHECKERBOARD = 0x02,
+    // Groups are picked by hashing the neuron index, avoiding any spatial pattern.
+    EVOL_MODE_HASHED = 0x03
+} evol_mode_t;
+
+typedef enum propagation_t {
+    // Each neuron reads all of its incoming edges (pull). Cost is proportional to the edges count.
+    PROPAGATION_PULL = 0x00,
+    // Each neuron over the fire threshold marks its outgoing edges (push). Cost is proportional to the edges of active neurons only.
+    PROPAGATION_PUSH = 0x01,
+    // Pull or push, depending on the fraction of neurons over the fire threshold at the previous tick.
+    PROPAGATION_AUTO = 0x02
+} propagation_t;
+
+typedef enum readout_t {
+    // Number of spikes fired by the neurons in the area.
+    READOUT_SPIKES = 0x00,
+    // Mean pulse (activations in the pulse window) of the neurons in the area.
+    READOUT_PULSE = 0x01,
+    // Mean internal value of the neurons in the area.
+    READOUT_VALUE = 0x02
+} readout_t;
+
+/// Summed-area table of a cortex' activity: each element holds the sum of all neurons above and to the left of it, so that
+/// the sum over any rectangle can be read with 4 lookups regardless of its size.
+/// Tables are (width + 1) x (height + 1), with a leading row and column of zeros.
+typedef struct sat2d_t {
+    cortex_size_t width;
+    cortex_size_t height;
+    // Fired neurons (0 or 1 each).
+    int64_t* spikes;
+    // Neurons pulse.
+    int64_t* pulse;
+    // Neurons value.
+    int64_t* value;
+} sat2d_t;
+
+/// Output readout area, split into a cols x rows grid of cells, each producing a single value.
+typedef struct output2d_t {
+    cortex_size_t x0;
+    cortex_size_t y0;
+    cortex_size_t x1;
+    cortex_size_t y1;
+    cortex_size_t cols;
+    cortex_size_t rows;
+    readout_t readout;
+    // Number of ticks accumulated before values are updated: 1 updates values at every tick.
+    ticks_count_t window;
+    // Ticks accumulated so far in the current window.
+    ticks_count_t samples_count;
+    // Per-cell sums accumulated over the current window.
+    int64_t* sums;
+    // Per-cell readouts: total spikes in the window for READOUT_SPIKES, mean over neurons and ticks otherwise.
+    float* values;
+} output2d_t;
+
+typedef enum neuron_profile_t {
+    NEURON_PROFILE_STANDARD = 0x00,
+    NEURON_PROFILE_COMPACT = 0x01
+} neuron_profile_t;
+
+#ifdef BEHEMA_COMPACT
+#define NEURON_PROFILE NEURON_PROFILE_COMPACT
+#define NEURON_ALIGNMENT
+#else
+#define NEURON_PROFILE NEURON_PROFILE_STANDARD
+#define NEURON_ALIGNMENT __attribute__((aligned(CACHE_LINE_SIZE)))
+#endif
 
 /// Neuron.
-typedef struct neuron_t {
-    // Neighborhood connections pattern (SYNapses ACtivation state):
-    // 1|1|0
-    // 0|x|1 => 1100x1100
-    // 1|0|0
-    nh_mask_t synac_mask;
-    // Neighborhood excitatory states pattern (SYNapses EXcitatory state), defines whether the synapses from the neighbors are excitatory (1) or inhibitory (0).
-    // Only values corresponding to active synapses are used.
-    nh_mask_t synex_mask;
-    // Neighborhood synapses strength pattern (SYNapses STRength). Defines a 3 bit value defined as [cba].
-    nh_mask_t synstr_mask_a;
-    nh_mask_t synstr_mask_b;
-    nh_mask_t synstr_mask_c;
-
-
-    // Random state. The random state has to be consistent inside a single neuron in order to allow for parallel edits without any race condition.
-    // The random state is used to generate consistent random numbers across the lifespan of a neuron, therefore should NEVER be manually changed.
-    rand_state_t rand_state;
-
-
+/// Fields are ordered so that the struct has no padding holes, with the ones read by neighbors at every tick first.
+/// Standard neurons fill exactly one cache line, while compact ones are packed as tight as possible.
+typedef struct NEURON_ALIGNMENT neuron_t {
     // Activation history pattern:
     //           |<--pulse_window-->|
     // xxxxxxxxxx01001010001010001001--------> t
     //                              ^
     // Used to know the pulse frequency in a given moment (e.g. for syngen).
     pulse_mask_t pulse_mask;
+    // Current internal value.
+    neuron_value_t value;
     // Amount of activations in the cortex' pulse window.
     spikes_count_t pulse;
 
 
-    // Current internal value.
-    neuron_value_t value;
     // Maximum number of synapses to the neuron. Cannot be greater than the cortex' max_syn_count.
     syn_count_t max_syn_count;
     // Amount of connected neighbors.
     syn_count_t syn_count;
     // Total amount of syn strength from input neurons.
     syn_strength_t tot_syn_strength;
+
+
     // Proportion between excitatory and inhibitory generated synapses. Can vary between 0 and cortex.inhexc_range.
     // inhexc_ratio = 0 -> all synapses are excitatory.
     // inhexc_ratio = cortex.inhexc_range -> all synapses are inhibitory.
-    chance_t inhexc_ratio;
+    inhexc_ratio_t inhexc_ratio;
+    // Random state. The random state has to be consistent inside a single neuron in order to allow for parallel edits without any race condition.
+    // The random state is used to generate consistent random numbers across the lifespan of a neuron, therefore should NEVER be manually changed.
+    rand_state_t rand_state;
+
+
+    // Neighborhood connections pattern (SYNapses ACtivation state):
+    // 1|1|0
+    // 0|x|1 => 1100x1100
+    // 1|0|0
+    nh_mask_t synac_mask;
+    // Neighborhood excitatory states pattern (SYNapses EXcitatory state), defines whether the synapses from the neighbors are excitatory (1) or inhibitory (0).
+    // Only values corresponding to active synapses are used.
+    nh_mask_t synex_mask;
+    // Neighborhood synapses strength pattern (SYNapses STRength). Defines a 3 bit value defined as [cba].
+    nh_mask_t synstr_mask_a;
+    nh_mask_t synstr_mask_b;
+    nh_mask_t synstr_mask_c;
 } neuron_t;
 
+/// Wide neighborhood mask, for neighborhoods that don't fit a single nh_mask_t: position k is bit k % 64 of words[k / 64].
+/// Words are always NH_MASK_WORDS_MAX, so that operations on whole masks map to a fixed number of (vector) instructions.
+typedef struct wide_mask_t {
+    nh_mask_t words[NH_MASK_WORDS_MAX];
+} wide_mask_t;
+
+/// Synapses of a neuron in a wide cortex, with the same meaning as the neuron's own masks.
+typedef struct wide_synapses_t {
+    wide_mask_t synac_mask;
+    wide_mask_t synex_mask;
+    wide_mask_t synstr_mask_a;
+    wide_mask_t synstr_mask_b;
+    wide_mask_t synstr_mask_c;
+} wide_synapses_t;
+
+/// Neighbor state read by ticks: the only neuron fields needed by a neuron from its neighbors.
+typedef struct ghost_t {
+    neuron_value_t value;
+    spikes_count_t pulse;
+} ghost_t;
+
 /// 2D cortex of neurons.
 typedef struct cortex2d_t {
     // Width of the cortex.
@@ -179,6 +408,8 @@ typedef struct cortex2d_t {
     ticks_count_t evols_count;
     // Amount of ticks between each evolution.
     ticks_count_t evol_step;
+    // How evolution is scheduled across ticks.
+    evol_mode_t evol_mode;
     // Length of the window used to count pulses in the cortex' neurons.
     // TODO Switch "beat" and "pulse".
     spikes_count_t pulse_window;
@@ -186,6 +417,8 @@ typedef struct cortex2d_t {
 
     // Radius of each neuron's neighborhood.
     nh_radius_t nh_radius;
+    // Whether neighborhoods wrap around the cortex edges (toroidal topology), rather than being cut by them.
+    bool_t wrapped;
     neuron_value_t fire_threshold;
     neuron_value_t recovery_value;
     neuron_value_t exc_value;
@@ -210,41 +443,445 @@ typedef struct cortex2d_t {
     ticks_count_t sample_window;
     pulse_mapping_t pulse_mapping;
 
+    // Random numbers generation strategy used for plasticity.
+    rand_mode_t rand_mode;
+    // Seed of the counter-based random numbers generator, only used with RAND_MODE_COUNTER.
+    rand_state_t rand_seed;
+    // Ticks performed since cortex creation, keying the counter-based random numbers: unlike ticks_count it never wraps around, so draws
+    // don't repeat over long runs.
+    uint64_t rand_ticks_count;
+
+    // Order of the neurons (and wide synapses) in memory. All functions take coordinates, so it's only visible to code indexing neurons directly,
+    // which should use ORDER_IDX2D.
+    neurons_order_t neurons_order;
     neuron_t* neurons;
+    // Synapses of each neuron, only for wide cortices: the ones whose neighborhood doesn't fit a single nh_mask_t (radius 4 to 7).
+    // NULL for all other cortices. Neurons' own masks are unused when present.
+    wide_synapses_t* wide_synapses;
+    // Ghost border of wrapped cortices, holding copies of the neurons around their edges: allocated by c2d_set_wrapped and refreshed by every tick.
+    // It holds (width + 2 * nh_radius) * 6 * nh_radius ghosts for the first and last rows, followed by 6 * nh_radius * (height + 2 * nh_radius)
+    // ghosts for the first and last columns. NULL for bounded cortices. Shared by both views of a pair.
+    ghost_t* ghosts;
 } cortex2d_t;
 
-// TODO cortex3d_t
+/// Pair of 2D cortices owning their double buffering: both neurons buffers live in a single cache line aligned arena,
+/// while the views' roles are swapped in constant time after every tick.
+/// The current view holds the cortex state and properties, which are shared with the next view before every tick.
+typedef struct c2d_pair_t {
+    // Cortex views: views[current] holds the current state, the other one is written by ticks.
+    cortex2d_t views[2];
+    // Index of the current view.
+    byte current;
+    // Neurons arena, holding both views' neurons.
+    neuron_t* arena;
+    // Wide synapses arena, holding both views' wide synapses. NULL unless the views are wide cortices.
+    wide_synapses_t* wide_arena;
+} c2d_pair_t;
+
+/// Out-of-core 2D cortex: a cortex pair whose neurons buffers live in a memory-mapped file rather than in memory, so that it can be bigger than memory.
+/// Ticks are performed one band of rows at a time: only the band being ticked and its neighbors' rows need to be resident,
+/// while the next band is read ahead and finished ones are written back and dropped.
+typedef struct ooc2d_t {
+    // Views over the mapped neurons buffers, with the same semantics as a regular pair's. The arena points into the mapping.
+    c2d_pair_t pair;
+    // Rows ticked at once.
+    cortex_size_t band_rows;
+
+    // Backing file descriptor.
+    int file;
+    // Whole file mapping: a header followed by the two neurons buffers, each aligned to OOC_ALIGNMENT.
+    byte* mapping;
+    size_t mapping_size;
+} ooc2d_t;
+
+// Size of a neuron in halos exchanged between subdomains: only its value and pulse are read by neighbors.
+#define DOM_HALO_NEURON_SIZE (sizeof(neuron_value_t) + sizeof(spikes_count_t))
+
+/// 2D cortex decomposed into a grid of rectangular subdomains, each owned by a separate rank (e.g. a process), so that it can span multiple machines' cores and memory.
+/// Every rank holds a cortex pair for its own subdomain, surrounded by nh_radius wide halos of its neighbors' neurons, which are exchanged through a transport at every tick.
+/// Whatever the number of ranks, ticks give the same result as a single cortex of the whole size.
+typedef struct dom2d_t {
+    // Local cortex: the owned subdomain surrounded by its halos. Its current view holds the subdomain state and the whole cortex' properties.
+    c2d_pair_t* pair;
+    halo_transport_t transport;
+
+    // Size of the whole cortex.
+    cortex_size_t width;
+    cortex_size_t height;
+    // Whether the whole cortex is wrapped: subdomains on its edges are then neighbors of the ones on the opposite edges.
+    bool_t wrapped;
+
+    // Grid of subdomains, each one identified by its rank in row-major order.
+    uint32_t ranks_x;
+    uint32_t ranks_y;
+    uint32_t rank;
+
+    // Owned subdomain bounds, in whole cortex coordinates.
+    cortex_size_t x0;
+    cortex_size_t y0;
+    cortex_size_t x1;
+    cortex_size_t y1;
+
+    // Halos width on each side of the subdomain: nh_radius towards neighboring subdomains, 0 on the edges of a bounded cortex.
+    cortex_size_t halo_left;
+    cortex_size_t halo_top;
+    cortex_size_t halo_right;
+    cortex_size_t halo_bottom;
+
+    // Buffer for a single halo message, big enough for the biggest one.
+    byte* halo_buffer;
+} dom2d_t;
+
+/// Frozen 2D cortex: a cortex whose connectome is compiled into a compact incoming-edges list, for inference only.
+/// Edges of the neuron at index i are the ones from edges_offsets[i] to edges_offsets[i + 1], in neighborhood order.
+/// Only the neurons state is kept, as one array per field, so memory is proportional to the existing synapses.
+typedef struct frozen2d_t {
+    cortex_size_t width;
+    cortex_size_t height;
+    ticks_count_t ticks_count;
+    spikes_count_t pulse_window;
+    neuron_value_t fire_threshold;
+    neuron_value_t recovery_value;
+    neuron_value_t decay_value;
+    ticks_count_t sample_window;
+    pulse_mapping_t pulse_mapping;
+
+    // Amount of edges (active synapses).
+    size_t edges_count;
+    // Index of the first edge of each neuron, plus a trailing one holding edges_count.
+    size_t* edges_offsets;
+    // Index of the source neuron of each edge.
+    cortex_size_t* edges_sources;
+    // Signed weight of each edge: +-exc_value * (strength / 4 + 1).
+    neuron_value_t* edges_weights;
+
+    // Reverse index of edges: outgoing edges of the neuron at index i are the ones from out_offsets[i] to out_offsets[i + 1].
+    size_t* out_offsets;
+    // Index of the target neuron of each outgoing edge.
+    cortex_size_t* out_targets;
+    // Position of each outgoing edge among its target's incoming edges. Neurons have at most 48 incoming edges.
+    uint8_t* out_slots;
+    // Per-neuron mask of the incoming edges pushed by their source during the current tick.
+    nh_mask_t* arrivals;
+
+    propagation_t propagation;
+    // Fraction of neurons over the fire threshold below which PROPAGATION_AUTO pushes.
+    float push_fraction;
+    // Neurons over the fire threshold after the last tick.
+    size_t active_count;
+
+    // Current internal values.
+    neuron_value_t* values;
+    // Internal values being computed by the current tick, swapped with values at the end of it.
+    neuron_value_t* next_values;
+    pulse_mask_t* pulse_masks;
+    spikes_count_t* pulses;
+
+    // Random generation mode and neurons random states at the time of freezing. Ticks don't draw random numbers, so sequential
+    // random states are only brought up to date by f2d_to_cortex.
+    rand_mode_t rand_mode;
+    rand_state_t* rand_states;
+    // Ticks performed since cortex creation, restored to the cortex by f2d_to_cortex along with ticks_count.
+    uint64_t rand_ticks_count;
+    // Number of ticks performed since freezing.
+    uint64_t frozen_ticks_count;
+} frozen2d_t;
+
+/// Neurons state of an ensemble, one array per neuron field. Arrays are lane-interleaved: the lanes of each neuron are next to each other,
+/// so the value of neuron i in lane b is at index i * lanes_count + b, and loops over lanes are contiguous and vectorizable.
+typedef struct ensemble_neurons_t {
+    nh_mask_t* synac_masks;
+    nh_mask_t* synex_masks;
+    nh_mask_t* synstr_masks_a;
+    nh_mask_t* synstr_masks_b;
+    nh_mask_t* synstr_masks_c;
+    rand_state_t* rand_states;
+    pulse_mask_t* pulse_masks;
+    spikes_count_t* pulses;
+    neuron_value_t* values;
+    syn_count_t* max_syn_counts;
+    syn_count_t* syn_counts;
+    syn_strength_t* tot_syn_strengths;
+    inhexc_ratio_t* inhexc_ratios;
+} ensemble_neurons_t;
+
+/// Ensemble of 2D cortices with the same size and neighborhood radius, each in its own lane, all advanced by a single tick.
+/// Each lane behaves exactly like the cortex it was built from, with its own properties and random numbers.
+typedef struct ensemble2d_t {
+    cortex_size_t width;
+    cortex_size_t height;
+    nh_radius_t nh_radius;
+    cortex_size_t lanes_count;
+
+    // Properties of each lane, as cortices with no neurons.
+    cortex2d_t* lanes;
+
+    // Per-lane copies of the properties used by vectorized loops.
+    neuron_value_t* fire_thresholds;
+    neuron_value_t* recovery_values;
+    neuron_value_t* exc_values;
+    neuron_value_t* decay_values;
+    spikes_count_t* pulse_windows;
+
+    // Neurons state. Only values and pulses are ever read from neighbors, so all other fields are updated in place.
+    ensemble_neurons_t neurons;
+    // Values and pulses being computed by the current tick, swapped with the neurons' ones at the end of it.
+    neuron_value_t* next_values;
+    spikes_count_t* next_pulses;
+
+    // Per-neuron masks of the lanes in which the neuron is over its fire threshold (fired) or has a pulse (active), rebuilt by each tick.
+    // Lanes are limited to ENSEMBLE_MAX_LANES so that they fit a single word.
+    uint64_t* fired_lanes;
+    uint64_t* active_lanes;
+} ensemble2d_t;
+
+/// 3D cortex of neurons, e.g. for layered models.
+/// Neurons are stored in bricks of BRICK_SIZE_3D neurons, so that whole neighborhoods sit in a few bricks: use BRICK_IDX3D to locate them.
+/// Bricks on the far faces are padded when sizes are not multiples of BRICK_SIDE_3D, padding neurons are never ticked.
+/// Neighborhood masks hold up to 64 positions, so the neighborhood radius can only be 1 (26 neighbors).
+typedef struct cortex3d_t {
+    // Width of the cortex.
+    cortex_size_t width;
+    // Height of the cortex.
+    cortex_size_t height;
+    // Depth of the cortex.
+    cortex_size_t depth;
+    // Ticks performed since cortex creation.
+    ticks_count_t ticks_count;
+    // Evolutions performed since cortex creation.
+    ticks_count_t evols_count;
+    // Amount of ticks between each evolution.
+    ticks_count_t evol_step;
+    // Length of the window used to count pulses in the cortex' neurons.
+    spikes_count_t pulse_window;
+
+
+    // Radius of each neuron's neighborhood.
+    nh_radius_t nh_radius;
+    neuron_value_t fire_threshold;
+    neuron_value_t recovery_value;
+    neuron_value_t exc_value;
+    neuron_value_t decay_value;
+
+
+    // Chance (out of 0xFFFFU) of synapse generation or deletion (structural plasticity).
+    chance_t syngen_chance;
+    // Chance (out of 0xFFFFU) of synapse strengthening or weakening (functional plasticity).
+    chance_t synstr_chance;
+
+
+    // Max strength available for a single neuron, meaning the strength of all the synapses coming to each neuron cannot be more than this.
+    syn_strength_t max_tot_strength;
+    // Maximum number of synapses between a neuron and its neighbors.
+    syn_count_t max_syn_count;
+    // Maximum range for inhexc chance: single neurons' inhexc ratio will vary between 0 and inhexc_range. 0 means all excitatory, inhexc_range means all inhibitory.
+    chance_t inhexc_range;
+
+
+    // Length of the window used to sample inputs.
+    ticks_count_t sample_window;
+    pulse_mapping_t pulse_mapping;
+
+    // Random numbers generation strategy used for plasticity.
+    rand_mode_t rand_mode;
+    // Seed of the counter-based random numbers generator, only used with RAND_MODE_COUNTER.
+    rand_state_t rand_seed;
+    // Ticks performed since cortex creation, keying the counter-based random numbers: unlike ticks_count it never wraps around, so draws
+    // don't repeat over long runs.
+    uint64_t rand_ticks_count;
+
+    // Number of bricks along each axis.
+    cortex_size_t bricks_x;
+    cortex_size_t bricks_y;
+    cortex_size_t bricks_z;
+
+    neuron_t* neurons;
+} cortex3d_t;
 
 
 // ########################################## Initialization functions ##########################################
 
+/// Allocates a cache line aligned array of neurons, backed by huge pages if big enough: explicit ones if reserved by the system, transparent ones otherwise.
+/// Arrays allocated this way must be freed with neurons_free.
+error_code_t neurons_alloc(neuron_t** neurons, size_t count);
+
 /// Initializes the given input with the given values.
 error_code_t i2d_init(input2d_t** input, cortex_size_t x0, cortex_size_t y0, cortex_size_t x1, cortex_size_t y1, neuron_value_t exc_value, pulse_mapping_t pulse_mapping);
 
+/// Initializes the given input with the given values.
+error_code_t i3d_init(input3d_t** input, cortex_size_t x0, cortex_size_t y0, cortex_size_t z0, cortex_size_t x1, cortex_size_t y1, cortex_size_t z1, neuron_value_t exc_value, pulse_mapping_t pulse_mapping);
+
 /// Initializes the given cortex with default values.
+/// Radii up to 3 fit the neurons' own masks, while radii from 4 to 7 make for a wide cortex, holding its synapses in wide masks.
+/// Wide cortices can't be frozen, run out-of-core or in ensembles.
 error_code_t c2d_init(cortex2d_t** cortex, cortex_size_t width, cortex_size_t height, nh_radius_t nh_radius);
 
+/// Initializes the given 3D cortex with default values.
+/// @param cortex The cortex to initialize.
+/// @param width The width of the cortex.
+/// @param height The height of the cortex.
+/// @param depth The depth of the cortex.
+/// @param nh_radius The neighborhood radius of the cortex, either 0 or 1.
+error_code_t c3d_init(cortex3d_t** cortex, cortex_size_t width, cortex_size_t height, cortex_size_t depth, nh_radius_t nh_radius);
+
+/// Initializes the given cortex pair with default values, with no need for copies between its views.
+error_code_t c2d_pair_init(c2d_pair_t** pair, cortex_size_t width, cortex_size_t height, nh_radius_t nh_radius);
+
+/// Initializes the given out-of-core cortex with default values, backed by a newly created file.
+/// @param ooc The out-of-core cortex to initialize.
+/// @param width The width of the cortex.
+/// @param height The height of the cortex.
+/// @param nh_radius The neighborhood radius of the cortex.
+/// @param file_name The backing file, created if not already present, overwritten otherwise. Should be on fast storage (e.g. NVMe).
+error_code_t ooc2d_init(ooc2d_t** ooc, cortex_size_t width, cortex_size_t height, nh_radius_t nh_radius, char* file_name);
+
+/// Opens an out-of-core cortex from the given file, previously created by ooc2d_init, with its properties and neurons state.
+error_code_t ooc2d_open(ooc2d_t** ooc, char* file_name);
+
+/// Initializes the subdomain owned by the given rank in a decomposed cortex, with default values.
+/// Every rank must initialize its own subdomain with the same parameters, then set the same properties on its current view.
+/// @param dom The subdomain to initialize.
+/// @param width The width of the whole cortex.
+/// @param height The height of the whole cortex.
+/// @param nh_radius The neighborhood radius of the cortex.
+/// @param wrapped Whether the whole cortex is wrapped, see c2d_set_wrapped.
+/// @param ranks_x The number of subdomains along the x axis.
+/// @param ranks_y The number of subdomains along the y axis.
+/// @param rank The rank owning the subdomain, in range 0..(ranks_x * ranks_y - 1). Subdomains are ranked in row-major order.
+/// @param transport The transport to exchange halos through, connecting all ranks. Owned by the subdomain once initialized.
+/// @return ERROR_SIZE_MISMATCH if subdomains are narrower than nh_radius, or if a tick's halos don't fit the transport's channels.
+error_code_t dom2d_init(dom2d_t** dom,
+                        cortex_size_t width,
+                        cortex_size_t height,
+                        nh_radius_t nh_radius,
+                        bool_t wrapped,
+                        uint32_t ranks_x,
+                        uint32_t ranks_y,
+                        uint32_t rank,
+                        halo_transport_t transport);
+
+/// Initializes the given output with the given values.
+/// @param output The output to initialize.
+/// @param x0 The left bound of the output area.
+/// @param y0 The top bound of the output area.
+/// @param x1 The right bound (excluded) of the output area.
+/// @param y1 The bottom bound (excluded) of the output area.
+/// @param cols The number of readout cells along the x axis.
+/// @param rows The number of readout cells along the y axis.
+/// @param readout The quantity to read out.
+/// @param window The number of ticks to accumulate before updating values.
+error_code_t o2d_init(output2d_t** output, cortex_size_t x0, cortex_size_t y0, cortex_size_t x1, cortex_size_t y1, cortex_size_t cols, cortex_size_t rows, readout_t readout, ticks_count_t window);
+
+/// Initializes a summed-area table for cortices of the given size.
+error_code_t sat2d_init(sat2d_t** sat, cortex_size_t width, cortex_size_t height);
+
+/// Compiles the given cortex into a frozen cortex, with the same synapses, properties and neurons state.
+/// The frozen cortex never evolves, regardless of the cortex' evol_step.
+/// @param frozen The frozen cortex to initialize.
+/// @param cortex The cortex to compile.
+/// @return ERROR_NH_RADIUS_TOO_BIG for cortices with wide synapses, ERROR_SIZE_MISMATCH for cortices of more than 2^31 - 1 neurons.
+error_code_t c2d_freeze(frozen2d_t** frozen, cortex2d_t* cortex);
+
+/// Copies the neurons state of the given frozen cortex back to the cortex it was compiled from, e.g. to read outputs from it.
+/// Sequential random states are advanced by as many draws as the cortex would have made since freezing, so that it can go on evolving
+/// just as if it had been ticked by c2d_tick all along.
+/// @param frozen The frozen cortex to copy from.
+/// @param cortex The cortex to copy to, must have the same size.
+error_code_t f2d_to_cortex(frozen2d_t* frozen, cortex2d_t* cortex);
+
+/// Initializes an ensemble from the given cortices, copying their properties and neurons state.
+/// @param ensemble The ensemble to initialize.
+/// @param cortices The cortices to copy, one per lane. They must all have the same size and neighborhood radius, and can't be wrapped.
+/// @param lanes_count The number of cortices, up to ENSEMBLE_MAX_LANES.
+error_code_t e2d_init(ensemble2d_t** ensemble, cortex2d_t** cortices, cortex_size_t lanes_count);
+
+/// Copies the properties and neurons state of one of the ensemble's lanes to the given cortex.
+/// @param ensemble The ensemble to copy from.
+/// @param lane The lane to copy.
+/// @param cortex The cortex to copy to, must have the same size.
+error_code_t e2d_to_cortex(ensemble2d_t* ensemble, cortex_size_t lane, cortex2d_t* cortex);
+
+/// Frees the given neurons array, allocated by neurons_alloc with the same count.
+void neurons_free(neuron_t* neurons, size_t count);
+
 /// Destroys the given input2d and frees memory.
 error_code_t i2d_destroy(input2d_t* input);
 
+/// Destroys the given input3d and frees memory.
+error_code_t i3d_destroy(input3d_t* input);
+
+/// Destroys the given output2d and frees memory.
+error_code_t o2d_destroy(output2d_t* output);
+
+/// Destroys the given summed-area table and frees memory.
+error_code_t sat2d_destroy(sat2d_t* sat);
+
 /// Destroys the given cortex2d and frees memory.
 error_code_t c2d_destroy(cortex2d_t* cortex);
 
+/// Destroys the given cortex3d and frees memory.
+error_code_t c3d_destroy(cortex3d_t* cortex);
+
+/// Destroys the given cortex pair and frees memory.
+error_code_t c2d_pair_destroy(c2d_pair_t* pair);
+
+/// Writes the given out-of-core cortex back to its file, then destroys it and frees memory. The file is left in place, to be reopened by ooc2d_open.
+error_code_t ooc2d_destroy(ooc2d_t* ooc);
+
+/// Destroys the given subdomain, along with its transport, and frees memory.
+error_code_t dom2d_destroy(dom2d_t* dom);
+
+/// Destroys the given frozen2d and frees memory.
+error_code_t f2d_destroy(frozen2d_t* frozen);
+
+/// Destroys the given ensemble2d and frees memory.
+error_code_t e2d_destroy(ensemble2d_t* ensemble);
+
 /// Returns a cortex with the same properties as the given one.
 error_code_t c2d_copy(cortex2d_t* to, cortex2d_t* from);
 
+/// Returns a 3D cortex with the same properties as the given one.
+error_code_t c3d_copy(cortex3d_t* to, cortex3d_t* from);
+
+/// Returns the current view of the given pair, holding the latest cortex state. Setters, feeds and reads should target this view.
+cortex2d_t* c2d_pair_current(c2d_pair_t* pair);
+
+/// Returns the next view of the given pair, to be written by the next tick, after sharing the current view's properties with it.
+cortex2d_t* c2d_pair_next(c2d_pair_t* pair);
+
+/// Swaps the given pair's views, making the next view the current one.
+void c2d_pair_swap(c2d_pair_t* pair);
+
+/// Returns the current view of the given out-of-core cortex. Setters, feeds and reads should target this view.
+cortex2d_t* ooc2d_current(ooc2d_t* ooc);
+
+/// Writes the properties and neurons state of the given out-of-core cortex to its file, blocking until done.
+error_code_t ooc2d_sync(ooc2d_t* ooc);
+
+/// Returns the current view of the given subdomain's local cortex, halos included. Setters should target this view, while neurons should be
+/// accessed through dom2d_neuron, since the view's coordinates are local.
+cortex2d_t* dom2d_current(dom2d_t* dom);
+
+/// Returns the neuron at the given whole cortex coordinates, or NULL if it's not owned by the given subdomain.
+neuron_t* dom2d_neuron(dom2d_t* dom, cortex_size_t x, cortex_size_t y);
+
 
 // ########################################## Setter functions ##################################################
 
 /// Sets the neighborhood radius for all neurons in the cortex.
+/// The radius can't make the cortex switch between narrow and wide masks.
 error_code_t c2d_set_nhradius(cortex2d_t* cortex, nh_radius_t radius);
 
 /// Sets the neighborhood mask for all neurons in the cortex.
+/// Wide cortices get the mask as the first word of their masks, with all other positions cleared.
 void c2d_set_nhmask(cortex2d_t* cortex, nh_mask_t mask);
 
 /// Sets the evolution step for the cortex.
 void c2d_set_evol_step(cortex2d_t* cortex, evol_step_t evol_step);
 
+/// Sets how evolution is scheduled across ticks for the cortex.
+void c2d_set_evol_mode(cortex2d_t* cortex, evol_mode_t evol_mode);
+
 /// Sets the pulse window width for the cortex.
 void c2d_set_pulse_window(cortex2d_t* cortex, spikes_count_t window);
 
@@ -268,17 +905,98 @@ void c2d_set_max_touch(cortex2d_t* cortex, float touch);
 void c2d_set_pulse_mapping(cortex2d_t* cortex, pulse_mapping_t pulse_mapping);
 
 /// Sets the range for excitatory to inhibitory ratios in single neurons.
+/// Only values up to MAX_INHEXC_RANGE are allowed.
 void c2d_set_inhexc_range(cortex2d_t* cortex, chance_t inhexc_range);
 
 /// Sets the proportion between excitatory and inhibitory generated synapses.
+/// Only values up to the cortex' inhexc range are allowed.
 void c2d_set_inhexc_ratio(cortex2d_t* cortex, chance_t inhexc_ratio);
 
-/// Sets whether the tick pass should wrap around the edges (pacman effect).
-void c2d_set_wrapped(cortex2d_t* cortex, bool_t wrapped);
+/// Sets the random numbers generation strategy used for plasticity.
+/// @param cortex The cortex to edit.
+/// @param rand_mode The strategy to use.
+/// @param seed The seed of the counter-based generator, ignored by RAND_MODE_XORSHIFT.
+void c2d_set_rand_mode(cortex2d_t* cortex, rand_mode_t rand_mode, rand_state_t seed);
+
+/// Sets the order of the cortex' neurons in memory, moving them accordingly. Neurons keep their coordinates,
+/// so results are the same whatever the order, while ticks touch less memory with NEURONS_ORDER_TILED.
+/// @param cortex The cortex to edit.
+/// @param neurons_order The order to use. NEURONS_ORDER_TILED requires both width and height to be multiples of TILE_SIDE_2D.
+/// @return ERROR_SIZE_MISMATCH if the cortex size doesn't allow the given order, ERROR_FAILED_ALLOC if neurons can't be moved.
+error_code_t c2d_set_neurons_order(cortex2d_t* cortex, neurons_order_t neurons_order);
+
+/// Sets the evolution step for the 3D cortex.
+void c3d_set_evol_step(cortex3d_t* cortex, evol_step_t evol_step);
+
+/// Sets the pulse window width for the 3D cortex.
+void c3d_set_pulse_window(cortex3d_t* cortex, spikes_count_t window);
+
+/// Sets the sample window for the 3D cortex.
+void c3d_set_sample_window(cortex3d_t* cortex, ticks_count_t sample_window);
+
+/// Sets the fire threshold for all neurons in the 3D cortex.
+void c3d_set_fire_threshold(cortex3d_t* cortex, neuron_value_t threshold);
+
+/// Sets the maximum number of (input) synapses for the neurons of the 3D cortex.
+void c3d_set_max_syn_count(cortex3d_t* cortex, syn_count_t syn_count);
+
+/// Sets the maximum allowable touch for each neuron in the 3D cortex. Only values between 0 and 1 are allowed.
+void c3d_set_max_touch(cortex3d_t* cortex, float touch);
+
+/// Sets the preferred input mapping for the given 3D cortex.
+void c3d_set_pulse_mapping(cortex3d_t* cortex, pulse_mapping_t pulse_mapping);
+
+/// Sets the range for excitatory to inhibitory ratios in single neurons of the 3D cortex.
+/// Only values up to MAX_INHEXC_RANGE are allowed.
+void c3d_set_inhexc_range(cortex3d_t* cortex, chance_t inhexc_range);
+
+/// Sets the proportion between excitatory and inhibitory generated synapses in the 3D cortex.
+/// Only values up to the cortex' inhexc range are allowed.
+void c3d_set_inhexc_ratio(cortex3d_t* cortex, chance_t inhexc_ratio);
+
+/// Sets the random numbers generation strategy used for plasticity in the 3D cortex, see c2d_set_rand_mode.
+void c3d_set_rand_mode(cortex3d_t* cortex, rand_mode_t rand_mode, rand_state_t seed);
+
+/// Sets the number of rows ticked at once by the given out-of-core cortex. Bigger bands amortize the read-ahead, but need more memory.
+void ooc2d_set_band_rows(ooc2d_t* ooc, cortex_size_t band_rows);
+
+/// Sets the propagation strategy used by the given frozen cortex. Results are the same with all strategies.
+/// @param frozen The frozen cortex to edit.
+/// @param propagation The strategy to use.
+/// @param push_fraction The fraction of neurons over the fire threshold below which PROPAGATION_AUTO pushes, ignored by other strategies.
+void f2d_set_propagation(frozen2d_t* frozen, propagation_t propagation, float push_fraction);
+
+/// Sets whether the tick pass should wrap around the edges (pacman effect): neurons on an edge are then neighbors of the ones on the opposite edge.
+/// Wrapped cortices can't run in ensembles.
+/// @param cortex The cortex to edit, or the current view of a pair.
+/// @param wrapped Whether the cortex should be wrapped.
+/// @return ERROR_FAILED_ALLOC if the ghost border read by ticks of wrapped cortices can't be allocated, in which case the cortex is left untouched.
+error_code_t c2d_set_wrapped(cortex2d_t* cortex, bool_t wrapped);
 
 /// Disables self connections whithin the specified bounds.
 void c2d_syn_disable(cortex2d_t* cortex, cortex_size_t x0, cortex_size_t y0, cortex_size_t x1, cortex_size_t y1);
 
+
+// ########################################## Getter functions ##################################################
+
+/// Returns the neurons profile the library was built with.
+neuron_profile_t neuron_profile();
+
+/// Returns the size of a single neuron in the given profile, in bytes.
+size_t neuron_size(neuron_profile_t profile);
+
+/// Returns the memory used by the given cortex, neurons included, in bytes.
+size_t c2d_memory_usage(cortex2d_t* cortex);
+
+/// Returns the memory used by the given 3D cortex, neurons and bricks padding included, in bytes.
+size_t c3d_memory_usage(cortex3d_t* cortex);
+
+/// Returns the neuron at (x, y, z) in the given 3D cortex.
+neuron_t* c3d_neuron(cortex3d_t* cortex, cortex_size_t x, cortex_size_t y, cortex_size_t z);
+
+/// Returns the neuron at the given coordinates of the cortex, whatever its neurons order.
+neuron_t* c2d_neuron(cortex2d_t* cortex, cortex_size_t x, cortex_size_t y);
+
 #ifdef __cplusplus
 }
 #endif
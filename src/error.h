@@ -7,7 +7,12 @@ typedef enum error_code_t {
     ERROR_FILE_DOES_NOT_EXIST = 2,
     ERROR_FILE_SIZE_WRONG = 3,
     ERROR_FAILED_ALLOC = 4,
-    ERROR_CORTEX_UNALLOC = 5
+    ERROR_CORTEX_UNALLOC = 5,
+    ERROR_FILE_WRONG_FORMAT = 6,
+    ERROR_SIZE_MISMATCH = 7,
+    ERROR_FILE_WRITE_FAILED = 8,
+    ERROR_TRANSPORT_FAILED = 9,
+    ERROR_NOT_READY = 10
 } error_code_t;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,289 @@
+// Must come before any include in order to bring in POSIX functions such as clock_gettime() under -std=c17.
+#define _DEFAULT_SOURCE
+
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROF_HAS_TSC
+#endif
+
+static const char* prof_phase_names[PROF_PHASES_COUNT] = {
+    "feed",
+    "integrate",
+    "evolve",
+    "checkpoint",
+    "input_wait"
+};
+
+typedef struct prof_span_t {
+    uint64_t start;
+    uint64_t end;
+    prof_phase_t phase;
+} prof_span_t;
+
+// Profiling context of a single thread: histograms and spans are only ever written by their own thread, so no synchronization is needed.
+typedef struct prof_thread_t {
+    uint32_t id;
+    uint64_t histograms[PROF_PHASES_COUNT][PROF_BUCKETS_COUNT];
+    uint64_t min[PROF_PHASES_COUNT];
+    uint64_t max[PROF_PHASES_COUNT];
+    uint64_t sum[PROF_PHASES_COUNT];
+    prof_span_t spans[PROF_SPANS_CAPACITY];
+    uint64_t spans_count;
+    struct prof_thread_t* next;
+} prof_thread_t;
+
+static volatile bool_t prof_is_enabled = FALSE;
+static double prof_ns_per_tick = 1.0;
+static uint64_t prof_origin = 0;
+static bool_t prof_calibrated = FALSE;
+
+// Registered thread contexts, only locked when threads register or when results are read.
+static pthread_mutex_t prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static prof_thread_t* prof_threads = NULL;
+static uint32_t prof_threads_count = 0;
+static _Thread_local prof_thread_t* prof_thread = NULL;
+
+static inline uint64_t prof_clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000UL + (uint64_t) ts.tv_nsec;
+}
+
+// Raw timestamp: TSC ticks where available, nanoseconds otherwise.
+static inline uint64_t prof_timestamp() {
+#ifdef PROF_HAS_TSC
+    return __rdtsc();
+#else
+    return prof_clock_ns();
+#endif
+}
+
+// Measures the TSC frequency against the monotonic clock.
+static void prof_calibrate() {
+#ifdef PROF_HAS_TSC
+    struct timespec sleep_time = {0, 20000000L};
+    uint64_t start_ns = prof_clock_ns();
+    uint64_t start_ticks = prof_timestamp();
+    nanosleep(&sleep_time, NULL);
+    uint64_t end_ticks = prof_timestamp();
+    uint64_t end_ns = prof_clock_ns();
+    prof_ns_per_tick = end_ticks > start_ticks ? (double) (end_ns - start_ns) / (double) (end_ticks - start_ticks) : 1.0;
+#endif
+    prof_origin = prof_timestamp();
+    prof_calibrated = TRUE;
+}
+
+static prof_thread_t* prof_get_thread() {
+    if (prof_thread == NULL) {
+        prof_thread_t* thread = (prof_thread_t*) calloc(1, sizeof(prof_thread_t));
+        if (thread == NULL) {
+            return NULL;
+        }
+
+        for (int i = 0; i < PROF_PHASES_COUNT; i++) {
+            thread->min[i] = UINT64_MAX;
+        }
+
+        pthread_mutex_lock(&prof_lock);
+        thread->id = prof_threads_count++;
+        thread->next = prof_threads;
+        prof_threads = thread;
+        pthread_mutex_unlock(&prof_lock);
+
+        prof_thread = thread;
+    }
+    return prof_thread;
+}
+
+// Log-linear bucketing: values below 2^(PROF_SUB_BUCKET_BITS + 1) get their own bucket, while every higher power of 2 is split in 2^PROF_SUB_BUCKET_BITS buckets.
+static inline uint32_t prof_bucket(uint64_t value) {
+    int msb = value > 0 ? 63 - __builtin_clzll(value) : 0;
+    int shift = msb > PROF_SUB_BUCKET_BITS ? msb - PROF_SUB_BUCKET_BITS : 0;
+    return (uint32_t) ((shift << PROF_SUB_BUCKET_BITS) + (value >> shift));
+}
+
+// Returns the midpoint of the values falling into the given bucket.
+static inline uint64_t prof_bucket_value(uint32_t bucket) {
+    uint32_t shift = bucket < (2U << PROF_SUB_BUCKET_BITS) ? 0 : (bucket >> PROF_SUB_BUCKET_BITS) - 1;
+    uint64_t lower = ((uint64_t) bucket - ((uint64_t) shift << PROF_SUB_BUCKET_BITS)) << shift;
+    return lower + ((1UL << shift) >> 1);
+}
+
+static void prof_record_span(prof_thread_t* thread, prof_phase_t phase, uint64_t start, uint64_t end) {
+    prof_span_t* span = &(thread->spans[thread->spans_count % PROF_SPANS_CAPACITY]);
+    span->start = start;
+    span->end = end;
+    span->phase = phase;
+    thread->spans_count++;
+}
+
+void prof_enable(bool_t enabled) {
+    if (enabled && !prof_calibrated) {
+        prof_calibrate();
+    }
+    prof_is_enabled = enabled;
+}
+
+bool_t prof_enabled() {
+    return prof_is_enabled;
+}
+
+uint64_t prof_span_begin() {
+    return prof_is_enabled ? prof_timestamp() : 0;
+}
+
+void prof_span_end(prof_phase_t phase, uint64_t start) {
+    if (start == 0 || !prof_is_enabled) {
+        return;
+    }
+
+    uint64_t end = prof_timestamp();
+    prof_thread_t* thread = prof_get_thread();
+    if (thread == NULL) {
+        return;
+    }
+
+    uint64_t duration = (uint64_t) ((double) (end - start) * prof_ns_per_tick);
+    thread->histograms[phase][prof_bucket(duration)]++;
+    thread->sum[phase] += duration;
+    thread->min[phase] = duration < thread->min[phase] ? duration : thread->min[phase];
+    thread->max[phase] = duration > thread->max[phase] ? duration : thread->max[phase];
+
+    prof_record_span(thread, phase, start, end);
+}
+
+void prof_trace_end(prof_phase_t phase, uint64_t start) {
+    if (start == 0 || !prof_is_enabled) {
+        return;
+    }
+
+    uint64_t end = prof_timestamp();
+    prof_thread_t* thread = prof_get_thread();
+    if (thread == NULL) {
+        return;
+    }
+
+    prof_record_span(thread, phase, start, end);
+}
+
+void prof_get_stats(prof_phase_t phase, prof_stats_t* stats) {
+    // Merge all threads' histograms.
+    uint64_t* histogram = (uint64_t*) calloc(PROF_BUCKETS_COUNT, sizeof(uint64_t));
+    memset(stats, 0, sizeof(prof_stats_t));
+    if (histogram == NULL) {
+        return;
+    }
+
+    uint64_t sum = 0;
+    stats->min = UINT64_MAX;
+
+    pthread_mutex_lock(&prof_lock);
+    for (prof_thread_t* thread = prof_threads; thread != NULL; thread = thread->next) {
+        for (uint32_t i = 0; i < PROF_BUCKETS_COUNT; i++) {
+            histogram[i] += thread->histograms[phase][i];
+            stats->count += thread->histograms[phase][i];
+        }
+        sum += thread->sum[phase];
+        stats->min = thread->min[phase] < stats->min ? thread->min[phase] : stats->min;
+        stats->max = thread->max[phase] > stats->max ? thread->max[phase] : stats->max;
+    }
+    pthread_mutex_unlock(&prof_lock);
+
+    if (stats->count == 0) {
+        stats->min = 0;
+        free(histogram);
+        return;
+    }
+
+    stats->mean = sum / stats->count;
+
+    // Walk the histogram up to each requested rank.
+    uint64_t p50_rank = (stats->count * 500 + 999) / 1000;
+    uint64_t p99_rank = (stats->count * 990 + 999) / 1000;
+    uint64_t p999_rank = (stats->count * 999 + 999) / 1000;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < PROF_BUCKETS_COUNT; i++) {
+        if (histogram[i] == 0) {
+            continue;
+        }
+
+        uint64_t prev_seen = seen;
+        seen += histogram[i];
+
+        // Clamp to the observed range, since bucket midpoints may fall outside of it.
+        uint64_t value = prof_bucket_value(i);
+        value = value < stats->min ? stats->min : (value > stats->max ? stats->max : value);
+        if (prev_seen < p50_rank && seen >= p50_rank) {
+            stats->p50 = value;
+        }
+        if (prev_seen < p99_rank && seen >= p99_rank) {
+            stats->p99 = value;
+        }
+        if (prev_seen < p999_rank && seen >= p999_rank) {
+            stats->p999 = value;
+        }
+    }
+
+    free(histogram);
+}
+
+void prof_reset() {
+    pthread_mutex_lock(&prof_lock);
+    for (prof_thread_t* thread = prof_threads; thread != NULL; thread = thread->next) {
+        memset(thread->histograms, 0, sizeof(thread->histograms));
+        memset(thread->sum, 0, sizeof(thread->sum));
+        memset(thread->max, 0, sizeof(thread->max));
+        for (int i = 0; i < PROF_PHASES_COUNT; i++) {
+            thread->min[i] = UINT64_MAX;
+        }
+        thread->spans_count = 0;
+    }
+    pthread_mutex_unlock(&prof_lock);
+}
+
+error_code_t prof_to_trace(char* file_name) {
+    // Open output file if possible.
+    FILE* out_file = fopen(file_name, "w");
+    if (out_file == NULL) {
+        printf("File does not exist: %s\n", file_name);
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+
+    fprintf(out_file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    bool_t first = TRUE;
+    pthread_mutex_lock(&prof_lock);
+    for (prof_thread_t* thread = prof_threads; thread != NULL; thread = thread->next) {
+        // Only the most recent spans are kept once the buffer wraps around.
+        uint64_t spans_start = thread->spans_count > PROF_SPANS_CAPACITY ? thread->spans_count - PROF_SPANS_CAPACITY : 0;
+
+        for (uint64_t i = spans_start; i < thread->spans_count; i++) {
+            prof_span_t* span = &(thread->spans[i % PROF_SPANS_CAPACITY]);
+
+            // Chrome traces are expressed in microseconds.
+            double ts = (double) (span->start - prof_origin) * prof_ns_per_tick / 1000.0;
+            double dur = (double) (span->end - span->start) * prof_ns_per_tick / 1000.0;
+            fprintf(out_file,
+                    "%s\n{\"name\":\"%s\",\"cat\":\"behema\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",",
+                    prof_phase_names[span->phase],
+                    thread->id,
+                    ts,
+                    dur);
+            first = FALSE;
+        }
+    }
+    pthread_mutex_unlock(&prof_lock);
+
+    fprintf(out_file, "\n]}\n");
+    fclose(out_file);
+
+    return ERROR_NONE;
+}
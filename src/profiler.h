@@ -0,0 +1,88 @@
+/*
+*****************************************************************
+profiler.h
+
+Copyright (C) 2022 Luka Micheletti
+*****************************************************************
+*/
+
+#ifndef __BEHEMA_PROFILER__
+#define __BEHEMA_PROFILER__
+
+#include <stdint.h>
+#include "cortex.h"
+#include "error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of sub-buckets (as a power of 2) for each power of 2 in latency histograms.
+// 5 bits give 32 sub-buckets, so any recorded value is off by at most ~3%.
+#define PROF_SUB_BUCKET_BITS 5
+#define PROF_BUCKETS_COUNT (64 << PROF_SUB_BUCKET_BITS)
+
+// Number of spans kept by each thread for trace export. Older spans are overwritten.
+#define PROF_SPANS_CAPACITY 0x10000U
+
+typedef enum prof_phase_t {
+    // Input feeding (c2d_feed2d).
+    PROF_PHASE_FEED = 0x00,
+    // Ticks without evolution (c2d_tick).
+    PROF_PHASE_INTEGRATE = 0x01,
+    // Ticks with evolution (c2d_tick).
+    PROF_PHASE_EVOLVE = 0x02,
+    // Cortex dumps (c2d_to_file).
+    PROF_PHASE_CHECKPOINT = 0x03,
+    // Time spent waiting for inputs, recorded by the caller.
+    PROF_PHASE_INPUT_WAIT = 0x04,
+    PROF_PHASES_COUNT = 0x05
+} prof_phase_t;
+
+/// Latency statistics of a single phase, all in nanoseconds.
+typedef struct prof_stats_t {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+} prof_stats_t;
+
+/// Enables or disables profiling. Profiling is disabled by default and costs a single branch per instrumented call when disabled.
+/// The timestamp counter is calibrated the first time profiling is enabled.
+void prof_enable(bool_t enabled);
+
+/// Tells whether profiling is enabled.
+bool_t prof_enabled();
+
+/// Starts a span: returns the current timestamp, or 0 if profiling is disabled.
+uint64_t prof_span_begin();
+
+/// Ends a span started by prof_span_begin, recording its duration in the phase histogram and in the calling thread's trace.
+/// @param phase The phase the span belongs to.
+/// @param start The value returned by prof_span_begin.
+void prof_span_end(prof_phase_t phase, uint64_t start);
+
+/// Ends a span started by prof_span_begin, only recording it in the calling thread's trace.
+/// Used for per-thread work inside a phase, which is already accounted for as a whole in the phase histogram.
+/// @param phase The phase the span belongs to.
+/// @param start The value returned by prof_span_begin.
+void prof_trace_end(prof_phase_t phase, uint64_t start);
+
+/// Computes the latency statistics of the given phase across all threads.
+void prof_get_stats(prof_phase_t phase, prof_stats_t* stats);
+
+/// Clears all recorded histograms and spans.
+void prof_reset();
+
+/// Exports all recorded spans as a Chrome trace (chrome://tracing or Perfetto) JSON file.
+/// @param file_name The destination file, created if not already present, overwritten otherwise.
+error_code_t prof_to_trace(char* file_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,353 @@
+// Must come before any include in order to bring in POSIX functions such as nanosleep() under -std=c17.
+#define _DEFAULT_SOURCE
+
+#include "recorder.h"
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <omp.h>
+
+// Worst case size of a 32 bit LEB128 varint.
+#define VARINT_MAX_SIZE 5
+
+// Time the writer thread sleeps when no frames are available, in nanoseconds.
+#define REC_WRITER_SLEEP_NS 50000L
+
+typedef struct rec_buffer_t {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} rec_buffer_t;
+
+struct spike_recorder_t {
+    FILE* out_file;
+    cortex_size_t width;
+    cortex_size_t height;
+
+    // Bounded ring of encoded frames: the recording thread is the only producer and the writer thread the only consumer.
+    rec_buffer_t* slots;
+    uint32_t ring_size;
+    // Number of frames published by the producer.
+    _Atomic uint64_t head;
+    // Number of frames written by the consumer.
+    _Atomic uint64_t tail;
+    atomic_bool running;
+    pthread_t writer;
+    uint64_t stalls;
+
+    // Per-thread encoding buffers, with the first and last fired index found by each thread.
+    int threads_count;
+    rec_buffer_t* thread_buffers;
+    cortex_size_t* thread_first;
+    cortex_size_t* thread_last;
+    cortex_size_t* thread_counts;
+};
+
+static inline size_t varint_write(uint8_t* data, uint32_t value) {
+    size_t size = 0;
+    while (value >= 0x80U) {
+        data[size++] = (uint8_t) (value | 0x80U);
+        value >>= 7;
+    }
+    data[size++] = (uint8_t) value;
+    return size;
+}
+
+static error_code_t varint_read(FILE* in_file, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < VARINT_MAX_SIZE * 7; shift += 7) {
+        int byte = fgetc(in_file);
+        if (byte == EOF) {
+            return ERROR_FILE_SIZE_WRONG;
+        }
+        result |= ((uint32_t) (byte & 0x7F)) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return ERROR_NONE;
+        }
+    }
+    return ERROR_FILE_WRONG_FORMAT;
+}
+
+// Makes sure the given buffer can hold at least capacity bytes.
+static error_code_t buffer_reserve(rec_buffer_t* buffer, size_t capacity) {
+    if (buffer->capacity < capacity) {
+        uint8_t* data = (uint8_t*) realloc(buffer->data, capacity);
+        if (data == NULL) {
+            return ERROR_FAILED_ALLOC;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return ERROR_NONE;
+}
+
+static void* rec_writer_run(void* args) {
+    spike_recorder_t* recorder = (spike_recorder_t*) args;
+    struct timespec sleep_time = {0, REC_WRITER_SLEEP_NS};
+
+    for (;;) {
+        uint64_t tail = atomic_load_explicit(&(recorder->tail), memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&(recorder->head), memory_order_acquire);
+
+        if (tail < head) {
+            rec_buffer_t* slot = &(recorder->slots[tail % recorder->ring_size]);
+            fwrite(slot->data, sizeof(uint8_t), slot->size, recorder->out_file);
+
+            // Hand the slot back to the producer.
+            atomic_store_explicit(&(recorder->tail), tail + 1, memory_order_release);
+        } else if (!atomic_load_explicit(&(recorder->running), memory_order_acquire)) {
+            // Only stop once every published frame is written.
+            if (tail == atomic_load_explicit(&(recorder->head), memory_order_acquire)) {
+                break;
+            }
+        } else {
+            nanosleep(&sleep_time, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+// Closes the output file and frees all buffers of a recorder whose writer thread is not running, whether fully initialized or not.
+static void rec_free(spike_recorder_t* recorder) {
+    if (recorder->out_file != NULL) {
+        fclose(recorder->out_file);
+    }
+
+    if (recorder->slots != NULL) {
+        for (uint32_t i = 0; i < recorder->ring_size; i++) {
+            free(recorder->slots[i].data);
+        }
+    }
+    if (recorder->thread_buffers != NULL) {
+        for (int i = 0; i < recorder->threads_count; i++) {
+            free(recorder->thread_buffers[i].data);
+        }
+    }
+
+    free(recorder->slots);
+    free(recorder->thread_buffers);
+    free(recorder->thread_first);
+    free(recorder->thread_last);
+    free(recorder->thread_counts);
+    free(recorder);
+}
+
+error_code_t rec_init(spike_recorder_t** recorder, cortex2d_t* cortex, char* file_name, uint32_t ring_size) {
+    // Recordings store neuron indexes as cortex_size_t and counts as 32 bit varints.
+    if ((cortex_index_t) cortex->width * cortex->height > INT32_MAX) {
+        (*recorder) = NULL;
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    (*recorder) = (spike_recorder_t*) calloc(1, sizeof(spike_recorder_t));
+    if ((*recorder) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    (*recorder)->width = cortex->width;
+    (*recorder)->height = cortex->height;
+    (*recorder)->ring_size = ring_size > 0 ? ring_size : REC_DEFAULT_RING_SIZE;
+    atomic_init(&((*recorder)->head), 0);
+    atomic_init(&((*recorder)->tail), 0);
+    atomic_init(&((*recorder)->running), TRUE);
+
+    (*recorder)->slots = (rec_buffer_t*) calloc((*recorder)->ring_size, sizeof(rec_buffer_t));
+    (*recorder)->threads_count = omp_get_max_threads();
+    (*recorder)->thread_buffers = (rec_buffer_t*) calloc((*recorder)->threads_count, sizeof(rec_buffer_t));
+    (*recorder)->thread_first = (cortex_size_t*) malloc((*recorder)->threads_count * sizeof(cortex_size_t));
+    (*recorder)->thread_last = (cortex_size_t*) malloc((*recorder)->threads_count * sizeof(cortex_size_t));
+    (*recorder)->thread_counts = (cortex_size_t*) malloc((*recorder)->threads_count * sizeof(cortex_size_t));
+    if ((*recorder)->slots == NULL ||
+        (*recorder)->thread_buffers == NULL ||
+        (*recorder)->thread_first == NULL ||
+        (*recorder)->thread_last == NULL ||
+        (*recorder)->thread_counts == NULL) {
+        rec_free(*recorder);
+        (*recorder) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    // Open output file if possible.
+    (*recorder)->out_file = fopen(file_name, "wb");
+    if ((*recorder)->out_file == NULL) {
+        printf("File does not exist: %s\n", file_name);
+        rec_free(*recorder);
+        (*recorder) = NULL;
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+
+    // Write recording header.
+    fwrite(REC_MAGIC, sizeof(char), strlen(REC_MAGIC), (*recorder)->out_file);
+    fwrite(&(cortex->width), sizeof(cortex_size_t), 1, (*recorder)->out_file);
+    fwrite(&(cortex->height), sizeof(cortex_size_t), 1, (*recorder)->out_file);
+
+    if (pthread_create(&((*recorder)->writer), NULL, rec_writer_run, *recorder) != 0) {
+        rec_free(*recorder);
+        (*recorder) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+
+    return ERROR_NONE;
+}
+
+error_code_t rec_destroy(spike_recorder_t* recorder) {
+    if (recorder->out_file != NULL) {
+        // Let the writer drain the ring, then stop it.
+        atomic_store_explicit(&(recorder->running), FALSE, memory_order_release);
+        pthread_join(recorder->writer, NULL);
+    }
+
+    rec_free(recorder);
+
+    return ERROR_NONE;
+}
+
+error_code_t c2d_record(spike_recorder_t* recorder, cortex2d_t* cortex) {
+    if (cortex->width != recorder->width || cortex->height != recorder->height) {
+        return ERROR_FILE_SIZE_WRONG;
+    }
+
+    cortex_index_t neurons_count = (cortex_index_t) cortex->width * cortex->height;
+    error_code_t error = ERROR_NONE;
+
+    // Each thread scans a contiguous band of neurons and delta-encodes the ones that fired in its own buffer.
+    // The first index of each band is kept aside, since its delta depends on the bands before it.
+    #pragma omp parallel num_threads(recorder->threads_count)
+    {
+        int threads_count = omp_get_num_threads();
+        int thread_id = omp_get_thread_num();
+        cortex_index_t band_start = (neurons_count * thread_id) / threads_count;
+        cortex_index_t band_end = (neurons_count * (thread_id + 1)) / threads_count;
+
+        rec_buffer_t* buffer = &(recorder->thread_buffers[thread_id]);
+        buffer->size = 0;
+        cortex_size_t first = -1;
+        cortex_size_t last = -1;
+        cortex_size_t count = 0;
+
+        if (buffer_reserve(buffer, (size_t) (band_end - band_start) * VARINT_MAX_SIZE) != ERROR_NONE) {
+            #pragma omp atomic write
+            error = ERROR_FAILED_ALLOC;
+        } else {
+            for (cortex_index_t i = band_start; i < band_end; i++) {
+                // The last bit of the pulse mask is set if the neuron fired during the last tick.
+                // Events carry row-major indexes, whatever the neurons order.
+                if (cortex->neurons[ORDER_IDX1D(i, cortex->width, cortex->neurons_order)].pulse_mask & 0x01U) {
+                    // Indexes fit cortex_size_t, as checked by rec_init.
+                    if (first < 0) {
+                        first = (cortex_size_t) i;
+                    } else {
+                        buffer->size += varint_write(buffer->data + buffer->size, (uint32_t) (i - last - 1));
+                    }
+                    last = (cortex_size_t) i;
+                    count++;
+                }
+            }
+        }
+
+        recorder->thread_first[thread_id] = first;
+        recorder->thread_last[thread_id] = last;
+        recorder->thread_counts[thread_id] = count;
+
+        // Threads beyond the team size do not take part in the frame.
+        #pragma omp single
+        for (int i = threads_count; i < recorder->threads_count; i++) {
+            recorder->thread_counts[i] = 0;
+        }
+    }
+
+    if (error != ERROR_NONE) {
+        return error;
+    }
+
+    // Wait for a free slot in the ring.
+    uint64_t head = atomic_load_explicit(&(recorder->head), memory_order_relaxed);
+    if (head - atomic_load_explicit(&(recorder->tail), memory_order_acquire) >= recorder->ring_size) {
+        recorder->stalls++;
+        while (head - atomic_load_explicit(&(recorder->tail), memory_order_acquire) >= recorder->ring_size) {
+            sched_yield();
+        }
+    }
+
+    rec_buffer_t* slot = &(recorder->slots[head % recorder->ring_size]);
+
+    // Compute the frame size.
+    cortex_size_t count = 0;
+    size_t frame_size = VARINT_MAX_SIZE;
+    for (int i = 0; i < recorder->threads_count; i++) {
+        count += recorder->thread_counts[i];
+        if (recorder->thread_counts[i] > 0) {
+            frame_size += VARINT_MAX_SIZE + recorder->thread_buffers[i].size;
+        }
+    }
+
+    error = buffer_reserve(slot, frame_size);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+
+    // Stitch the thread buffers together, fixing up the first delta of each band.
+    slot->size = varint_write(slot->data, (uint32_t) count);
+    cortex_size_t prev = -1;
+    for (int i = 0; i < recorder->threads_count; i++) {
+        if (recorder->thread_counts[i] > 0) {
+            slot->size += varint_write(slot->data + slot->size, (uint32_t) (recorder->thread_first[i] - prev - 1));
+            memcpy(slot->data + slot->size, recorder->thread_buffers[i].data, recorder->thread_buffers[i].size);
+            slot->size += recorder->thread_buffers[i].size;
+            prev = recorder->thread_last[i];
+        }
+    }
+
+    // Publish the frame to the writer thread.
+    atomic_store_explicit(&(recorder->head), head + 1, memory_order_release);
+
+    return ERROR_NONE;
+}
+
+uint64_t rec_get_stalls(spike_recorder_t* recorder) {
+    return recorder->stalls;
+}
+
+error_code_t rec_read_header(FILE* in_file, cortex_size_t* width, cortex_size_t* height) {
+    char magic[sizeof(REC_MAGIC)] = {0};
+
+    if (fread(magic, sizeof(char), strlen(REC_MAGIC), in_file) != strlen(REC_MAGIC) ||
+        strcmp(magic, REC_MAGIC) != 0) {
+        return ERROR_FILE_WRONG_FORMAT;
+    }
+
+    if (fread(width, sizeof(cortex_size_t), 1, in_file) != 1 ||
+        fread(height, sizeof(cortex_size_t), 1, in_file) != 1) {
+        return ERROR_FILE_SIZE_WRONG;
+    }
+
+    return ERROR_NONE;
+}
+
+error_code_t rec_read_frame(FILE* in_file, cortex_size_t* indices, cortex_size_t* count) {
+    uint32_t frame_count;
+    error_code_t error = varint_read(in_file, &frame_count);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+
+    cortex_size_t prev = -1;
+    for (uint32_t i = 0; i < frame_count; i++) {
+        uint32_t delta;
+        error = varint_read(in_file, &delta);
+        if (error != ERROR_NONE) {
+            return error;
+        }
+
+        prev += (cortex_size_t) delta + 1;
+        indices[i] = prev;
+    }
+
+    *count = (cortex_size_t) frame_count;
+
+    return ERROR_NONE;
+}
@@ -0,0 +1,80 @@
+/*
+*****************************************************************
+recorder.h
+
+Copyright (C) 2022 Luka Micheletti
+*****************************************************************
+*/
+
+#ifndef __BEHEMA_RECORDER__
+#define __BEHEMA_RECORDER__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "cortex.h"
+#include "error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Spike recordings use an address-event representation (AER):
+// +--------+-------+--------+---------+---------+-----+---------+-----
+// | "BAER" | width | height | frame 0 | frame 1 | ... | frame n | ...
+// +--------+-------+--------+---------+---------+-----+---------+-----
+// where width and height are stored as cortex_size_t and every frame holds the neurons fired in a single tick:
+// +-------+---------+---------+-----+
+// | count | delta 0 | delta 1 | ... |
+// +-------+---------+---------+-----+
+// Every value in a frame is a LEB128 varint. Fired neurons are listed by increasing index, and each delta is the
+// distance from the previous index minus 1 (the first one is relative to index -1), so dense bursts take 1 byte per spike.
+
+/// Magic bytes at the beginning of every spikes recording.
+#define REC_MAGIC "BAER"
+
+/// Default number of frames buffered in memory before the recording tick blocks.
+#define REC_DEFAULT_RING_SIZE 0x40U
+
+/// Spikes recorder: encodes spikes in parallel and hands them off to a dedicated writer thread through a bounded, lock-free ring.
+typedef struct spike_recorder_t spike_recorder_t;
+
+/// Initializes a recorder writing to the given file.
+/// The file is created if not already present, overwritten otherwise.
+/// @param recorder The recorder to initialize, set to NULL on failure.
+/// @param cortex The cortex to record, only used to read its size.
+/// @param file_name The destination file to write spikes to.
+/// @param ring_size The number of frames buffered in memory, REC_DEFAULT_RING_SIZE if 0.
+/// @return ERROR_SIZE_MISMATCH for cortices of more than 2^31 - 1 neurons, which don't fit the recording format.
+error_code_t rec_init(spike_recorder_t** recorder, cortex2d_t* cortex, char* file_name, uint32_t ring_size);
+
+/// Flushes any pending frame, stops the writer thread and frees memory.
+error_code_t rec_destroy(spike_recorder_t* recorder);
+
+/// Records the neurons fired during the last tick of the given cortex. Should be called right after c2d_tick on its next_cortex.
+/// Only blocks if the writer thread falls behind by more than the ring size.
+/// @param recorder The recorder to write to.
+/// @param cortex The cortex to record.
+error_code_t c2d_record(spike_recorder_t* recorder, cortex2d_t* cortex);
+
+/// Returns the number of times the recording tick had to wait for the writer thread.
+uint64_t rec_get_stalls(spike_recorder_t* recorder);
+
+/// Reads the header of a spikes recording.
+/// @param in_file The recording file, positioned at its start.
+/// @param width Filled with the recorded cortex width.
+/// @param height Filled with the recorded cortex height.
+error_code_t rec_read_header(FILE* in_file, cortex_size_t* width, cortex_size_t* height);
+
+/// Reads the next frame of a spikes recording.
+/// @param in_file The recording file, positioned at the start of a frame.
+/// @param indices Filled with the indices of fired neurons, must hold up to width * height values.
+/// @param count Filled with the number of fired neurons.
+/// @return ERROR_FILE_SIZE_WRONG if no complete frame is left.
+error_code_t rec_read_frame(FILE* in_file, cortex_size_t* indices, cortex_size_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
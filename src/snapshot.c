@@ -0,0 +1,333 @@
+// Must come before any include in order to bring in POSIX functions such as ftruncate() under -std=c17.
+#define _DEFAULT_SOURCE
+
+#include "snapshot.h"
+#include <string.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+
+// Planes in the order they're laid out in each slot's data.
+#define SNAP_PLANES_COUNT 5
+#define SNAP_VALUES 0
+#define SNAP_PULSES 1
+#define SNAP_FIRED 2
+#define SNAP_SYNAC 3
+#define SNAP_SYNEX 4
+
+typedef struct snap_slot_t {
+    // Odd while the slot's data is being written, increased by 2 every time it's written.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t sequence;
+    _Atomic uint64_t number;
+    _Atomic uint32_t ticks_count;
+} snap_slot_t;
+
+typedef struct snap_header_t {
+    char magic[4];
+    // Set once the rest of the header is filled in.
+    _Atomic uint32_t ready;
+    cortex_size_t width;
+    cortex_size_t height;
+    uint32_t planes;
+    uint64_t slot_size;
+
+    // Index of the latest published slot, sits on its own cache line since it's the only field readers poll.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t latest;
+
+    snap_slot_t slots[SNAP_SLOTS_COUNT];
+} snap_header_t;
+
+struct snap_publisher_t {
+    char* name;
+    byte* mapping;
+    size_t mapping_size;
+    snap_header_t* header;
+    byte* data;
+
+    cortex_size_t width;
+    cortex_size_t height;
+    uint32_t planes;
+    ticks_count_t period;
+    size_t offsets[SNAP_PLANES_COUNT];
+    uint64_t published_count;
+};
+
+struct snap_reader_t {
+    byte* mapping;
+    size_t mapping_size;
+    snap_header_t* header;
+    byte* data;
+    size_t offsets[SNAP_PLANES_COUNT];
+};
+
+static inline size_t snap_align(size_t size) {
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+// Computes the offset of each plane in a slot's data and returns the slot size. Offsets of planes not being published are left untouched.
+static size_t snap_layout(cortex_size_t width, cortex_size_t height, uint32_t planes, size_t offsets[SNAP_PLANES_COUNT]) {
+    size_t neurons_count = (size_t) width * (size_t) height;
+    size_t slot_size = 0;
+
+    if (planes & SNAP_PLANE_VALUES) {
+        offsets[SNAP_VALUES] = slot_size;
+        slot_size += snap_align(neurons_count * sizeof(neuron_value_t));
+    }
+    if (planes & SNAP_PLANE_PULSES) {
+        offsets[SNAP_PULSES] = slot_size;
+        slot_size += snap_align(neurons_count * sizeof(spikes_count_t));
+    }
+    if (planes & SNAP_PLANE_FIRED) {
+        offsets[SNAP_FIRED] = slot_size;
+        slot_size += snap_align((neurons_count + 63) / 64 * sizeof(uint64_t));
+    }
+    if (planes & SNAP_PLANE_MASKS) {
+        offsets[SNAP_SYNAC] = slot_size;
+        slot_size += snap_align(neurons_count * sizeof(nh_mask_t));
+        offsets[SNAP_SYNEX] = slot_size;
+        slot_size += snap_align(neurons_count * sizeof(nh_mask_t));
+    }
+
+    // Keep slots apart even when no plane is published.
+    return slot_size > 0 ? slot_size : CACHE_LINE_SIZE;
+}
+
+error_code_t snap_publisher_init(snap_publisher_t** publisher, cortex2d_t* cortex, const char* name, uint32_t planes, ticks_count_t period) {
+    // Wide synapses don't fit in nh_mask_t.
+    if ((planes & SNAP_PLANE_MASKS) && cortex->wide_synapses != NULL) {
+        return ERROR_NH_RADIUS_TOO_BIG;
+    }
+
+    (*publisher) = (snap_publisher_t*) calloc(1, sizeof(snap_publisher_t));
+    if ((*publisher) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+    (*publisher)->name = strdup(name);
+    if ((*publisher)->name == NULL) {
+        free(*publisher);
+        return ERROR_FAILED_ALLOC;
+    }
+    (*publisher)->width = cortex->width;
+    (*publisher)->height = cortex->height;
+    (*publisher)->planes = planes;
+    (*publisher)->period = period > 0 ? period : 1;
+
+    size_t slot_size = snap_layout(cortex->width, cortex->height, planes, (*publisher)->offsets);
+    size_t header_size = snap_align(sizeof(snap_header_t));
+    (*publisher)->mapping_size = header_size + SNAP_SLOTS_COUNT * slot_size;
+
+    // A stale object left behind by a crashed publisher would have the wrong layout, so it's replaced by a new one.
+    shm_unlink(name);
+    int file = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (file < 0) {
+        free((*publisher)->name);
+        free(*publisher);
+        return ERROR_FILE_WRITE_FAILED;
+    }
+    if (ftruncate(file, (off_t) (*publisher)->mapping_size) != 0) {
+        close(file);
+        shm_unlink(name);
+        free((*publisher)->name);
+        free(*publisher);
+        return ERROR_FILE_WRITE_FAILED;
+    }
+    (*publisher)->mapping = (byte*) mmap(NULL, (*publisher)->mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if ((*publisher)->mapping == MAP_FAILED) {
+        shm_unlink(name);
+        free((*publisher)->name);
+        free(*publisher);
+        return ERROR_FILE_WRITE_FAILED;
+    }
+    (*publisher)->header = (snap_header_t*) (*publisher)->mapping;
+    (*publisher)->data = (*publisher)->mapping + header_size;
+
+    // The object is zero filled, so all slots start with no snapshot in them, and the first one goes to slot 0.
+    snap_header_t* header = (*publisher)->header;
+    memcpy(header->magic, SNAP_MAGIC, sizeof(header->magic));
+    header->width = cortex->width;
+    header->height = cortex->height;
+    header->planes = planes;
+    header->slot_size = slot_size;
+    atomic_store_explicit(&(header->latest), SNAP_SLOTS_COUNT - 1, memory_order_relaxed);
+    atomic_store_explicit(&(header->ready), 1, memory_order_release);
+
+    return ERROR_NONE;
+}
+
+error_code_t snap_publisher_destroy(snap_publisher_t* publisher) {
+    munmap(publisher->mapping, publisher->mapping_size);
+    shm_unlink(publisher->name);
+    free(publisher->name);
+    free(publisher);
+
+    return ERROR_NONE;
+}
+
+error_code_t c2d_publish(snap_publisher_t* publisher, cortex2d_t* cortex) {
+    if (cortex->width != publisher->width || cortex->height != publisher->height) {
+        return ERROR_SIZE_MISMATCH;
+    }
+    if (cortex->ticks_count % publisher->period != 0) {
+        return ERROR_NONE;
+    }
+
+    // Write to the slot after the latest one: readers are most likely on the latest one, and never on this one unless they fell behind.
+    snap_header_t* header = publisher->header;
+    uint32_t slot_index = (atomic_load_explicit(&(header->latest), memory_order_relaxed) + 1) % SNAP_SLOTS_COUNT;
+    snap_slot_t* slot = &(header->slots[slot_index]);
+    byte* data = publisher->data + (size_t) slot_index * header->slot_size;
+
+    // Seqlock write: readers seeing an odd sequence, or a different one once done, know the data changed under them.
+    uint64_t sequence = atomic_load_explicit(&(slot->sequence), memory_order_relaxed);
+    atomic_store_explicit(&(slot->sequence), sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    neuron_value_t* values = (publisher->planes & SNAP_PLANE_VALUES) ? (neuron_value_t*) (data + publisher->offsets[SNAP_VALUES]) : NULL;
+    spikes_count_t* pulses = (publisher->planes & SNAP_PLANE_PULSES) ? (spikes_count_t*) (data + publisher->offsets[SNAP_PULSES]) : NULL;
+    uint64_t* fired = (publisher->planes & SNAP_PLANE_FIRED) ? (uint64_t*) (data + publisher->offsets[SNAP_FIRED]) : NULL;
+    nh_mask_t* synac_masks = (publisher->planes & SNAP_PLANE_MASKS) ? (nh_mask_t*) (data + publisher->offsets[SNAP_SYNAC]) : NULL;
+    nh_mask_t* synex_masks = (publisher->planes & SNAP_PLANE_MASKS) ? (nh_mask_t*) (data + publisher->offsets[SNAP_SYNEX]) : NULL;
+
+    // Planes are row-major, whatever the neurons order.
+    if (values != NULL || pulses != NULL || synac_masks != NULL) {
+        #pragma omp parallel for
+        for (cortex_size_t y = 0; y < cortex->height; y++) {
+            for (cortex_size_t x = 0; x < cortex->width; x++) {
+                cortex_index_t index = IDX2D(x, y, cortex->width);
+                neuron_t* neuron = &(cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)]);
+                if (values != NULL) {
+                    values[index] = neuron->value;
+                }
+                if (pulses != NULL) {
+                    pulses[index] = neuron->pulse;
+                }
+                if (synac_masks != NULL) {
+                    synac_masks[index] = neuron->synac_mask;
+                    synex_masks[index] = neuron->synex_mask;
+                }
+            }
+        }
+    }
+
+    if (fired != NULL) {
+        cortex_index_t neurons_count = (cortex_index_t) cortex->width * cortex->height;
+        cortex_index_t words_count = (neurons_count + 63) / 64;
+
+        #pragma omp parallel for
+        for (cortex_index_t word_index = 0; word_index < words_count; word_index++) {
+            cortex_index_t end = (word_index + 1) * 64 < neurons_count ? (word_index + 1) * 64 : neurons_count;
+            uint64_t word = 0x00UL;
+            for (cortex_index_t i = word_index * 64; i < end; i++) {
+                // The last bit of the pulse mask is set if the neuron fired during the last tick.
+                word |= ((uint64_t) (cortex->neurons[ORDER_IDX1D(i, cortex->width, cortex->neurons_order)].pulse_mask & 0x01U)) << (i % 64);
+            }
+            fired[word_index] = word;
+        }
+    }
+
+    publisher->published_count++;
+    atomic_store_explicit(&(slot->number), publisher->published_count, memory_order_relaxed);
+    atomic_store_explicit(&(slot->ticks_count), cortex->ticks_count, memory_order_relaxed);
+    atomic_store_explicit(&(slot->sequence), sequence + 2, memory_order_release);
+    atomic_store_explicit(&(header->latest), slot_index, memory_order_release);
+
+    return ERROR_NONE;
+}
+
+error_code_t snap_reader_open(snap_reader_t** reader, const char* name) {
+    int file = shm_open(name, O_RDONLY, 0);
+    if (file < 0) {
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || (size_t) file_stat.st_size < snap_align(sizeof(snap_header_t))) {
+        close(file);
+        return ERROR_FILE_WRONG_FORMAT;
+    }
+
+    (*reader) = (snap_reader_t*) calloc(1, sizeof(snap_reader_t));
+    if ((*reader) == NULL) {
+        close(file);
+        return ERROR_FAILED_ALLOC;
+    }
+    (*reader)->mapping_size = (size_t) file_stat.st_size;
+    (*reader)->mapping = (byte*) mmap(NULL, (*reader)->mapping_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if ((*reader)->mapping == MAP_FAILED) {
+        free(*reader);
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+    (*reader)->header = (snap_header_t*) (*reader)->mapping;
+    (*reader)->data = (*reader)->mapping + snap_align(sizeof(snap_header_t));
+
+    // The header is only trusted once the publisher is done filling it in, and only if it matches the object size.
+    snap_header_t* header = (*reader)->header;
+    bool_t valid = atomic_load_explicit(&(header->ready), memory_order_acquire) &&
+                   memcmp(header->magic, SNAP_MAGIC, sizeof(header->magic)) == 0;
+    if (valid) {
+        size_t slot_size = snap_layout(header->width, header->height, header->planes, (*reader)->offsets);
+        valid = slot_size == header->slot_size &&
+                snap_align(sizeof(snap_header_t)) + SNAP_SLOTS_COUNT * slot_size <= (*reader)->mapping_size;
+    }
+    if (!valid) {
+        munmap((*reader)->mapping, (*reader)->mapping_size);
+        free(*reader);
+        return ERROR_FILE_WRONG_FORMAT;
+    }
+
+    return ERROR_NONE;
+}
+
+error_code_t snap_reader_close(snap_reader_t* reader) {
+    munmap(reader->mapping, reader->mapping_size);
+    free(reader);
+
+    return ERROR_NONE;
+}
+
+error_code_t snap_read_begin(snap_reader_t* reader, snap_view_t* view) {
+    snap_header_t* header = reader->header;
+    uint32_t slot_index;
+    uint64_t sequence;
+
+    // Only a reader falling two snapshots behind finds the latest slot being written, in which case a newer one is ready to be read.
+    for (;;) {
+        slot_index = atomic_load_explicit(&(header->latest), memory_order_acquire);
+        sequence = atomic_load_explicit(&(header->slots[slot_index].sequence), memory_order_acquire);
+        if (sequence == 0) {
+            return ERROR_NOT_READY;
+        }
+        if (!(sequence & 0x01U)) {
+            break;
+        }
+        sched_yield();
+    }
+
+    snap_slot_t* slot = &(header->slots[slot_index]);
+    const byte* data = reader->data + (size_t) slot_index * header->slot_size;
+
+    view->width = header->width;
+    view->height = header->height;
+    view->number = atomic_load_explicit(&(slot->number), memory_order_relaxed);
+    view->ticks_count = (ticks_count_t) atomic_load_explicit(&(slot->ticks_count), memory_order_relaxed);
+    view->values = (header->planes & SNAP_PLANE_VALUES) ? (const neuron_value_t*) (data + reader->offsets[SNAP_VALUES]) : NULL;
+    view->pulses = (header->planes & SNAP_PLANE_PULSES) ? (const spikes_count_t*) (data + reader->offsets[SNAP_PULSES]) : NULL;
+    view->fired = (header->planes & SNAP_PLANE_FIRED) ? (const uint64_t*) (data + reader->offsets[SNAP_FIRED]) : NULL;
+    view->synac_masks = (header->planes & SNAP_PLANE_MASKS) ? (const nh_mask_t*) (data + reader->offsets[SNAP_SYNAC]) : NULL;
+    view->synex_masks = (header->planes & SNAP_PLANE_MASKS) ? (const nh_mask_t*) (data + reader->offsets[SNAP_SYNEX]) : NULL;
+    view->slot = slot_index;
+    view->sequence = sequence;
+
+    return ERROR_NONE;
+}
+
+bool_t snap_read_end(snap_reader_t* reader, const snap_view_t* view) {
+    // Make sure all reads through the view happen before checking the sequence again.
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&(reader->header->slots[view->slot].sequence), memory_order_relaxed) == view->sequence;
+}
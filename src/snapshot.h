@@ -0,0 +1,114 @@
+/*
+*****************************************************************
+snapshot.h
+
+Copyright (C) 2022 Luka Micheletti
+*****************************************************************
+*/
+
+#ifndef __BEHEMA_SNAPSHOT__
+#define __BEHEMA_SNAPSHOT__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "cortex.h"
+#include "error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Snapshots are published to a POSIX shared memory object, laid out as:
+// +--------+---------+---------+---------+--------+--------+--------+
+// | header | slot 0  | slot 1  | slot 2  | data 0 | data 1 | data 2 |
+// +--------+---------+---------+---------+--------+--------+--------+
+// where the header holds the cortex size, the published planes and the index of the latest published slot, while each slot holds
+// a sequence counter (odd while its data is being written), the number of the snapshot it holds and the cortex ticks count.
+// Each slot's data holds the published planes in the following order, each one starting on a cache line and in row-major order:
+// values (neuron_value_t), pulses (spikes_count_t), fired (one bit per neuron, in 64 bit words), synac masks and synex masks (nh_mask_t).
+// The publisher writes each snapshot to the slot after the latest one, so readers have two full periods to go through a snapshot
+// before it's overwritten, and the sequence counter tells them whether it was.
+
+/// Magic bytes at the beginning of every snapshots object.
+#define SNAP_MAGIC "BSNP"
+
+/// Number of snapshots kept in the shared memory object.
+#define SNAP_SLOTS_COUNT 3
+
+/// Planes of neurons data that can be published, to be combined as flags.
+typedef enum snap_plane_t {
+    // Neurons values.
+    SNAP_PLANE_VALUES = 0x01,
+    // Neurons pulses.
+    SNAP_PLANE_PULSES = 0x02,
+    // Bitmap of neurons fired during the last tick.
+    SNAP_PLANE_FIRED = 0x04,
+    // Synapses (synac and synex masks), only available with neighborhood radii up to 3.
+    SNAP_PLANE_MASKS = 0x08
+} snap_plane_t;
+
+/// Publisher of cortex snapshots to shared memory: the tick loop never waits for readers.
+typedef struct snap_publisher_t snap_publisher_t;
+
+/// Reader of the snapshots published by another process.
+typedef struct snap_reader_t snap_reader_t;
+
+/// View of a published snapshot, pointing straight into shared memory. Planes not being published are NULL.
+typedef struct snap_view_t {
+    cortex_size_t width;
+    cortex_size_t height;
+
+    // Number of the snapshot, counting from 1: increases by 1 every time one is published.
+    uint64_t number;
+    // Ticks count of the cortex at the time of the snapshot.
+    ticks_count_t ticks_count;
+
+    const neuron_value_t* values;
+    const spikes_count_t* pulses;
+    const uint64_t* fired;
+    const nh_mask_t* synac_masks;
+    const nh_mask_t* synex_masks;
+
+    // Slot and sequence counter the view was taken at.
+    uint32_t slot;
+    uint64_t sequence;
+} snap_view_t;
+
+/// Initializes a publisher, creating the shared memory object readers attach to. Any previous object with the same name is replaced.
+/// @param publisher The publisher to initialize.
+/// @param cortex The cortex to publish, only used to read its size.
+/// @param name The name of the shared memory object, as accepted by shm_open (e.g. "/behema_snap").
+/// @param planes The planes to publish, as a combination of snap_plane_t flags.
+/// @param period The number of ticks between two snapshots.
+/// @return ERROR_NH_RADIUS_TOO_BIG if masks are requested for a cortex with wide synapses, ERROR_FILE_WRITE_FAILED if the object can't be created.
+error_code_t snap_publisher_init(snap_publisher_t** publisher, cortex2d_t* cortex, const char* name, uint32_t planes, ticks_count_t period);
+
+/// Removes the shared memory object and frees memory. Readers still attached keep their mapping until they close.
+error_code_t snap_publisher_destroy(snap_publisher_t* publisher);
+
+/// Publishes a snapshot of the given cortex if its ticks count is a multiple of the publisher's period, does nothing otherwise.
+/// Should be called right after c2d_tick on its next_cortex. Never blocks.
+/// @param publisher The publisher to write to.
+/// @param cortex The cortex to publish.
+error_code_t c2d_publish(snap_publisher_t* publisher, cortex2d_t* cortex);
+
+/// Attaches a reader to the snapshots published with the given name, mapping them read-only.
+/// @return ERROR_FILE_DOES_NOT_EXIST if no publisher created the object, ERROR_FILE_WRONG_FORMAT if it's not ready or not a snapshots object.
+error_code_t snap_reader_open(snap_reader_t** reader, const char* name);
+
+/// Detaches the reader and frees memory.
+error_code_t snap_reader_close(snap_reader_t* reader);
+
+/// Points the given view to the latest published snapshot, with no copies. Its data must only be trusted once snap_read_end confirms it.
+/// @return ERROR_NOT_READY if no snapshot has been published yet, in which case the call can simply be retried later.
+error_code_t snap_read_begin(snap_reader_t* reader, snap_view_t* view);
+
+/// Checks whether the snapshot the given view points to is still the one it was taken at.
+/// @return TRUE if all data read through the view since snap_read_begin is consistent, FALSE if the publisher overwrote it in the meantime.
+bool_t snap_read_end(snap_reader_t* reader, const snap_view_t* view);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,457 @@
+// Must come before any include in order to bring in POSIX functions such as clock_gettime() under -std=c17.
+#define _DEFAULT_SOURCE
+
+#include "sweep.h"
+#include "behema_std.h"
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include <omp.h>
+
+static const char* sweep_param_names[SWEEP_PARAMS_COUNT] = {
+    "fire_threshold",
+    "recovery_value",
+    "exc_value",
+    "decay_value",
+    "syngen_chance",
+    "synstr_chance",
+    "max_tot_strength",
+    "max_syn_count",
+    "inhexc_ratio",
+    "evol_step",
+    "pulse_window",
+    "rand_seed"
+};
+
+typedef struct sweep_axis_t {
+    sweep_param_t param;
+    int64_t* values;
+    uint32_t values_count;
+} sweep_axis_t;
+
+typedef struct sweep_result_t {
+    double seconds;
+    double firing_rate;
+    uint64_t syn_count;
+    uint64_t syn_strength;
+    error_code_t error;
+} sweep_result_t;
+
+// Double-ended queue of run indices owned by a worker: the owner pops from the back, while thieves steal from the front.
+// Runs are coarse work items, so a plain lock per queue is enough.
+typedef struct sweep_queue_t {
+    uint64_t* runs;
+    uint64_t front;
+    uint64_t back;
+    pthread_mutex_t lock;
+} sweep_queue_t;
+
+struct sweep2d_t {
+    cortex2d_t* cortex;
+    input2d_t* input;
+    ticks_count_t* trace;
+    uint32_t frames_count;
+    uint32_t ticks_per_frame;
+    uint32_t ticks_count;
+    size_t parallel_neurons;
+
+    sweep_axis_t axes[SWEEP_MAX_AXES];
+    uint32_t axes_count;
+
+    // Only valid while running.
+    sweep_result_t* results;
+    sweep_queue_t* queues;
+    uint32_t workers_count;
+};
+
+typedef struct sweep_worker_t {
+    sweep2d_t* sweep;
+    uint32_t id;
+    pthread_t thread;
+} sweep_worker_t;
+
+static inline double sweep_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+// Returns the index of the given axis' value used by the given run: runs enumerate combinations with the first axis varying fastest.
+static uint32_t sweep_value_index(sweep2d_t* sweep, uint64_t run, uint32_t axis) {
+    for (uint32_t i = 0; i < axis; i++) {
+        run /= sweep->axes[i].values_count;
+    }
+    return run % sweep->axes[axis].values_count;
+}
+
+static void sweep_apply(cortex2d_t* cortex, sweep_param_t param, int64_t value) {
+    switch (param) {
+        case SWEEP_PARAM_FIRE_THRESHOLD:
+            c2d_set_fire_threshold(cortex, (neuron_value_t) value);
+            break;
+        case SWEEP_PARAM_RECOVERY_VALUE:
+            cortex->recovery_value = (neuron_value_t) value;
+            break;
+        case SWEEP_PARAM_EXC_VALUE:
+            cortex->exc_value = (neuron_value_t) value;
+            break;
+        case SWEEP_PARAM_DECAY_VALUE:
+            cortex->decay_value = (neuron_value_t) value;
+            break;
+        case SWEEP_PARAM_SYNGEN_CHANCE:
+            cortex->syngen_chance = (chance_t) value;
+            break;
+        case SWEEP_PARAM_SYNSTR_CHANCE:
+            cortex->synstr_chance = (chance_t) value;
+            break;
+        case SWEEP_PARAM_MAX_TOT_STRENGTH:
+            cortex->max_tot_strength = (syn_strength_t) value;
+            break;
+        case SWEEP_PARAM_MAX_SYN_COUNT:
+            c2d_set_max_syn_count(cortex, (syn_count_t) value);
+            for (cortex_index_t i = 0; i < (cortex_index_t) cortex->width * cortex->height; i++) {
+                if (cortex->neurons[i].max_syn_count > 0) {
+                    cortex->neurons[i].max_syn_count = (syn_count_t) value;
+                }
+            }
+            break;
+        case SWEEP_PARAM_INHEXC_RATIO:
+            c2d_set_inhexc_ratio(cortex, (chance_t) value);
+            break;
+        case SWEEP_PARAM_EVOL_STEP:
+            c2d_set_evol_step(cortex, (evol_step_t) value);
+            break;
+        case SWEEP_PARAM_PULSE_WINDOW:
+            c2d_set_pulse_window(cortex, (spikes_count_t) value);
+            break;
+        case SWEEP_PARAM_RAND_SEED:
+            c2d_set_rand_mode(cortex, cortex->rand_mode, (rand_state_t) value);
+            break;
+        default:
+            break;
+    }
+}
+
+// Counts the neurons fired during the last tick of the given cortex.
+static uint64_t sweep_count_fired(cortex2d_t* cortex) {
+    uint64_t fired = 0;
+
+    #pragma omp parallel for reduction(+:fired)
+    for (cortex_index_t i = 0; i < (cortex_index_t) cortex->width * cortex->height; i++) {
+        fired += cortex->neurons[i].pulse_mask & 0x01U;
+    }
+
+    return fired;
+}
+
+static void sweep_perform(sweep2d_t* sweep, uint64_t run) {
+    sweep_result_t* result = &(sweep->results[run]);
+    cortex2d_t* base = sweep->cortex;
+
+    // Setup the cortices pair.
+    cortex2d_t* even_cortex = NULL;
+    cortex2d_t* odd_cortex = NULL;
+    result->error = c2d_init(&even_cortex, base->width, base->height, base->nh_radius);
+    if (result->error == ERROR_NONE) {
+        result->error = c2d_init(&odd_cortex, base->width, base->height, base->nh_radius);
+    }
+    if (result->error != ERROR_NONE) {
+        if (even_cortex != NULL) {
+            c2d_destroy(even_cortex);
+        }
+        return;
+    }
+
+    c2d_copy(even_cortex, base);
+    for (uint32_t axis = 0; axis < sweep->axes_count; axis++) {
+        sweep_apply(even_cortex, sweep->axes[axis].param, sweep->axes[axis].values[sweep_value_index(sweep, run, axis)]);
+    }
+    c2d_copy(odd_cortex, even_cortex);
+
+    // Each run gets its own input, pointing straight into the shared trace.
+    input2d_t input = *(sweep->input);
+    size_t frame_size = (size_t) (input.x1 - input.x0) * (size_t) (input.y1 - input.y0);
+
+    uint64_t fired = 0;
+    double start = sweep_seconds();
+
+    for (uint32_t i = 0; i < sweep->ticks_count; i++) {
+        cortex2d_t* prev_cortex = i % 2 ? odd_cortex : even_cortex;
+        cortex2d_t* next_cortex = i % 2 ? even_cortex : odd_cortex;
+
+        input.values = &(sweep->trace[((i / sweep->ticks_per_frame) % sweep->frames_count) * frame_size]);
+        c2d_feed2d(prev_cortex, &input);
+
+        c2d_tick(prev_cortex, next_cortex);
+
+        fired += sweep_count_fired(next_cortex);
+    }
+
+    result->seconds = sweep_seconds() - start;
+
+    // Collect final metrics.
+    cortex2d_t* last_cortex = sweep->ticks_count % 2 ? odd_cortex : even_cortex;
+    size_t neurons_count = (size_t) last_cortex->width * (size_t) last_cortex->height;
+    result->firing_rate = sweep->ticks_count > 0 ? (double) fired / ((double) neurons_count * (double) sweep->ticks_count) : 0.0;
+    result->syn_count = 0;
+    result->syn_strength = 0;
+    for (size_t i = 0; i < neurons_count; i++) {
+        result->syn_count += last_cortex->neurons[i].syn_count;
+        result->syn_strength += last_cortex->neurons[i].tot_syn_strength;
+    }
+
+    c2d_destroy(even_cortex);
+    c2d_destroy(odd_cortex);
+}
+
+// Pops a run from the worker's own queue, or steals one from the other workers. Returns FALSE once all queues are empty.
+static bool_t sweep_next_run(sweep2d_t* sweep, uint32_t worker, uint64_t* run) {
+    sweep_queue_t* own = &(sweep->queues[worker]);
+    pthread_mutex_lock(&(own->lock));
+    if (own->back > own->front) {
+        *run = own->runs[--own->back];
+        pthread_mutex_unlock(&(own->lock));
+        return TRUE;
+    }
+    pthread_mutex_unlock(&(own->lock));
+
+    // Steal from the front of the other queues, starting from the next worker so that thieves spread out.
+    for (uint32_t i = 1; i < sweep->workers_count; i++) {
+        sweep_queue_t* victim = &(sweep->queues[(worker + i) % sweep->workers_count]);
+        pthread_mutex_lock(&(victim->lock));
+        if (victim->back > victim->front) {
+            *run = victim->runs[victim->front++];
+            pthread_mutex_unlock(&(victim->lock));
+            return TRUE;
+        }
+        pthread_mutex_unlock(&(victim->lock));
+    }
+
+    return FALSE;
+}
+
+static void* sweep_worker_run(void* arg) {
+    sweep_worker_t* worker = (sweep_worker_t*) arg;
+
+    // Small runs share cores: every worker ticks its own runs on a single thread.
+    int max_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+
+    uint64_t run;
+    while (sweep_next_run(worker->sweep, worker->id, &run)) {
+        sweep_perform(worker->sweep, run);
+    }
+
+    omp_set_num_threads(max_threads);
+
+    return NULL;
+}
+
+error_code_t sweep_init(sweep2d_t** sweep,
+                        cortex2d_t* cortex,
+                        input2d_t* input,
+                        ticks_count_t* trace,
+                        uint32_t frames_count,
+                        uint32_t ticks_per_frame,
+                        uint32_t ticks_count) {
+    if (frames_count == 0 || ticks_per_frame == 0) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    (*sweep) = (sweep2d_t*) calloc(1, sizeof(sweep2d_t));
+    if ((*sweep) == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+
+    (*sweep)->cortex = cortex;
+    (*sweep)->input = input;
+    (*sweep)->frames_count = frames_count;
+    (*sweep)->ticks_per_frame = ticks_per_frame;
+    (*sweep)->ticks_count = ticks_count;
+    (*sweep)->parallel_neurons = SWEEP_DEFAULT_PARALLEL_NEURONS;
+
+    // Copy the trace.
+    size_t trace_size = (size_t) (input->x1 - input->x0) * (size_t) (input->y1 - input->y0) * frames_count;
+    (*sweep)->trace = (ticks_count_t*) malloc(trace_size * sizeof(ticks_count_t));
+    if ((*sweep)->trace == NULL) {
+        free(*sweep);
+        (*sweep) = NULL;
+        return ERROR_FAILED_ALLOC;
+    }
+    memcpy((*sweep)->trace, trace, trace_size * sizeof(ticks_count_t));
+
+    return ERROR_NONE;
+}
+
+error_code_t sweep_add_axis(sweep2d_t* sweep, sweep_param_t param, int64_t* values, uint32_t values_count) {
+    if (sweep->axes_count >= SWEEP_MAX_AXES || values_count == 0 || param >= SWEEP_PARAMS_COUNT) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    sweep_axis_t* axis = &(sweep->axes[sweep->axes_count]);
+    axis->values = (int64_t*) malloc(values_count * sizeof(int64_t));
+    if (axis->values == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+    memcpy(axis->values, values, values_count * sizeof(int64_t));
+    axis->param = param;
+    axis->values_count = values_count;
+    sweep->axes_count++;
+
+    return ERROR_NONE;
+}
+
+void sweep_set_parallel_neurons(sweep2d_t* sweep, size_t parallel_neurons) {
+    sweep->parallel_neurons = parallel_neurons;
+}
+
+uint64_t sweep_get_runs_count(sweep2d_t* sweep) {
+    uint64_t runs_count = 1;
+    for (uint32_t i = 0; i < sweep->axes_count; i++) {
+        runs_count *= sweep->axes[i].values_count;
+    }
+    return runs_count;
+}
+
+error_code_t sweep_run(sweep2d_t* sweep, uint32_t threads_count, char* file_name) {
+    // Open output file if possible.
+    FILE* out_file = fopen(file_name, "w");
+    if (out_file == NULL) {
+        printf("File does not exist: %s\n", file_name);
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+
+    if (threads_count == 0) {
+        threads_count = (uint32_t) omp_get_num_procs();
+    }
+
+    uint64_t runs_count = sweep_get_runs_count(sweep);
+    sweep->results = (sweep_result_t*) calloc(runs_count, sizeof(sweep_result_t));
+    if (sweep->results == NULL) {
+        fclose(out_file);
+        return ERROR_FAILED_ALLOC;
+    }
+
+    if ((size_t) sweep->cortex->width * (size_t) sweep->cortex->height >= sweep->parallel_neurons) {
+        // Large runs get intra-tick parallelism: they're performed one at a time, each using all threads.
+        // The caller's thread count is restored afterwards.
+        int max_threads = omp_get_max_threads();
+        omp_set_num_threads((int) threads_count);
+        for (uint64_t run = 0; run < runs_count; run++) {
+            sweep_perform(sweep, run);
+        }
+        omp_set_num_threads(max_threads);
+    } else {
+        // Small runs share cores: runs are dealt out to the workers in contiguous blocks, which are then balanced by stealing.
+        sweep->workers_count = threads_count < runs_count ? threads_count : (uint32_t) runs_count;
+        sweep->queues = (sweep_queue_t*) calloc(sweep->workers_count, sizeof(sweep_queue_t));
+        sweep_worker_t* workers = (sweep_worker_t*) calloc(sweep->workers_count, sizeof(sweep_worker_t));
+        if (sweep->queues == NULL || workers == NULL) {
+            free(sweep->queues);
+            sweep->queues = NULL;
+            free(workers);
+            free(sweep->results);
+            sweep->results = NULL;
+            fclose(out_file);
+            return ERROR_FAILED_ALLOC;
+        }
+
+        // A worker missing its queue would silently drop its share of runs, so the whole sweep fails instead.
+        bool_t queues_allocated = TRUE;
+        for (uint32_t i = 0; i < sweep->workers_count; i++) {
+            uint64_t first = runs_count * i / sweep->workers_count;
+            uint64_t last = runs_count * (i + 1) / sweep->workers_count;
+            sweep->queues[i].runs = (uint64_t*) malloc((last - first) * sizeof(uint64_t));
+            if (sweep->queues[i].runs == NULL) {
+                queues_allocated = FALSE;
+            }
+        }
+        if (!queues_allocated) {
+            for (uint32_t i = 0; i < sweep->workers_count; i++) {
+                free(sweep->queues[i].runs);
+            }
+            free(sweep->queues);
+            sweep->queues = NULL;
+            free(workers);
+            free(sweep->results);
+            sweep->results = NULL;
+            fclose(out_file);
+            return ERROR_FAILED_ALLOC;
+        }
+
+        for (uint32_t i = 0; i < sweep->workers_count; i++) {
+            sweep_queue_t* queue = &(sweep->queues[i]);
+            uint64_t first = runs_count * i / sweep->workers_count;
+            uint64_t last = runs_count * (i + 1) / sweep->workers_count;
+            for (uint64_t run = first; run < last; run++) {
+                // Reversed, so that the owner pops its runs in order.
+                queue->runs[last - 1 - run] = run;
+            }
+            queue->back = last - first;
+            pthread_mutex_init(&(queue->lock), NULL);
+        }
+
+        for (uint32_t i = 0; i < sweep->workers_count; i++) {
+            workers[i].sweep = sweep;
+            workers[i].id = i;
+            pthread_create(&(workers[i].thread), NULL, sweep_worker_run, &(workers[i]));
+        }
+        for (uint32_t i = 0; i < sweep->workers_count; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+
+        for (uint32_t i = 0; i < sweep->workers_count; i++) {
+            pthread_mutex_destroy(&(sweep->queues[i].lock));
+            free(sweep->queues[i].runs);
+        }
+        free(sweep->queues);
+        free(workers);
+        sweep->queues = NULL;
+    }
+
+    // Write results, in runs order.
+    fprintf(out_file, "run");
+    for (uint32_t axis = 0; axis < sweep->axes_count; axis++) {
+        fprintf(out_file, ",%s", sweep_param_names[sweep->axes[axis].param]);
+    }
+    fprintf(out_file, ",ticks,seconds,ticks_per_second,firing_rate,syn_count,syn_strength\n");
+
+    error_code_t error = ERROR_NONE;
+    for (uint64_t run = 0; run < runs_count; run++) {
+        sweep_result_t* result = &(sweep->results[run]);
+        if (result->error != ERROR_NONE) {
+            error = result->error;
+            continue;
+        }
+
+        fprintf(out_file, "%" PRIu64, run);
+        for (uint32_t axis = 0; axis < sweep->axes_count; axis++) {
+            fprintf(out_file, ",%" PRId64, sweep->axes[axis].values[sweep_value_index(sweep, run, axis)]);
+        }
+        fprintf(out_file,
+                ",%u,%.6f,%.1f,%.6f,%" PRIu64 ",%" PRIu64 "\n",
+                sweep->ticks_count,
+                result->seconds,
+                result->seconds > 0 ? sweep->ticks_count / result->seconds : 0.0,
+                result->firing_rate,
+                result->syn_count,
+                result->syn_strength);
+    }
+
+    free(sweep->results);
+    sweep->results = NULL;
+    fclose(out_file);
+
+    return error;
+}
+
+error_code_t sweep_destroy(sweep2d_t* sweep) {
+    for (uint32_t i = 0; i < sweep->axes_count; i++) {
+        free(sweep->axes[i].values);
+    }
+    free(sweep->trace);
+    free(sweep);
+
+    return ERROR_NONE;
+}
@@ -0,0 +1,96 @@
+/*
+*****************************************************************
+sweep.h
+
+Copyright (C) 2022 Luka Micheletti
+*****************************************************************
+*/
+
+#ifndef __BEHEMA_SWEEP__
+#define __BEHEMA_SWEEP__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "cortex.h"
+#include "error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Maximum number of swept parameters.
+#define SWEEP_MAX_AXES 0x10U
+
+/// Default number of neurons from which runs stop sharing cores and get the whole pool for their ticks instead.
+#define SWEEP_DEFAULT_PARALLEL_NEURONS 0x40000U
+
+typedef enum sweep_param_t {
+    SWEEP_PARAM_FIRE_THRESHOLD = 0x00,
+    SWEEP_PARAM_RECOVERY_VALUE = 0x01,
+    SWEEP_PARAM_EXC_VALUE = 0x02,
+    SWEEP_PARAM_DECAY_VALUE = 0x03,
+    SWEEP_PARAM_SYNGEN_CHANCE = 0x04,
+    SWEEP_PARAM_SYNSTR_CHANCE = 0x05,
+    SWEEP_PARAM_MAX_TOT_STRENGTH = 0x06,
+    // Applied to the cortex and to all of its neurons, except the ones disabled by c2d_syn_disable.
+    SWEEP_PARAM_MAX_SYN_COUNT = 0x07,
+    // Applied to all neurons.
+    SWEEP_PARAM_INHEXC_RATIO = 0x08,
+    SWEEP_PARAM_EVOL_STEP = 0x09,
+    SWEEP_PARAM_PULSE_WINDOW = 0x0A,
+    // Only meaningful with RAND_MODE_COUNTER: runs with different seeds are otherwise identical.
+    SWEEP_PARAM_RAND_SEED = 0x0B,
+    SWEEP_PARAMS_COUNT = 0x0C
+} sweep_param_t;
+
+/// Parameter sweep: runs a copy of a base cortex for every combination of the swept parameter values, all fed with the same input trace.
+/// Runs are spread over a pool of worker threads, each stealing runs from the others once out of work.
+typedef struct sweep2d_t sweep2d_t;
+
+/// Initializes a sweep with no swept parameters.
+/// @param sweep The sweep to initialize.
+/// @param cortex The base cortex: every run starts from a copy of it, with swept parameters applied on top. Must outlive the sweep.
+/// @param input The input fed to every run: its values are replaced by the current trace frame at every tick. Must outlive the sweep.
+/// @param trace The input frames, each holding one value per input neuron. Frames are played in a loop. Copied.
+/// @param frames_count The number of frames in the trace.
+/// @param ticks_per_frame The number of consecutive ticks each frame is fed for.
+/// @param ticks_count The number of ticks performed by each run.
+error_code_t sweep_init(sweep2d_t** sweep,
+                        cortex2d_t* cortex,
+                        input2d_t* input,
+                        ticks_count_t* trace,
+                        uint32_t frames_count,
+                        uint32_t ticks_per_frame,
+                        uint32_t ticks_count);
+
+/// Adds a swept parameter: runs are performed for all combinations of all axes' values.
+/// @param sweep The sweep to edit.
+/// @param param The parameter to sweep.
+/// @param values The values to assign the parameter. Copied.
+/// @param values_count The number of values.
+error_code_t sweep_add_axis(sweep2d_t* sweep, sweep_param_t param, int64_t* values, uint32_t values_count);
+
+/// Sets the number of neurons from which each run gets all threads for its ticks, instead of a single one.
+void sweep_set_parallel_neurons(sweep2d_t* sweep, size_t parallel_neurons);
+
+/// Returns the number of runs performed by the sweep, which is the product of all axes' values counts.
+uint64_t sweep_get_runs_count(sweep2d_t* sweep);
+
+/// Performs all runs and writes their metrics to the given CSV file, one line per run:
+/// run,<one column per axis>,ticks,seconds,ticks_per_second,firing_rate,syn_count,syn_strength
+/// where firing_rate is the mean number of spikes per neuron per tick, while syn_count and syn_strength are the final totals.
+/// @param sweep The sweep to run.
+/// @param threads_count The number of worker threads, one per available core if 0.
+/// @param file_name The results file, created if not already present, overwritten otherwise.
+/// @return ERROR_FAILED_ALLOC if the runs can't be set up, in which case none is performed, or the error of the last failed run.
+error_code_t sweep_run(sweep2d_t* sweep, uint32_t threads_count, char* file_name);
+
+/// Destroys the given sweep and frees memory. The base cortex and input are left untouched.
+error_code_t sweep_destroy(sweep2d_t* sweep);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
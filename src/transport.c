@@ -0,0 +1,260 @@
+// Must come before any include in order to bring in POSIX functions such as ftruncate() under -std=c17.
+#define _DEFAULT_SOURCE
+
+#include "transport.h"
+#include "cortex.h"
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+
+// Counters of a shared memory channel: a bounded byte ring with a single producer (the sender) and a single consumer (the receiver).
+// Each counter sits on its own cache line, since they're written by different processes.
+typedef struct shm_channel_t {
+    // Number of bytes sent through the channel.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t head;
+    // Number of bytes received from the channel.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t tail;
+} shm_channel_t;
+
+// Header of the shared memory object, followed by the counters of all channels and then by their data, channel_size bytes each.
+// The channel from rank i to rank j is the (i * ranks_count + j)-th one.
+typedef struct shm_header_t {
+    // Number of processes other than rank 0 attached so far.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t attached;
+    // Set by rank 0 once all processes are attached and the name is removed, so only ever found in objects no other process can open.
+    _Atomic uint32_t started;
+} shm_header_t;
+
+typedef struct shm_transport_t {
+    uint32_t rank;
+    uint32_t ranks_count;
+    size_t channel_size;
+
+    byte* mapping;
+    size_t mapping_size;
+    shm_channel_t* channels;
+    byte* data;
+} shm_transport_t;
+
+static error_code_t shm_transport_send(void* context, uint32_t rank, const void* data, size_t size) {
+    shm_transport_t* shm = (shm_transport_t*) context;
+    if (rank >= shm->ranks_count) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    uint32_t channel_index = shm->rank * shm->ranks_count + rank;
+    shm_channel_t* channel = &(shm->channels[channel_index]);
+    byte* ring = shm->data + (size_t) channel_index * shm->channel_size;
+    const byte* bytes = (const byte*) data;
+
+    // Messages bigger than the free space are sent in chunks, as the receiver frees it up.
+    uint64_t head = atomic_load_explicit(&(channel->head), memory_order_relaxed);
+    while (size > 0) {
+        uint64_t free_size = shm->channel_size - (head - atomic_load_explicit(&(channel->tail), memory_order_acquire));
+        if (free_size == 0) {
+            sched_yield();
+            continue;
+        }
+
+        // Only copy up to the end of the ring at once.
+        size_t offset = head % shm->channel_size;
+        size_t chunk = size < free_size ? size : free_size;
+        chunk = chunk < shm->channel_size - offset ? chunk : shm->channel_size - offset;
+        memcpy(ring + offset, bytes, chunk);
+
+        head += chunk;
+        bytes += chunk;
+        size -= chunk;
+        atomic_store_explicit(&(channel->head), head, memory_order_release);
+    }
+
+    return ERROR_NONE;
+}
+
+static error_code_t shm_transport_recv(void* context, uint32_t rank, void* data, size_t size) {
+    shm_transport_t* shm = (shm_transport_t*) context;
+    if (rank >= shm->ranks_count) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    uint32_t channel_index = rank * shm->ranks_count + shm->rank;
+    shm_channel_t* channel = &(shm->channels[channel_index]);
+    const byte* ring = shm->data + (size_t) channel_index * shm->channel_size;
+    byte* bytes = (byte*) data;
+
+    uint64_t tail = atomic_load_explicit(&(channel->tail), memory_order_relaxed);
+    while (size > 0) {
+        uint64_t available_size = atomic_load_explicit(&(channel->head), memory_order_acquire) - tail;
+        if (available_size == 0) {
+            sched_yield();
+            continue;
+        }
+
+        size_t offset = tail % shm->channel_size;
+        size_t chunk = size < available_size ? size : available_size;
+        chunk = chunk < shm->channel_size - offset ? chunk : shm->channel_size - offset;
+        memcpy(bytes, ring + offset, chunk);
+
+        tail += chunk;
+        bytes += chunk;
+        size -= chunk;
+        atomic_store_explicit(&(channel->tail), tail, memory_order_release);
+    }
+
+    return ERROR_NONE;
+}
+
+static void shm_transport_destroy(void* context) {
+    shm_transport_t* shm = (shm_transport_t*) context;
+    munmap(shm->mapping, shm->mapping_size);
+    free(shm);
+}
+
+// Returns the current time in milliseconds, from an arbitrary point in time.
+static inline uint64_t shm_millis() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
+
+// Returns whether the given name refers to a shared memory object other than the one open as file. A missing name doesn't.
+static bool_t shm_replaced(const char* name, int file) {
+    int linked_file = shm_open(name, O_RDONLY, 0);
+    if (linked_file < 0) {
+        return FALSE;
+    }
+
+    struct stat file_stat;
+    struct stat linked_stat;
+    bool_t replaced = fstat(file, &file_stat) == 0 &&
+                      fstat(linked_file, &linked_stat) == 0 &&
+                      (file_stat.st_dev != linked_stat.st_dev || file_stat.st_ino != linked_stat.st_ino);
+    close(linked_file);
+
+    return replaced;
+}
+
+// Creates the shared memory object as rank 0, replacing any object left with the same name by a crashed run, then waits for all other ranks
+// to attach before removing the name.
+static error_code_t shm_create(shm_transport_t* shm, const char* name, uint64_t deadline) {
+    shm_unlink(name);
+    int file = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (file < 0) {
+        return ERROR_TRANSPORT_FAILED;
+    }
+    if (ftruncate(file, (off_t) shm->mapping_size) != 0) {
+        close(file);
+        shm_unlink(name);
+        return ERROR_TRANSPORT_FAILED;
+    }
+    shm->mapping = (byte*) mmap(NULL, shm->mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (shm->mapping == MAP_FAILED) {
+        shm_unlink(name);
+        return ERROR_TRANSPORT_FAILED;
+    }
+
+    shm_header_t* header = (shm_header_t*) shm->mapping;
+    while (atomic_load_explicit(&(header->attached), memory_order_acquire) < shm->ranks_count - 1) {
+        if (shm_millis() > deadline) {
+            shm_unlink(name);
+            munmap(shm->mapping, shm->mapping_size);
+            return ERROR_TRANSPORT_FAILED;
+        }
+        sched_yield();
+    }
+
+    // The name is removed before starting, so that no object a process could still open is ever started.
+    shm_unlink(name);
+    atomic_store_explicit(&(header->started), 1, memory_order_release);
+
+    return ERROR_NONE;
+}
+
+// Attaches to the shared memory object created by rank 0, then waits for it to start.
+// Objects left by crashed runs may be open before rank 0 replaces them: they're dropped as soon as the name refers to another object.
+static error_code_t shm_attach(shm_transport_t* shm, const char* name, uint64_t deadline) {
+    for (;;) {
+        if (shm_millis() > deadline) {
+            return ERROR_TRANSPORT_FAILED;
+        }
+
+        // Rank 0 may not have created and sized the object yet.
+        int file = shm_open(name, O_RDWR, 0);
+        if (file < 0) {
+            usleep(1000);
+            continue;
+        }
+        struct stat file_stat;
+        if (fstat(file, &file_stat) != 0 || (size_t) file_stat.st_size != shm->mapping_size) {
+            close(file);
+            usleep(1000);
+            continue;
+        }
+        shm->mapping = (byte*) mmap(NULL, shm->mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (shm->mapping == MAP_FAILED) {
+            close(file);
+            return ERROR_TRANSPORT_FAILED;
+        }
+
+        shm_header_t* header = (shm_header_t*) shm->mapping;
+        atomic_fetch_add_explicit(&(header->attached), 1, memory_order_acq_rel);
+        for (uint32_t i = 0; atomic_load_explicit(&(header->started), memory_order_acquire) == 0; i++) {
+            // A name referring to another object means that this one was left by a crashed run and replaced by rank 0.
+            // A missing name doesn't, since rank 0 removes it right before starting.
+            bool_t replaced = i % 0x100U == 0 && shm_replaced(name, file);
+            if (replaced || shm_millis() > deadline) {
+                break;
+            }
+            sched_yield();
+        }
+        close(file);
+
+        if (atomic_load_explicit(&(header->started), memory_order_acquire) != 0) {
+            return ERROR_NONE;
+        }
+        munmap(shm->mapping, shm->mapping_size);
+    }
+}
+
+error_code_t shm_transport_init(halo_transport_t* transport, const char* name, uint32_t rank, uint32_t ranks_count, size_t channel_size) {
+    if (rank >= ranks_count) {
+        return ERROR_SIZE_MISMATCH;
+    }
+
+    shm_transport_t* shm = (shm_transport_t*) calloc(1, sizeof(shm_transport_t));
+    if (shm == NULL) {
+        return ERROR_FAILED_ALLOC;
+    }
+    shm->rank = rank;
+    shm->ranks_count = ranks_count;
+    shm->channel_size = channel_size > 0 ? channel_size : SHM_DEFAULT_CHANNEL_SIZE;
+
+    size_t channels_count = (size_t) ranks_count * (size_t) ranks_count;
+    size_t counters_size = sizeof(shm_header_t) + channels_count * sizeof(shm_channel_t);
+    shm->mapping_size = counters_size + channels_count * shm->channel_size;
+
+    // Rank 0 creates the object, zero filled, while the others attach to it. Once all of them have, rank 0 removes the name:
+    // the object lives on until all of them unmap it.
+    uint64_t deadline = shm_millis() + SHM_ATTACH_TIMEOUT_MS;
+    error_code_t error = rank == 0 ? shm_create(shm, name, deadline) : shm_attach(shm, name, deadline);
+    if (error != ERROR_NONE) {
+        free(shm);
+        return error;
+    }
+    shm->channels = (shm_channel_t*) (shm->mapping + sizeof(shm_header_t));
+    shm->data = shm->mapping + counters_size;
+
+    transport->context = shm;
+    transport->channel_size = shm->channel_size;
+    transport->send = shm_transport_send;
+    transport->recv = shm_transport_recv;
+    transport->destroy = shm_transport_destroy;
+
+    return ERROR_NONE;
+}
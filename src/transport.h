@@ -0,0 +1,62 @@
+/*
+*****************************************************************
+transport.h
+
+Copyright (C) 2022 Luka Micheletti
+*****************************************************************
+*/
+
+#ifndef __BEHEMA_TRANSPORT__
+#define __BEHEMA_TRANSPORT__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Default number of bytes each shared memory channel can hold.
+#define SHM_DEFAULT_CHANNEL_SIZE 0x100000U
+
+/// Number of milliseconds shm_transport_init waits for all processes to attach before giving up.
+#define SHM_ATTACH_TIMEOUT_MS 30000U
+
+/// Point-to-point transport between a fixed set of ranks (e.g. processes), used to exchange halos between subdomains.
+/// Every pair of ranks is connected by a one-way channel in each direction, and messages through a channel are received in the order they were sent.
+/// Any backend (shared memory, MPI, sockets) can be plugged in by filling in the functions below.
+typedef struct halo_transport_t {
+    // Backend state, passed to every function.
+    void* context;
+
+    // Number of bytes that can be sent to a rank before it receives any of them: sends only block once a channel is full.
+    size_t channel_size;
+
+    // Sends size bytes to the given rank. Data can be reused as soon as the call returns, whether the rank received it or not.
+    error_code_t (*send)(void* context, uint32_t rank, const void* data, size_t size);
+
+    // Receives size bytes from the given rank, waiting for them to be sent if needed.
+    error_code_t (*recv)(void* context, uint32_t rank, void* data, size_t size);
+
+    // Releases the backend state.
+    void (*destroy)(void* context);
+} halo_transport_t;
+
+/// Initializes a transport between processes on the same machine, through a POSIX shared memory object.
+/// All ranks_count processes must call this with the same name and channel size, each with its own rank: the call returns once all of them have.
+/// Rank 0 creates the shared memory object, replacing any object left with the same name by a crashed run, and unlinks it as soon as all
+/// processes are attached, so nothing is left behind once running.
+/// @param transport The transport to initialize.
+/// @param name The name of the shared memory object, as accepted by shm_open (e.g. "/behema").
+/// @param rank The rank of the calling process, in range 0..(ranks_count - 1).
+/// @param ranks_count The number of processes.
+/// @param channel_size The number of bytes each channel can hold, SHM_DEFAULT_CHANNEL_SIZE if 0.
+/// @return ERROR_TRANSPORT_FAILED if the object can't be created or attached to, or if not all processes attach within SHM_ATTACH_TIMEOUT_MS.
+error_code_t shm_transport_init(halo_transport_t* transport, const char* name, uint32_t rank, uint32_t ranks_count, size_t channel_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,76 +1,179 @@
+// Must come before any include in order to bring in POSIX functions such as madvise() under -std=c17.
+#define _DEFAULT_SOURCE
+
 #include "utils.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Skips any whitespace and comment lines starting at the given cursor.
+// In a PGM image commented lines start with '#'.
+static const char* pgm_skip(const char* cursor, const char* end) {
+    while (cursor < end) {
+        if (*cursor == '#') {
+            // Ignore the comment up to the end of the line.
+            while (cursor < end && *cursor != '\n') {
+                cursor++;
+            }
+        } else if (isspace((unsigned char) *cursor)) {
+            cursor++;
+        } else {
+            break;
+        }
+    }
+    return cursor;
+}
 
-void ignoreComments(FILE* fp) {
-    int ch;
-    char line[100];
- 
-    // Ignore any blank lines
-    while ((ch = fgetc(fp)) != EOF && isspace(ch)) {}
- 
-    // Recursively ignore comments.
-    // In a PGM image commented lines start with '#'.
-    if (ch == '#') {
-        fgets(line, sizeof(line), fp);
-        ignoreComments(fp);
-    } else {
-        fseek(fp, -1, SEEK_CUR);
+// Parses an unsigned decimal value at the given cursor, skipping any leading whitespace and comments.
+// Returns NULL if no value is found.
+static const char* pgm_parse_uint(const char* cursor, const char* end, uint32_t* value) {
+    cursor = pgm_skip(cursor, end);
+    if (cursor >= end || *cursor < '0' || *cursor > '9') {
+        return NULL;
+    }
+
+    uint32_t result = 0;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        result = result * 10 + (uint32_t) (*cursor - '0');
+        cursor++;
     }
+
+    *value = result;
+    return cursor;
 }
 
 error_code_t pgm_read(pgm_content_t* pgm, const char* filename) {
+    pgm->data = NULL;
+    pgm->mapping = NULL;
+    pgm->mapping_size = 0;
+
     // Open the image file in read mode.
-    FILE* pgmfile = fopen(filename, "r");
+    int pgmfile = open(filename, O_RDONLY);
  
     // If file does not exist, then return.
-    if (pgmfile == NULL) {
+    if (pgmfile < 0) {
         printf("File does not exist: %s\n", filename);
         return ERROR_FILE_DOES_NOT_EXIST;
     }
- 
-    ignoreComments(pgmfile);
+
+    struct stat file_stat;
+    if (fstat(pgmfile, &file_stat) < 0 || file_stat.st_size <= 0) {
+        close(pgmfile);
+        return ERROR_FILE_WRONG_FORMAT;
+    }
+
+    // Map the whole file: raw data is then used in place, without any copy.
+    size_t file_size = (size_t) file_stat.st_size;
+    void* mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, pgmfile, 0);
+    close(pgmfile);
+    if (mapping == MAP_FAILED) {
+        return ERROR_FAILED_ALLOC;
+    }
+    madvise(mapping, file_size, MADV_SEQUENTIAL);
+
+    const char* cursor = (const char*) mapping;
+    const char* end = cursor + file_size;
 
     // Read file type.
-    fscanf(pgmfile, "%s", pgm->pgmType);
- 
-    ignoreComments(pgmfile);
- 
-    // Read data size.
-    fscanf(pgmfile, "%u %u", &(pgm->width), &(pgm->height));
+    cursor = pgm_skip(cursor, end);
+    if (end - cursor < 2 || cursor[0] != 'P' || (cursor[1] != '2' && cursor[1] != '5')) {
+        printf("Wrong file type: %s\n", filename);
+        munmap(mapping, file_size);
+        return ERROR_FILE_WRONG_FORMAT;
+    }
+    pgm->pgmType[0] = cursor[0];
+    pgm->pgmType[1] = cursor[1];
+    pgm->pgmType[2] = '\0';
+    cursor += 2;
+
+    // Read data size and maximum value.
+    if ((cursor = pgm_parse_uint(cursor, end, &(pgm->width))) == NULL ||
+        (cursor = pgm_parse_uint(cursor, end, &(pgm->height))) == NULL ||
+        (cursor = pgm_parse_uint(cursor, end, &(pgm->max_value))) == NULL ||
+        pgm->width == 0 || pgm->height == 0 ||
+        pgm->max_value == 0 || pgm->max_value > 0xFFFFU) {
+        printf("Malformed pgm header: %s\n", filename);
+        munmap(mapping, file_size);
+        return ERROR_FILE_WRONG_FORMAT;
+    }
 
-    ignoreComments(pgmfile);
- 
-    // Read maximum value.
-    fscanf(pgmfile, "%u", &(pgm->max_value));
+    pgm->sample_size = pgm->max_value < 0x100U ? 1 : 2;
+    size_t samples_count = (size_t) pgm->width * (size_t) pgm->height;
+    size_t data_size = samples_count * pgm->sample_size;
+
+    if (pgm->pgmType[1] == '5') {
+        // Raw data: a single whitespace character separates the header from the samples.
+        cursor++;
+        if (cursor > end || (size_t) (end - cursor) < data_size) {
+            printf("Truncated pgm data: %s\n", filename);
+            munmap(mapping, file_size);
+            return ERROR_FILE_SIZE_WRONG;
+        }
 
-    ignoreComments(pgmfile);
- 
-    // Allocate memory to store data in the struct.
-    pgm->data = (uint8_t*) malloc(pgm->width * pgm->height * sizeof(uint8_t));
+        pgm->data = (uint8_t*) cursor;
+        pgm->mapping = mapping;
+        pgm->mapping_size = file_size;
+    } else {
+        // Plain data: decoded into an owned buffer using the raw data layout.
+        pgm->data = (uint8_t*) malloc(data_size);
+        if (pgm->data == NULL) {
+            munmap(mapping, file_size);
+            return ERROR_FAILED_ALLOC;
+        }
 
- 
-    // Store data in the struct.
-    if (!strcmp(pgm->pgmType, "P2")) {
-        // Plain data.
-        for (uint32_t y = 0; y < pgm->height; y++) {
-            for (uint32_t x = 0; x < pgm->width; x++) {
-                fscanf(pgmfile, "%hhu", &(pgm->data[IDX2D(x, y, pgm->width)]));
+        for (size_t i = 0; i < samples_count; i++) {
+            // Skip separators.
+            while (cursor < end && (*cursor < '0' || *cursor > '9')) {
+                if (*cursor == '#') {
+                    cursor = pgm_skip(cursor, end);
+                } else {
+                    cursor++;
+                }
+            }
+            if (cursor >= end) {
+                printf("Truncated pgm data: %s\n", filename);
+                free(pgm->data);
+                pgm->data = NULL;
+                munmap(mapping, file_size);
+                return ERROR_FILE_SIZE_WRONG;
+            }
+
+            uint32_t sample = 0;
+            while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+                sample = sample * 10 + (uint32_t) (*cursor - '0');
+                cursor++;
+            }
+            if (sample > pgm->max_value) {
+                sample = pgm->max_value;
+            }
+
+            if (pgm->sample_size == 1) {
+                pgm->data[i] = (uint8_t) sample;
+            } else {
+                pgm->data[2 * i] = (uint8_t) (sample >> 8);
+                pgm->data[2 * i + 1] = (uint8_t) sample;
             }
         }
-    } else if (!strcmp(pgm->pgmType, "P5")) {
-        // Raw data.
-        fread(pgm->data, sizeof(uint8_t), pgm->width * pgm->height, pgmfile);
-    } else {
-        // Wrong file type.
-        printf("Wrong file type!\n");
-        exit(EXIT_FAILURE);
+
+        munmap(mapping, file_size);
     }
  
-    // Close the file
-    fclose(pgmfile);
- 
     return ERROR_NONE;
 }
 
+void pgm_destroy(pgm_content_t* pgm) {
+    if (pgm->mapping != NULL) {
+        munmap(pgm->mapping, pgm->mapping_size);
+    } else {
+        free(pgm->data);
+    }
+
+    pgm->data = NULL;
+    pgm->mapping = NULL;
+    pgm->mapping_size = 0;
+}
+
 uint32_t map(uint32_t input, uint32_t input_start, uint32_t input_end, uint32_t output_start, uint32_t output_end) {
     uint32_t slope = (output_end - output_start) / (input_end - input_start);
     return output_start + slope * (input - input_start);
@@ -104,6 +207,8 @@ uint64_t nanos() {
 
 
 void c2d_to_file(cortex2d_t* cortex, char* file_name) {
+    uint64_t prof_start = prof_span_begin();
+
     // Open output file if possible.
     FILE* out_file = fopen(file_name, "wb");
     if (out_file == NULL) {
@@ -118,9 +223,11 @@ void c2d_to_file(cortex2d_t* cortex, char* file_name) {
     fwrite(&(cortex->ticks_count), sizeof(ticks_count_t), 1, out_file);
     fwrite(&(cortex->evols_count), sizeof(ticks_count_t), 1, out_file);
     fwrite(&(cortex->evol_step), sizeof(ticks_count_t), 1, out_file);
+    fwrite(&(cortex->evol_mode), sizeof(evol_mode_t), 1, out_file);
     fwrite(&(cortex->pulse_window), sizeof(spikes_count_t), 1, out_file);
 
     fwrite(&(cortex->nh_radius), sizeof(nh_radius_t), 1, out_file);
+    fwrite(&(cortex->wrapped), sizeof(bool_t), 1, out_file);
     fwrite(&(cortex->fire_threshold), sizeof(neuron_value_t), 1, out_file);
     fwrite(&(cortex->recovery_value), sizeof(neuron_value_t), 1, out_file);
     fwrite(&(cortex->exc_value), sizeof(neuron_value_t), 1, out_file);
@@ -135,54 +242,245 @@ void c2d_to_file(cortex2d_t* cortex, char* file_name) {
 
     fwrite(&(cortex->sample_window), sizeof(ticks_count_t), 1, out_file);
     fwrite(&(cortex->pulse_mapping), sizeof(pulse_mapping_t), 1, out_file);
+    fwrite(&(cortex->rand_mode), sizeof(rand_mode_t), 1, out_file);
+    fwrite(&(cortex->rand_seed), sizeof(rand_state_t), 1, out_file);
+    fwrite(&(cortex->rand_ticks_count), sizeof(uint64_t), 1, out_file);
+    fwrite(&(cortex->neurons_order), sizeof(neurons_order_t), 1, out_file);
 
-    // Write all neurons.
+    // Write all neurons, in row-major order whatever their order in memory.
     for (cortex_size_t y = 0; y < cortex->height; y++) {
         for (cortex_size_t x = 0; x < cortex->width; x++) {
-            fwrite(&(cortex->neurons[IDX2D(x, y, cortex->width)]), sizeof(neuron_t), 1, out_file);
+            fwrite(&(cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)]), sizeof(neuron_t), 1, out_file);
+        }
+    }
+
+    // Write all wide synapses, if any.
+    if (cortex->wide_synapses != NULL) {
+        for (cortex_size_t y = 0; y < cortex->height; y++) {
+            for (cortex_size_t x = 0; x < cortex->width; x++) {
+                fwrite(&(cortex->wide_synapses[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)]), sizeof(wide_synapses_t), 1, out_file);
+            }
         }
     }
 
     fclose(out_file);
+
+    prof_span_end(PROF_PHASE_CHECKPOINT, prof_start);
 }
 
-void c2d_from_file(cortex2d_t* cortex, char* file_name) {
+error_code_t c2d_from_file(cortex2d_t** cortex, char* file_name) {
+    // Open input file if possible.
+    FILE* in_file = fopen(file_name, "rb");
+    if (in_file == NULL) {
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+
+    // Read cortex metadata from the input file first, so that the cortex can be allocated with the right size.
+    cortex2d_t properties;
+    if (fread(&(properties.width), sizeof(cortex_size_t), 1, in_file) != 1 ||
+        fread(&(properties.height), sizeof(cortex_size_t), 1, in_file) != 1 ||
+        fread(&(properties.ticks_count), sizeof(ticks_count_t), 1, in_file) != 1 ||
+        fread(&(properties.evols_count), sizeof(ticks_count_t), 1, in_file) != 1 ||
+        fread(&(properties.evol_step), sizeof(ticks_count_t), 1, in_file) != 1 ||
+        fread(&(properties.evol_mode), sizeof(evol_mode_t), 1, in_file) != 1 ||
+        fread(&(properties.pulse_window), sizeof(spikes_count_t), 1, in_file) != 1 ||
+
+        fread(&(properties.nh_radius), sizeof(nh_radius_t), 1, in_file) != 1 ||
+        fread(&(properties.wrapped), sizeof(bool_t), 1, in_file) != 1 ||
+        fread(&(properties.fire_threshold), sizeof(neuron_value_t), 1, in_file) != 1 ||
+        fread(&(properties.recovery_value), sizeof(neuron_value_t), 1, in_file) != 1 ||
+        fread(&(properties.exc_value), sizeof(neuron_value_t), 1, in_file) != 1 ||
+        fread(&(properties.decay_value), sizeof(neuron_value_t), 1, in_file) != 1 ||
+
+        fread(&(properties.syngen_chance), sizeof(chance_t), 1, in_file) != 1 ||
+        fread(&(properties.synstr_chance), sizeof(chance_t), 1, in_file) != 1 ||
+
+        fread(&(properties.max_tot_strength), sizeof(syn_strength_t), 1, in_file) != 1 ||
+        fread(&(properties.max_syn_count), sizeof(syn_count_t), 1, in_file) != 1 ||
+        fread(&(properties.inhexc_range), sizeof(chance_t), 1, in_file) != 1 ||
+
+        fread(&(properties.sample_window), sizeof(ticks_count_t), 1, in_file) != 1 ||
+        fread(&(properties.pulse_mapping), sizeof(pulse_mapping_t), 1, in_file) != 1 ||
+        fread(&(properties.rand_mode), sizeof(rand_mode_t), 1, in_file) != 1 ||
+        fread(&(properties.rand_seed), sizeof(rand_state_t), 1, in_file) != 1 ||
+        fread(&(properties.rand_ticks_count), sizeof(uint64_t), 1, in_file) != 1 ||
+        fread(&(properties.neurons_order), sizeof(neurons_order_t), 1, in_file) != 1) {
+        fclose(in_file);
+        return ERROR_FILE_SIZE_WRONG;
+    }
+    if (properties.width <= 0 || properties.height <= 0 || properties.nh_radius < 0) {
+        fclose(in_file);
+        return ERROR_FILE_WRONG_FORMAT;
+    }
+
+    // Neurons and wide synapses are allocated the same way as any other cortex', so that c2d_destroy frees them.
+    error_code_t error = c2d_init(cortex, properties.width, properties.height, properties.nh_radius);
+    if (error != ERROR_NONE) {
+        fclose(in_file);
+        return error;
+    }
+
+    // Copy all properties but the arrays, which are the ones just allocated.
+    neuron_t* neurons = (*cortex)->neurons;
+    wide_synapses_t* wide_synapses = (*cortex)->wide_synapses;
+    **cortex = properties;
+    (*cortex)->neurons = neurons;
+    (*cortex)->wide_synapses = wide_synapses;
+    (*cortex)->wrapped = FALSE;
+    (*cortex)->ghosts = NULL;
+
+    // Read all neurons.
+    bool_t complete = TRUE;
+    for (cortex_size_t y = 0; complete && y < properties.height; y++) {
+        for (cortex_size_t x = 0; complete && x < properties.width; x++) {
+            complete = fread(&(neurons[ORDER_IDX2D(x, y, properties.width, properties.neurons_order)]), sizeof(neuron_t), 1, in_file) == 1;
+        }
+    }
+
+    // Read all wide synapses, if the neighborhood needs them.
+    for (cortex_size_t y = 0; complete && wide_synapses != NULL && y < properties.height; y++) {
+        for (cortex_size_t x = 0; complete && x < properties.width; x++) {
+            complete = fread(&(wide_synapses[ORDER_IDX2D(x, y, properties.width, properties.neurons_order)]), sizeof(wide_synapses_t), 1, in_file) == 1;
+        }
+    }
+    fclose(in_file);
+
+    // Wrapped cortices get their ghost border.
+    error = complete ? c2d_set_wrapped(*cortex, properties.wrapped) : ERROR_FILE_SIZE_WRONG;
+    if (error != ERROR_NONE) {
+        c2d_destroy(*cortex);
+        (*cortex) = NULL;
+        return error;
+    }
+
+    return ERROR_NONE;
+}
+
+void c3d_to_file(cortex3d_t* cortex, char* file_name) {
+    uint64_t prof_start = prof_span_begin();
+
     // Open output file if possible.
+    FILE* out_file = fopen(file_name, "wb");
+    if (out_file == NULL) {
+        printf("File does not exist: %s\n", file_name);
+        return;
+    }
+
+    // Write cortex metadata to the output file.
+    fwrite(&(cortex->width), sizeof(cortex_size_t), 1, out_file);
+    fwrite(&(cortex->height), sizeof(cortex_size_t), 1, out_file);
+    fwrite(&(cortex->depth), sizeof(cortex_size_t), 1, out_file);
+    fwrite(&(cortex->ticks_count), sizeof(ticks_count_t), 1, out_file);
+    fwrite(&(cortex->evols_count), sizeof(ticks_count_t), 1, out_file);
+    fwrite(&(cortex->evol_step), sizeof(ticks_count_t), 1, out_file);
+    fwrite(&(cortex->pulse_window), sizeof(spikes_count_t), 1, out_file);
+
+    fwrite(&(cortex->nh_radius), sizeof(nh_radius_t), 1, out_file);
+    fwrite(&(cortex->fire_threshold), sizeof(neuron_value_t), 1, out_file);
+    fwrite(&(cortex->recovery_value), sizeof(neuron_value_t), 1, out_file);
+    fwrite(&(cortex->exc_value), sizeof(neuron_value_t), 1, out_file);
+    fwrite(&(cortex->decay_value), sizeof(neuron_value_t), 1, out_file);
+
+    fwrite(&(cortex->syngen_chance), sizeof(chance_t), 1, out_file);
+    fwrite(&(cortex->synstr_chance), sizeof(chance_t), 1, out_file);
+
+    fwrite(&(cortex->max_tot_strength), sizeof(syn_strength_t), 1, out_file);
+    fwrite(&(cortex->max_syn_count), sizeof(syn_count_t), 1, out_file);
+    fwrite(&(cortex->inhexc_range), sizeof(chance_t), 1, out_file);
+
+    fwrite(&(cortex->sample_window), sizeof(ticks_count_t), 1, out_file);
+    fwrite(&(cortex->pulse_mapping), sizeof(pulse_mapping_t), 1, out_file);
+    fwrite(&(cortex->rand_mode), sizeof(rand_mode_t), 1, out_file);
+    fwrite(&(cortex->rand_seed), sizeof(rand_state_t), 1, out_file);
+    fwrite(&(cortex->rand_ticks_count), sizeof(uint64_t), 1, out_file);
+
+    // Write all neurons in plain (x, y, z) order, so that files don't depend on the bricks layout.
+    for (cortex_size_t z = 0; z < cortex->depth; z++) {
+        for (cortex_size_t y = 0; y < cortex->height; y++) {
+            for (cortex_size_t x = 0; x < cortex->width; x++) {
+                fwrite(c3d_neuron(cortex, x, y, z), sizeof(neuron_t), 1, out_file);
+            }
+        }
+    }
+
+    fclose(out_file);
+
+    prof_span_end(PROF_PHASE_CHECKPOINT, prof_start);
+}
+
+error_code_t c3d_from_file(cortex3d_t** cortex, char* file_name) {
+    // Open input file if possible.
     FILE* in_file = fopen(file_name, "rb");
+    if (in_file == NULL) {
+        return ERROR_FILE_DOES_NOT_EXIST;
+    }
+
+    // Read the sizes first, so that the cortex can be allocated with the right bricks count.
+    cortex_size_t width;
+    cortex_size_t height;
+    cortex_size_t depth;
+    ticks_count_t ticks_count;
+    ticks_count_t evols_count;
+    ticks_count_t evol_step;
+    spikes_count_t pulse_window;
+    nh_radius_t nh_radius;
+    if (fread(&width, sizeof(cortex_size_t), 1, in_file) != 1 ||
+        fread(&height, sizeof(cortex_size_t), 1, in_file) != 1 ||
+        fread(&depth, sizeof(cortex_size_t), 1, in_file) != 1 ||
+        fread(&ticks_count, sizeof(ticks_count_t), 1, in_file) != 1 ||
+        fread(&evols_count, sizeof(ticks_count_t), 1, in_file) != 1 ||
+        fread(&evol_step, sizeof(ticks_count_t), 1, in_file) != 1 ||
+        fread(&pulse_window, sizeof(spikes_count_t), 1, in_file) != 1 ||
+        fread(&nh_radius, sizeof(nh_radius_t), 1, in_file) != 1) {
+        fclose(in_file);
+        return ERROR_FILE_SIZE_WRONG;
+    }
+
+    error_code_t error = c3d_init(cortex, width, height, depth, nh_radius);
+    if (error != ERROR_NONE) {
+        fclose(in_file);
+        return error;
+    }
 
-    // Read cortex metadata from the output file.
-    fread(&(cortex->width), sizeof(cortex_size_t), 1, in_file);
-    fread(&(cortex->height), sizeof(cortex_size_t), 1, in_file);
-    fread(&(cortex->ticks_count), sizeof(ticks_count_t), 1, in_file);
-    fread(&(cortex->evols_count), sizeof(ticks_count_t), 1, in_file);
-    fread(&(cortex->evol_step), sizeof(ticks_count_t), 1, in_file);
-    fread(&(cortex->pulse_window), sizeof(spikes_count_t), 1, in_file);
+    (*cortex)->ticks_count = ticks_count;
+    (*cortex)->evols_count = evols_count;
+    (*cortex)->evol_step = evol_step;
+    (*cortex)->pulse_window = pulse_window;
 
-    fread(&(cortex->nh_radius), sizeof(nh_radius_t), 1, in_file);
-    fread(&(cortex->fire_threshold), sizeof(neuron_value_t), 1, in_file);
-    fread(&(cortex->recovery_value), sizeof(neuron_value_t), 1, in_file);
-    fread(&(cortex->exc_value), sizeof(neuron_value_t), 1, in_file);
-    fread(&(cortex->decay_value), sizeof(neuron_value_t), 1, in_file);
+    // Read cortex metadata from the input file.
+    fread(&((*cortex)->fire_threshold), sizeof(neuron_value_t), 1, in_file);
+    fread(&((*cortex)->recovery_value), sizeof(neuron_value_t), 1, in_file);
+    fread(&((*cortex)->exc_value), sizeof(neuron_value_t), 1, in_file);
+    fread(&((*cortex)->decay_value), sizeof(neuron_value_t), 1, in_file);
 
-    fread(&(cortex->syngen_chance), sizeof(chance_t), 1, in_file);
-    fread(&(cortex->synstr_chance), sizeof(chance_t), 1, in_file);
+    fread(&((*cortex)->syngen_chance), sizeof(chance_t), 1, in_file);
+    fread(&((*cortex)->synstr_chance), sizeof(chance_t), 1, in_file);
 
-    fread(&(cortex->max_tot_strength), sizeof(syn_strength_t), 1, in_file);
-    fread(&(cortex->max_syn_count), sizeof(syn_count_t), 1, in_file);
-    fread(&(cortex->inhexc_range), sizeof(chance_t), 1, in_file);
+    fread(&((*cortex)->max_tot_strength), sizeof(syn_strength_t), 1, in_file);
+    fread(&((*cortex)->max_syn_count), sizeof(syn_count_t), 1, in_file);
+    fread(&((*cortex)->inhexc_range), sizeof(chance_t), 1, in_file);
 
-    fread(&(cortex->sample_window), sizeof(ticks_count_t), 1, in_file);
-    fread(&(cortex->pulse_mapping), sizeof(pulse_mapping_t), 1, in_file);
+    fread(&((*cortex)->sample_window), sizeof(ticks_count_t), 1, in_file);
+    fread(&((*cortex)->pulse_mapping), sizeof(pulse_mapping_t), 1, in_file);
+    fread(&((*cortex)->rand_mode), sizeof(rand_mode_t), 1, in_file);
+    fread(&((*cortex)->rand_seed), sizeof(rand_state_t), 1, in_file);
+    fread(&((*cortex)->rand_ticks_count), sizeof(uint64_t), 1, in_file);
 
     // Read all neurons.
-    cortex->neurons = (neuron_t*) malloc(cortex->width * cortex->height * sizeof(neuron_t));
-    for (cortex_size_t y = 0; y < cortex->height; y++) {
-        for (cortex_size_t x = 0; x < cortex->width; x++) {
-            fread(&(cortex->neurons[IDX2D(x, y, cortex->width)]), sizeof(neuron_t), 1, in_file);
+    for (cortex_size_t z = 0; z < depth; z++) {
+        for (cortex_size_t y = 0; y < height; y++) {
+            for (cortex_size_t x = 0; x < width; x++) {
+                if (fread(c3d_neuron(*cortex, x, y, z), sizeof(neuron_t), 1, in_file) != 1) {
+                    fclose(in_file);
+                    return ERROR_FILE_SIZE_WRONG;
+                }
+            }
         }
     }
 
     fclose(in_file);
+
+    return ERROR_NONE;
 }
 
 error_code_t c2d_touch_from_map(cortex2d_t* cortex, char* map_file_name) {
@@ -195,15 +493,23 @@ error_code_t c2d_touch_from_map(cortex2d_t* cortex, char* map_file_name) {
     }
 
     // Make sure sizes are correct.
-    if (cortex->width == pgm_content.width && cortex->height == pgm_content.height) {
-        for (cortex_size_t i = 0; i < cortex->width * cortex->height; i++) {
-            cortex->neurons[i].max_syn_count = fmap(pgm_content.data[i], 0, pgm_content.max_value, 0, cortex->max_syn_count);
-        }
-    } else {
+    if (cortex->width != (cortex_size_t) pgm_content.width || cortex->height != (cortex_size_t) pgm_content.height) {
         printf("\nc2d_touch_from_map file sizes do not match with cortex\n");
+        pgm_destroy(&pgm_content);
         return ERROR_FILE_SIZE_WRONG;
     }
 
+    // Integer-only equivalent of fmap(sample, 0, max_value, 0, max_syn_count).
+    uint64_t range = cortex->max_syn_count;
+    uint64_t max_value = pgm_content.max_value;
+
+    #pragma omp parallel for
+    for (cortex_index_t i = 0; i < (cortex_index_t) cortex->width * cortex->height; i++) {
+        cortex->neurons[ORDER_IDX1D(i, cortex->width, cortex->neurons_order)].max_syn_count = (syn_count_t) ((pgm_sample(&pgm_content, i) * range) / max_value);
+    }
+
+    pgm_destroy(&pgm_content);
+
     return ERROR_NONE;
 }
 
@@ -217,14 +523,189 @@ error_code_t c2d_inhexc_from_map(cortex2d_t* cortex, char* map_file_name) {
     }
 
     // Make sure sizes are correct.
-    if (cortex->width == pgm_content.width && cortex->height == pgm_content.height) {
-        for (cortex_size_t i = 0; i < cortex->width * cortex->height; i++) {
-            cortex->neurons[i].inhexc_ratio = fmap(pgm_content.data[i], 0, pgm_content.max_value, 0, cortex->inhexc_range);
-        }
-    } else {
+    if (cortex->width != (cortex_size_t) pgm_content.width || cortex->height != (cortex_size_t) pgm_content.height) {
         printf("\nc2d_inhexc_from_map file sizes do not match with cortex\n");
+        pgm_destroy(&pgm_content);
         return ERROR_FILE_SIZE_WRONG;
     }
 
+    // Integer-only equivalent of fmap(sample, 0, max_value, 0, inhexc_range).
+    uint64_t range = cortex->inhexc_range;
+    uint64_t max_value = pgm_content.max_value;
+
+    #pragma omp parallel for
+    for (cortex_index_t i = 0; i < (cortex_index_t) cortex->width * cortex->height; i++) {
+        cortex->neurons[ORDER_IDX1D(i, cortex->width, cortex->neurons_order)].inhexc_ratio = (inhexc_ratio_t) ((pgm_sample(&pgm_content, i) * range) / max_value);
+    }
+
+    pgm_destroy(&pgm_content);
+
     return ERROR_NONE;
-}
\ No newline at end of file
+}
+
+error_code_t c2d_touch_from_fn(cortex2d_t* cortex, map_fn_t map_fn, void* args) {
+    if (map_fn == NULL) {
+        return ERROR_NONE;
+    }
+
+    uint64_t range = cortex->max_syn_count;
+
+    #pragma omp parallel for collapse(2)
+    for (cortex_size_t y = 0; y < cortex->height; y++) {
+        for (cortex_size_t x = 0; x < cortex->width; x++) {
+            uint32_t value = map_fn(x, y, cortex->width, cortex->height, args);
+            value = value > MAP_FN_MAX ? MAP_FN_MAX : value;
+            cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)].max_syn_count = (syn_count_t) ((value * range) / MAP_FN_MAX);
+        }
+    }
+
+    return ERROR_NONE;
+}
+
+error_code_t c2d_inhexc_from_fn(cortex2d_t* cortex, map_fn_t map_fn, void* args) {
+    if (map_fn == NULL) {
+        return ERROR_NONE;
+    }
+
+    uint64_t range = cortex->inhexc_range;
+
+    #pragma omp parallel for collapse(2)
+    for (cortex_size_t y = 0; y < cortex->height; y++) {
+        for (cortex_size_t x = 0; x < cortex->width; x++) {
+            uint32_t value = map_fn(x, y, cortex->width, cortex->height, args);
+            value = value > MAP_FN_MAX ? MAP_FN_MAX : value;
+            cortex->neurons[ORDER_IDX2D(x, y, cortex->width, cortex->neurons_order)].inhexc_ratio = (inhexc_ratio_t) ((value * range) / MAP_FN_MAX);
+        }
+    }
+
+    return ERROR_NONE;
+}
+
+uint32_t map_fn_radial(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args) {
+    radial_map_args_t* radial_args = (radial_map_args_t*) args;
+
+    // Work in normalized coordinates, sampling the center of the neuron.
+    float dx = (((float) x) + 0.5F) / (float) width - radial_args->center_x;
+    float dy = (((float) y) + 0.5F) / (float) height - radial_args->center_y;
+    float distance = sqrtf(dx * dx + dy * dy) / sqrtf(2.0F);
+
+    float value = radial_args->radius > 0.0F ? 1.0F - distance / radial_args->radius : 0.0F;
+    value = value < 0.0F ? 0.0F : value;
+
+    if (radial_args->inverted) {
+        value = 1.0F - value;
+    }
+
+    return (uint32_t) (value * MAP_FN_MAX);
+}
+
+// Hashes the given lattice point to a pseudo-random 32 bit value.
+static inline uint32_t lattice_hash(int32_t x, int32_t y, uint32_t seed) {
+    uint32_t h = seed ^ ((uint32_t) x * 0x8DA6B343U) ^ ((uint32_t) y * 0xD8163841U);
+    h ^= h >> 16;
+    h *= 0x7FEB352DU;
+    h ^= h >> 15;
+    h *= 0x846CA68BU;
+    h ^= h >> 16;
+    return h;
+}
+
+// Quintic smoothstep, used to interpolate between lattice points.
+static inline float fade(float t) {
+    return t * t * t * (t * (t * 6.0F - 15.0F) + 10.0F);
+}
+
+static inline float lerp(float a, float b, float t) {
+    return a + t * (b - a);
+}
+
+// Value noise in [0, 1] at the given point.
+static float value_noise(float x, float y, uint32_t seed) {
+    int32_t x0 = (int32_t) floorf(x);
+    int32_t y0 = (int32_t) floorf(y);
+    float tx = fade(x - (float) x0);
+    float ty = fade(y - (float) y0);
+
+    float v00 = (float) (lattice_hash(x0, y0, seed) & 0xFFFFU) / 65535.0F;
+    float v10 = (float) (lattice_hash(x0 + 1, y0, seed) & 0xFFFFU) / 65535.0F;
+    float v01 = (float) (lattice_hash(x0, y0 + 1, seed) & 0xFFFFU) / 65535.0F;
+    float v11 = (float) (lattice_hash(x0 + 1, y0 + 1, seed) & 0xFFFFU) / 65535.0F;
+
+    return lerp(lerp(v00, v10, tx), lerp(v01, v11, tx), ty);
+}
+
+// Dot product between the pseudo-random gradient of the given lattice point and the offset from it.
+static inline float lattice_grad(int32_t x, int32_t y, uint32_t seed, float dx, float dy) {
+    switch (lattice_hash(x, y, seed) & 0x07U) {
+        case 0: return dx + dy;
+        case 1: return dx - dy;
+        case 2: return -dx + dy;
+        case 3: return -dx - dy;
+        case 4: return dx;
+        case 5: return -dx;
+        case 6: return dy;
+        default: return -dy;
+    }
+}
+
+// Perlin noise in [0, 1] at the given point.
+static float perlin_noise(float x, float y, uint32_t seed) {
+    int32_t x0 = (int32_t) floorf(x);
+    int32_t y0 = (int32_t) floorf(y);
+    float fx = x - (float) x0;
+    float fy = y - (float) y0;
+    float tx = fade(fx);
+    float ty = fade(fy);
+
+    float n00 = lattice_grad(x0, y0, seed, fx, fy);
+    float n10 = lattice_grad(x0 + 1, y0, seed, fx - 1.0F, fy);
+    float n01 = lattice_grad(x0, y0 + 1, seed, fx, fy - 1.0F);
+    float n11 = lattice_grad(x0 + 1, y0 + 1, seed, fx - 1.0F, fy - 1.0F);
+
+    // Raw Perlin noise lies in [-1, 1].
+    float value = 0.5F + 0.5F * lerp(lerp(n00, n10, tx), lerp(n01, n11, tx), ty);
+    return value < 0.0F ? 0.0F : (value > 1.0F ? 1.0F : value);
+}
+
+// Sums octaves of the given noise function, normalizing the result to [0, MAP_FN_MAX].
+// With no scale, the coarsest cell spans the longest side of the cortex.
+static uint32_t fractal_noise(float (*noise)(float, float, uint32_t),
+                              cortex_size_t x,
+                              cortex_size_t y,
+                              cortex_size_t width,
+                              cortex_size_t height,
+                              noise_map_args_t* noise_args) {
+    cortex_size_t side = width > height ? width : height;
+    float scale = (float) (noise_args->scale > 0 ? noise_args->scale : side);
+    uint8_t octaves = noise_args->octaves > 0 ? noise_args->octaves : 1;
+    float amplitude = 1.0F;
+    float total_amplitude = 0.0F;
+    float value = 0.0F;
+
+    for (uint8_t i = 0; i < octaves; i++) {
+        value += amplitude * noise((float) x / scale, (float) y / scale, noise_args->seed + i);
+        total_amplitude += amplitude;
+        amplitude /= 2.0F;
+        scale /= 2.0F;
+    }
+
+    return (uint32_t) ((value / total_amplitude) * MAP_FN_MAX);
+}
+
+uint32_t map_fn_value_noise(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args) {
+    return fractal_noise(value_noise, x, y, width, height, (noise_map_args_t*) args);
+}
+
+uint32_t map_fn_perlin_noise(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args) {
+    return fractal_noise(perlin_noise, x, y, width, height, (noise_map_args_t*) args);
+}
+
+uint32_t map_fn_tiles(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args) {
+    tiles_map_args_t* tiles_args = (tiles_map_args_t*) args;
+
+    // Tiles with no size span the whole cortex along their axis.
+    cortex_size_t tile_x = x / (tiles_args->tile_width > 0 ? tiles_args->tile_width : width);
+    cortex_size_t tile_y = y / (tiles_args->tile_height > 0 ? tiles_args->tile_height : height);
+
+    return (tile_x + tile_y) % 2 ? tiles_args->high : tiles_args->low;
+}
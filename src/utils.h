@@ -14,6 +14,7 @@
 #include <math.h>
 #include "cortex.h"
 #include "error.h"
+#include "profiler.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,12 +38,83 @@ extern "C" {
 // image data
 typedef struct pgm_content_t {
     char pgmType[3];
+    // Raw samples, laid out as in a P5 file: one byte per sample if max_value < 256, two big-endian bytes otherwise.
+    // P5 data points straight into the file mapping (zero copy), while P2 data is decoded into an owned buffer.
     uint8_t* data;
     uint32_t width;
     uint32_t height;
     uint32_t max_value;
+    // Size of a single sample in bytes (1 or 2).
+    uint8_t sample_size;
+    // Memory mapping of the source file, NULL if data is owned.
+    void* mapping;
+    size_t mapping_size;
 } pgm_content_t;
 
+/// Reads a P2 (plain) or P5 (raw) pgm file, either 8 or 16 bit.
+/// The returned content must be released by calling pgm_destroy.
+/// @param pgm The content to fill.
+/// @param filename The pgm file to read.
+error_code_t pgm_read(pgm_content_t* pgm, const char* filename);
+
+/// Releases the memory held by the given pgm content.
+void pgm_destroy(pgm_content_t* pgm);
+
+/// Returns the i-th sample of the given pgm content.
+static inline uint32_t pgm_sample(const pgm_content_t* pgm, size_t i) {
+    return pgm->sample_size == 1 ? pgm->data[i] : (((uint32_t) pgm->data[2 * i]) << 8) | pgm->data[2 * i + 1];
+}
+
+/// Maximum value returned by map functions.
+#define MAP_FN_MAX 0xFFFFU
+
+/// Procedural map function: returns a value in [0, MAP_FN_MAX] for the neuron at (x, y) in a width x height cortex.
+/// Map functions are called concurrently, so they must not modify any shared state.
+typedef uint32_t (*map_fn_t)(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args);
+
+/// Arguments for map_fn_radial.
+typedef struct radial_map_args_t {
+    // Center of the gradient, as a fraction of the cortex width and height.
+    float center_x;
+    float center_y;
+    // Radius of the gradient, as a fraction of the cortex diagonal. The map value drops to 0 at this distance.
+    float radius;
+    // Whether the gradient should grow (TRUE) or fade (FALSE) moving away from the center.
+    bool_t inverted;
+} radial_map_args_t;
+
+/// Arguments for map_fn_value_noise and map_fn_perlin_noise.
+typedef struct noise_map_args_t {
+    // Seed of the noise: the same seed always generates the same map.
+    uint32_t seed;
+    // Size (in neurons) of the coarsest noise cell, the longest side of the cortex if 0.
+    cortex_size_t scale;
+    // Number of noise layers, each with half the scale and half the amplitude of the previous one.
+    uint8_t octaves;
+} noise_map_args_t;
+
+/// Arguments for map_fn_tiles.
+typedef struct tiles_map_args_t {
+    // Size (in neurons) of the tiles, the whole cortex width or height if 0, which makes stripes along the other axis.
+    cortex_size_t tile_width;
+    cortex_size_t tile_height;
+    // Values assigned to alternating (checkerboard) tiles, in [0, MAP_FN_MAX].
+    uint32_t low;
+    uint32_t high;
+} tiles_map_args_t;
+
+/// Radial gradient map. Expects a radial_map_args_t as args.
+uint32_t map_fn_radial(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args);
+
+/// Seeded value noise map. Expects a noise_map_args_t as args.
+uint32_t map_fn_value_noise(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args);
+
+/// Seeded Perlin (gradient) noise map. Expects a noise_map_args_t as args.
+uint32_t map_fn_perlin_noise(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args);
+
+/// Checkerboard tiles map. Expects a tiles_map_args_t as args.
+uint32_t map_fn_tiles(cortex_size_t x, cortex_size_t y, cortex_size_t width, cortex_size_t height, void* args);
+
 // Maps a value to the specified output domain.
 uint32_t map(uint32_t input, uint32_t input_start, uint32_t input_end, uint32_t output_start, uint32_t output_end);
 // Maps a value to the specified output domain while preserving decimal integrity.
@@ -63,16 +135,46 @@ uint64_t nanos();
 /// @param file_name The destination file to write the cortex to.
 void c2d_to_file(cortex2d_t* cortex, char* file_name);
 
-/// Reads the content from a file and initializes the provided cortex accordingly.
+/// Reads the content from a file written by c2d_to_file and initializes the provided cortex accordingly.
+/// @param cortex The cortex to init from file, which must not be initialized yet. It's then destroyed by c2d_destroy, as any other cortex.
+/// @param file_name The file to read the cortex from.
+/// @return ERROR_FILE_DOES_NOT_EXIST if the file can't be opened, ERROR_FILE_SIZE_WRONG if it's shorter than the cortex it describes,
+/// ERROR_FILE_WRONG_FORMAT if it describes an invalid cortex. The cortex is left NULL on any error.
+error_code_t c2d_from_file(cortex2d_t** cortex, char* file_name);
+
+/// Dumps the 3D cortex' content to a file, neurons in (x, y, z) order.
+/// The file is created if not already present, overwritten otherwise.
+/// @param cortex The cortex to be written to file.
+/// @param file_name The destination file to write the cortex to.
+void c3d_to_file(cortex3d_t* cortex, char* file_name);
+
+/// Reads the content from a file written by c3d_to_file and initializes the provided 3D cortex accordingly.
 /// @param cortex The cortex to init from file.
 /// @param file_name The file to read the cortex from.
-void c2d_from_file(cortex2d_t* cortex, char* file_name);
+error_code_t c3d_from_file(cortex3d_t** cortex, char* file_name);
 
-/// Sets each neurons's touch from a pgm map file
+/// Sets each neurons's touch from a pgm map file.
+/// Map values are scaled from [0, max_value] to [0, cortex->max_syn_count].
 error_code_t c2d_touch_from_map(cortex2d_t* cortex, char* map_file_name);
 
+/// Sets each neurons's inhexc ratio from a pgm map file.
+/// Map values are scaled from [0, max_value] to [0, cortex->inhexc_range].
 error_code_t c2d_inhexc_from_map(cortex2d_t* cortex, char* map_file_name);
 
+/// Sets each neurons's touch from a procedural map function, without any file I/O.
+/// Map values are scaled from [0, MAP_FN_MAX] to [0, cortex->max_syn_count].
+/// @param cortex The cortex to edit.
+/// @param map_fn The map function to evaluate for each neuron (e.g. map_fn_radial).
+/// @param args The arguments passed to map_fn.
+error_code_t c2d_touch_from_fn(cortex2d_t* cortex, map_fn_t map_fn, void* args);
+
+/// Sets each neurons's inhexc ratio from a procedural map function, without any file I/O.
+/// Map values are scaled from [0, MAP_FN_MAX] to [0, cortex->inhexc_range].
+/// @param cortex The cortex to edit.
+/// @param map_fn The map function to evaluate for each neuron (e.g. map_fn_value_noise).
+/// @param args The arguments passed to map_fn.
+error_code_t c2d_inhexc_from_fn(cortex2d_t* cortex, map_fn_t map_fn, void* args);
+
 #ifdef __cplusplus
 }
 #endif